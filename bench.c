@@ -0,0 +1,1048 @@
+//throughput benchmarks over generated corpora, built apart from the tests :
+//  gcc -std=gnu11 -O2 -o zson_bench bench.c json*.c -lm -pthread
+//usage : zson_bench [repetitions] [--json] [--scaling]
+//  each operation runs a few warmup passes and then the given repetitions (20 by default) over the whole corpus,
+//  the percentiles are of the time of one pass, MB/s is of the input at the median, --json prints the results as a json array for tracking regressions
+//  --scaling fits how the time of each operation grows with the size of the document, and exits with the number of operations that grow
+//  faster than linear, or faster than bytes * depth for the listed depth bound paths, or that are listed and have become linear
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include "json.h"
+
+#define BENCH_WARMUP 3
+#define BENCH_MAX_REPETITIONS 1000
+#define BENCH_MAX_LINES 65536
+
+typedef struct BenchCorpus
+{
+    const char* Name;
+    char* Text;
+    size_t Size;
+    const char* LookupKey;//looked up in the root object or in each object of the root array
+    int Lines;//ndjson, one document per line
+} BenchCorpus;
+
+typedef struct BenchResult
+{
+    const char* Corpus;
+    const char* Operation;
+    size_t Bytes;
+    int Repetitions;
+    double P50;
+    double P90;
+    double P99;
+    double Min;
+} BenchResult;
+
+typedef struct BenchState
+{
+    BenchCorpus* Corpus;
+    char* Work;//writable copy for the destructive parse
+    char* Parsed;//parsed once, for the operations that read the parsed encoding
+    JsonObject Roots[BENCH_MAX_LINES];
+    int RootCount;
+    char* Indented;
+    char* Scratch;
+    char* Copy;//the first root parsed again with the properties of every object in reverse order, so comparisons take the unordered path
+    JsonObject Twin;
+    char* Edited;//a copy of the first root with room for the edits
+    double Sink;//keeps the compiler from dropping the work
+} BenchState;
+
+typedef void (*BenchOperation)(BenchState* pState);
+
+/*************************
+ * timing
+**************************/
+
+double bench_now_ns()
+{
+#ifdef _WIN32
+    LARGE_INTEGER nCounter, nFrequency;
+    QueryPerformanceCounter(&nCounter);
+    QueryPerformanceFrequency(&nFrequency);
+    return (double)nCounter.QuadPart * 1e9 / (double)nFrequency.QuadPart;
+#else
+    struct timespec oTime;
+    clock_gettime(CLOCK_MONOTONIC, &oTime);
+    return (double)oTime.tv_sec * 1e9 + (double)oTime.tv_nsec;
+#endif
+}
+
+int bench_compare_double(const void* pLeft, const void* pRight)
+{
+    double nLeft = *(const double*)pLeft;
+    double nRight = *(const double*)pRight;
+    return (nLeft > nRight) - (nLeft < nRight);
+}
+
+double bench_percentile(const double* pSorted, int nCount, double nPercent)
+{
+    int nIndex = (int)(nPercent / 100.0 * (nCount - 1) + 0.5);
+    return pSorted[nIndex];
+}
+
+/*************************
+ * corpora
+ * generated with the writer from a fixed seed, so every run and every version measures the same text
+**************************/
+
+unsigned int nBenchSeed = 12345;
+unsigned int bench_random()
+{
+    nBenchSeed = nBenchSeed * 1103515245 + 12345;
+    return (nBenchSeed >> 16) & 0x7FFF;
+}
+
+void bench_random_word(char* pWord, int nMin, int nMax)
+{
+    int nLength = nMin + bench_random() % (nMax - nMin + 1);
+    for (int i = 0; i < nLength; i++)
+        pWord[i] = 'a' + bench_random() % 26;
+    pWord[nLength] = '\0';
+}
+
+void bench_random_sentence(char* pText, int nWords)
+{
+    char pWord[16];
+    pText[0] = '\0';
+    for (int i = 0; i < nWords; i++)
+    {
+        bench_random_word(pWord, 2, 10);
+        strcat(pText, pWord);
+        strcat(pText, i + 1 < nWords ? " " : "");
+    }
+}
+
+//moves the text of a finished buffer to a plain allocation
+char* bench_take_text(char* pBuffer, size_t* pSize)
+{
+    if (Json_GetError(pBuffer))//a corpus that was not fully written would be measured on a fraction of its text
+    {
+        printf("corpus not written : %s\n", Json_GetError(pBuffer));
+        exit(1);
+    }
+    size_t nSize = strlen(pBuffer);
+    char* pText = (char*)malloc(nSize + 1);
+    memcpy(pText, pBuffer, nSize + 1);
+    Json_ReleaseBuffer(pBuffer);
+    *pSize = nSize;
+    return pText;
+}
+
+void bench_write_status(char** pBuffer, int nIndex)
+{
+    char pText[256];
+    char pWord[16];
+    Json_AddObject(pBuffer);
+    Json_AddPropertyInt64(pBuffer, "id", 850000000000000000LL + nIndex);
+    sprintf(pText, "%lld", 850000000000000000LL + nIndex);
+    Json_AddPropertyString(pBuffer, "id_str", pText);
+    bench_random_sentence(pText, 5 + bench_random() % 15);
+    Json_AddPropertyString(pBuffer, "text", pText);
+    Json_AddPropertyString(pBuffer, "created_at", "Sun Aug 31 00:29:15 +0000 2014");
+    Json_AddPropertyObject(pBuffer, "user");
+    Json_AddPropertyInt64(pBuffer, "id", bench_random() * 1000 + bench_random());
+    bench_random_word(pWord, 4, 12);
+    Json_AddPropertyString(pBuffer, "name", pWord);
+    Json_AddPropertyString(pBuffer, "screen_name", pWord);
+    bench_random_sentence(pText, 8);
+    Json_AddPropertyString(pBuffer, "description", pText);
+    Json_AddPropertyInt64(pBuffer, "followers_count", bench_random());
+    Json_AddPropertyInt64(pBuffer, "friends_count", bench_random() % 2000);
+    Json_AddPropertyBool(pBuffer, "verified", bench_random() % 10 == 0);
+    Json_AddPropertyNull(pBuffer, "url");
+    Json_ExitScope(pBuffer);
+    Json_AddPropertyObject(pBuffer, "entities");
+    Json_AddPropertyArray(pBuffer, "hashtags");
+    for (int i = bench_random() % 4; i > 0; i--)
+    {
+        Json_AddObject(pBuffer);
+        bench_random_word(pWord, 3, 10);
+        Json_AddPropertyString(pBuffer, "text", pWord);
+        Json_AddPropertyArray(pBuffer, "indices");
+        Json_AddInt64(pBuffer, bench_random() % 100);
+        Json_AddInt64(pBuffer, bench_random() % 100 + 100);
+        Json_ExitScope(pBuffer);
+        Json_ExitScope(pBuffer);
+    }
+    Json_ExitScope(pBuffer);
+    Json_AddPropertyArray(pBuffer, "urls");
+    Json_ExitScope(pBuffer);
+    Json_ExitScope(pBuffer);
+    Json_AddPropertyInt64(pBuffer, "retweet_count", bench_random() % 500);
+    Json_AddPropertyInt64(pBuffer, "favorite_count", bench_random() % 500);
+    Json_AddPropertyBool(pBuffer, "favorited", 0);
+    Json_AddPropertyNull(pBuffer, "coordinates");
+    Json_AddPropertyString(pBuffer, "lang", "en");
+    Json_ExitScope(pBuffer);
+}
+
+char* bench_generate_twitter(size_t* pSize)
+{
+    char* pBuffer = Json_CreateBuffer();
+    Json_AddObject(&pBuffer);
+    Json_AddPropertyArray(&pBuffer, "statuses");
+    for (int i = 0; i < 4000; i++)
+        bench_write_status(&pBuffer, i);
+    Json_ExitScope(&pBuffer);
+    Json_AddPropertyObject(&pBuffer, "search_metadata");
+    Json_AddPropertyNumber(&pBuffer, "completed_in", 0.087);
+    Json_AddPropertyInt64(&pBuffer, "count", 4000);
+    Json_ExitScope(&pBuffer);
+    Json_ExitScope(&pBuffer);
+    return bench_take_text(pBuffer, pSize);
+}
+
+char* bench_generate_numbers(size_t* pSize)
+{
+    char* pBuffer = Json_CreateBuffer();
+    Json_AddArray(&pBuffer);
+    for (int i = 0; i < 200000; i++)
+    {
+        switch (i % 4)
+        {
+            case 0: Json_AddInt64(&pBuffer, bench_random() % 10); break;
+            case 1: Json_AddInt64(&pBuffer, (long long)bench_random() * bench_random() - 500000000LL); break;
+            case 2: Json_AddNumber(&pBuffer, ((int)bench_random() - 16384) / 128.0); break;
+            case 3: Json_AddNumber(&pBuffer, ((long long)bench_random() * 32768 + bench_random()) / 1024.0); break;//binary fractions print exactly, the parser takes up to 16 decimals
+        }
+    }
+    Json_ExitScope(&pBuffer);
+    return bench_take_text(pBuffer, pSize);
+}
+
+void bench_write_log(char** pBuffer, int nIndex)
+{
+    static const char* pLevels[] = { "debug", "info", "warning", "error" };
+    char pText[512];
+    char pMessage[640];
+    Json_AddObject(pBuffer);
+    sprintf(pText, "2024-05-%02dT%02d:%02d:%02d.%03dZ", 1 + nIndex % 28, nIndex % 24, nIndex % 60, (nIndex * 7) % 60, nIndex % 1000);
+    Json_AddPropertyString(pBuffer, "timestamp", pText);
+    Json_AddPropertyString(pBuffer, "level", pLevels[bench_random() % 4]);
+    bench_random_sentence(pText, 10 + bench_random() % 30);
+    sprintf(pMessage, "request \"%d\" failed:\n\t%s\\retry", nIndex, pText);
+    Json_AddPropertyString(pBuffer, "message", pMessage);
+    Json_AddPropertyString(pBuffer, "host", "api-01.eu-west.internal/service");
+    Json_AddPropertyInt64(pBuffer, "pid", 1000 + bench_random() % 30000);
+    Json_ExitScope(pBuffer);
+}
+
+char* bench_generate_logs(size_t* pSize)
+{
+    char* pBuffer = Json_CreateBuffer();
+    Json_AddArray(&pBuffer);
+    for (int i = 0; i < 10000; i++)
+        bench_write_log(&pBuffer, i);
+    Json_ExitScope(&pBuffer);
+    return bench_take_text(pBuffer, pSize);
+}
+
+char* bench_generate_deep(size_t* pSize)
+{
+    char* pBuffer = Json_CreateBuffer();
+    Json_AddArray(&pBuffer);
+    for (int i = 0; i < 2000; i++)
+    {
+        int nDepth = 20 + bench_random() % 40;
+        for (int d = 0; d < nDepth; d++)
+        {
+            if (d % 2)
+                Json_AddArray(&pBuffer);
+            else
+            {
+                Json_AddObject(&pBuffer);
+                Json_AddPropertyInt64(&pBuffer, "level", d);
+                Json_AddPropertyArray(&pBuffer, "child");
+            }
+        }
+        Json_AddString(&pBuffer, "leaf");
+        for (int d = nDepth - 1; d >= 0; d--)
+        {
+            Json_ExitScope(&pBuffer);
+            if (d % 2 == 0)
+                Json_ExitScope(&pBuffer);
+        }
+    }
+    Json_ExitScope(&pBuffer);
+    return bench_take_text(pBuffer, pSize);
+}
+
+char* bench_generate_wide(size_t* pSize)
+{
+    char pName[32];
+    char pWord[16];
+    char* pBuffer = Json_CreateBuffer();
+    Json_AddObject(&pBuffer);
+    for (int i = 0; i < 50000; i++)
+    {
+        sprintf(pName, "property_%d", i);
+        if (i % 3 == 0)
+            Json_AddPropertyInt64(&pBuffer, pName, bench_random());
+        else if (i % 3 == 1)
+        {
+            bench_random_word(pWord, 3, 12);
+            Json_AddPropertyString(&pBuffer, pName, pWord);
+        }
+        else
+            Json_AddPropertyBool(&pBuffer, pName, i % 2);
+    }
+    Json_ExitScope(&pBuffer);
+    return bench_take_text(pBuffer, pSize);
+}
+
+char* bench_generate_ndjson(size_t* pSize, int* pLines)
+{
+    int nLines = 20000;
+    size_t nCapacity = 1 << 20;
+    size_t nSize = 0;
+    char* pText = (char*)malloc(nCapacity);
+    for (int i = 0; i < nLines; i++)
+    {
+        char* pBuffer = Json_CreateBuffer();
+        bench_write_log(&pBuffer, i);
+        size_t nLength = strlen(pBuffer);
+        while (nSize + nLength + 2 > nCapacity)
+            pText = (char*)realloc(pText, nCapacity *= 2);
+        memcpy(pText + nSize, pBuffer, nLength);
+        nSize += nLength;
+        pText[nSize++] = '\n';
+        Json_ReleaseBuffer(pBuffer);
+    }
+    pText[nSize] = '\0';
+    *pSize = nSize;
+    *pLines = nLines;
+    return pText;
+}
+
+/*************************
+ * operations
+ * each one is a full pass over the corpus
+**************************/
+
+void bench_parse(BenchState* pState)
+{
+    BenchCorpus* pCorpus = pState->Corpus;
+    memcpy(pState->Work, pCorpus->Text, pCorpus->Size + 1);//part of the measure, the parse is destructive
+    if (!pCorpus->Lines)
+    {
+        pState->Sink += Json_Parse(pState->Work).EndSize;
+        return;
+    }
+    char* pLine = pState->Work;
+    while (*pLine)
+    {
+        char* pEnd = strchr(pLine, '\n');
+        *pEnd = '\0';
+        pState->Sink += Json_Parse(pLine).EndSize;
+        pLine = pEnd + 1;
+    }
+}
+
+double bench_walk(JsonObject oJson)
+{
+    double nSum = 0;
+    switch (oJson.Type)
+    {
+        case JsonTypeObject:
+            for (JsonProperty oProperty = Json_IterateProperties(oJson); oProperty.Value.Type != JsonTypeInvalid; oProperty = Json_NextProperty(oProperty))
+                nSum += bench_walk(oProperty.Value) + oProperty.Name[0];
+            break;
+        case JsonTypeArray:
+            for (JsonElement oElement = Json_IterateElements(oJson); oElement.Value.Type != JsonTypeInvalid; oElement = Json_NextElement(oElement))
+                nSum += bench_walk(oElement.Value);
+            break;
+        case JsonTypeNumber:
+            nSum = oJson.DoubleValue;
+            break;
+        case JsonTypeString:
+            nSum = oJson.StringValue[0];
+            break;
+        case JsonTypeBool:
+            nSum = oJson.BoolValue;
+            break;
+        default:
+            break;
+    }
+    return nSum;
+}
+
+void bench_iterate(BenchState* pState)
+{
+    for (int i = 0; i < pState->RootCount; i++)
+        pState->Sink += bench_walk(pState->Roots[i]);
+}
+
+double bench_lookup_in(JsonObject oJson, const char* sKey)
+{
+    double nSum = 0;
+    if (oJson.Type == JsonTypeObject)
+    {
+        JsonProperty oProperty = Json_GetPropertyByName(oJson, (char*)sKey);
+        nSum += oProperty.Value.Type;
+        //the first array found in the object holds the records
+        for (oProperty = Json_IterateProperties(oJson); oProperty.Value.Type != JsonTypeInvalid; oProperty = Json_NextProperty(oProperty))
+            if (oProperty.Value.Type == JsonTypeArray)
+                return nSum + bench_lookup_in(oProperty.Value, sKey);
+    }
+    else if (oJson.Type == JsonTypeArray)
+    {
+        for (JsonElement oElement = Json_IterateElements(oJson); oElement.Value.Type != JsonTypeInvalid; oElement = Json_NextElement(oElement))
+            if (oElement.Value.Type == JsonTypeObject)
+                nSum += Json_GetPropertyByName(oElement.Value, (char*)sKey).Value.Type;
+    }
+    return nSum;
+}
+
+void bench_lookup(BenchState* pState)
+{
+    for (int i = 0; i < pState->RootCount; i++)
+        pState->Sink += bench_lookup_in(pState->Roots[i], pState->Corpus->LookupKey);
+}
+
+void bench_write_value(char** pBuffer, const char* sName, JsonObject oJson)
+{
+    switch (oJson.Type)
+    {
+        case JsonTypeObject:
+            sName ? Json_AddPropertyObject(pBuffer, sName) : Json_AddObject(pBuffer);
+            for (JsonProperty oProperty = Json_IterateProperties(oJson); oProperty.Value.Type != JsonTypeInvalid; oProperty = Json_NextProperty(oProperty))
+                bench_write_value(pBuffer, oProperty.Name, oProperty.Value);
+            Json_ExitScope(pBuffer);
+            break;
+        case JsonTypeArray:
+            sName ? Json_AddPropertyArray(pBuffer, sName) : Json_AddArray(pBuffer);
+            for (JsonElement oElement = Json_IterateElements(oJson); oElement.Value.Type != JsonTypeInvalid; oElement = Json_NextElement(oElement))
+                bench_write_value(pBuffer, 0, oElement.Value);
+            Json_ExitScope(pBuffer);
+            break;
+        case JsonTypeNumber:
+            sName ? Json_AddPropertyNumber(pBuffer, sName, oJson.DoubleValue) : Json_AddNumber(pBuffer, oJson.DoubleValue);
+            break;
+        case JsonTypeString:
+            sName ? Json_AddPropertyString(pBuffer, sName, oJson.StringValue) : Json_AddString(pBuffer, oJson.StringValue);
+            break;
+        case JsonTypeBool:
+            sName ? Json_AddPropertyBool(pBuffer, sName, oJson.BoolValue) : Json_AddBool(pBuffer, oJson.BoolValue);
+            break;
+        case JsonTypeNull:
+            sName ? Json_AddPropertyNull(pBuffer, sName) : Json_AddNull(pBuffer);
+            break;
+        default:
+            break;
+    }
+}
+
+//the same value with the properties of every object written from the last to the first
+void bench_write_reversed(char** pBuffer, const char* sName, JsonObject oJson)
+{
+    if (oJson.Type != JsonTypeObject && oJson.Type != JsonTypeArray)
+    {
+        bench_write_value(pBuffer, sName, oJson);
+        return;
+    }
+    if (oJson.Type == JsonTypeArray)
+    {
+        sName ? Json_AddPropertyArray(pBuffer, sName) : Json_AddArray(pBuffer);
+        for (JsonElement oElement = Json_IterateElements(oJson); oElement.Value.Type != JsonTypeInvalid; oElement = Json_NextElement(oElement))
+            bench_write_reversed(pBuffer, 0, oElement.Value);
+        Json_ExitScope(pBuffer);
+        return;
+    }
+    long long nCount = Json_GetPropertyCount(oJson);
+    JsonProperty* pProperties = (JsonProperty*)malloc(sizeof(JsonProperty) * (nCount + 1));
+    long long i = 0;
+    for (JsonProperty oProperty = Json_IterateProperties(oJson); oProperty.Value.Type != JsonTypeInvalid; oProperty = Json_NextProperty(oProperty))
+        pProperties[i++] = oProperty;
+    sName ? Json_AddPropertyObject(pBuffer, sName) : Json_AddObject(pBuffer);
+    while (i > 0)
+    {
+        i--;
+        bench_write_reversed(pBuffer, pProperties[i].Name, pProperties[i].Value);
+    }
+    Json_ExitScope(pBuffer);
+    free(pProperties);
+}
+
+void bench_build(BenchState* pState)
+{
+    for (int i = 0; i < pState->RootCount; i++)
+    {
+        char* pBuffer = Json_CreateBuffer();
+        bench_write_value(&pBuffer, 0, pState->Roots[i]);
+        pState->Sink += strlen(pBuffer);
+        Json_ReleaseBuffer(pBuffer);
+    }
+}
+
+void bench_indent(BenchState* pState)
+{
+    char* pIndented = Json_Indent(pState->Corpus->Text);
+    pState->Sink += pIndented[0];
+    free(pIndented);
+}
+
+void bench_compress(BenchState* pState)
+{
+    pState->Sink += Json_CompressInto(pState->Indented, pState->Scratch);
+}
+
+/*************************
+ * runner
+**************************/
+
+BenchResult bench_run(BenchState* pState, const char* sOperation, BenchOperation fOperation, size_t nBytes, int nRepetitions)
+{
+    static double pTimes[BENCH_MAX_REPETITIONS];
+    for (int i = 0; i < BENCH_WARMUP; i++)
+        fOperation(pState);
+    for (int i = 0; i < nRepetitions; i++)
+    {
+        double nStart = bench_now_ns();
+        fOperation(pState);
+        pTimes[i] = bench_now_ns() - nStart;
+    }
+    qsort(pTimes, nRepetitions, sizeof(double), bench_compare_double);
+
+    BenchResult oResult;
+    oResult.Corpus = pState->Corpus->Name;
+    oResult.Operation = sOperation;
+    oResult.Bytes = nBytes;
+    oResult.Repetitions = nRepetitions;
+    oResult.P50 = bench_percentile(pTimes, nRepetitions, 50);
+    oResult.P90 = bench_percentile(pTimes, nRepetitions, 90);
+    oResult.P99 = bench_percentile(pTimes, nRepetitions, 99);
+    oResult.Min = pTimes[0];
+    return oResult;
+}
+
+double bench_throughput(const BenchResult* pResult)
+{
+    return (double)pResult->Bytes / (1024.0 * 1024.0) / (pResult->P50 / 1e9);
+}
+
+void bench_print(const BenchResult* pResult)
+{
+    printf("%-10s %-10s %10.2f %14.0f %14.0f %14.0f\n", pResult->Corpus, pResult->Operation,
+        bench_throughput(pResult), pResult->P50, pResult->P90, pResult->P99);
+}
+
+void bench_add_result(char** pBuffer, const BenchResult* pResult)
+{
+    Json_AddObject(pBuffer);
+    Json_AddPropertyString(pBuffer, "corpus", pResult->Corpus);
+    Json_AddPropertyString(pBuffer, "operation", pResult->Operation);
+    Json_AddPropertyInt64(pBuffer, "bytes", (long long)pResult->Bytes);
+    Json_AddPropertyInt64(pBuffer, "repetitions", pResult->Repetitions);
+    Json_AddPropertyNumber(pBuffer, "mb_per_s", bench_throughput(pResult));
+    Json_AddPropertyInt64(pBuffer, "p50_ns", (long long)pResult->P50);
+    Json_AddPropertyInt64(pBuffer, "p90_ns", (long long)pResult->P90);
+    Json_AddPropertyInt64(pBuffer, "p99_ns", (long long)pResult->P99);
+    Json_AddPropertyInt64(pBuffer, "min_ns", (long long)pResult->Min);
+    Json_ExitScope(pBuffer);
+}
+
+//parses the corpus once, keeping the roots for the operations that only read
+int bench_prepare(BenchState* pState, BenchCorpus* pCorpus)
+{
+    pState->Corpus = pCorpus;
+    pState->Work = (char*)malloc(pCorpus->Size + 1);
+    pState->Parsed = (char*)malloc(pCorpus->Size + 1);
+    memcpy(pState->Parsed, pCorpus->Text, pCorpus->Size + 1);
+    pState->RootCount = 0;
+    pState->Sink = 0;
+    pState->Indented = 0;
+    pState->Scratch = 0;
+    pState->Copy = 0;
+    pState->Edited = 0;
+    char* pLine = pState->Parsed;
+    while (*pLine && pState->RootCount < BENCH_MAX_LINES)
+    {
+        char* pEnd = pCorpus->Lines ? strchr(pLine, '\n') : 0;
+        if (pEnd)
+            *pEnd = '\0';
+        JsonResult oResult = Json_Parse(pLine);
+        if (!oResult.Success)
+        {
+            printf("%s does not parse : %s at %lli\n", pCorpus->Name, oResult.Error, oResult.Index);
+            return 0;
+        }
+        pState->Roots[pState->RootCount++] = oResult.RootObject;
+        if (!pEnd)
+            break;
+        pLine = pEnd + 1;
+    }
+    pState->Indented = pCorpus->Lines ? 0 : Json_Indent(pCorpus->Text);
+    pState->Scratch = pState->Indented ? (char*)malloc(strlen(pState->Indented) + 1) : 0;
+    char* pBuffer = Json_CreateBuffer();
+    bench_write_reversed(&pBuffer, 0, pState->Roots[0]);
+    pState->Copy = (char*)malloc(strlen(pBuffer) + 1);
+    memcpy(pState->Copy, pBuffer, strlen(pBuffer) + 1);
+    Json_ReleaseBuffer(pBuffer);
+    pState->Twin = Json_Parse(pState->Copy).RootObject;
+    pState->Edited = (char*)malloc(2 * (pCorpus->Size + 1));
+    return 1;
+}
+
+void bench_release(BenchState* pState)
+{
+    free(pState->Work);
+    free(pState->Parsed);
+    free(pState->Indented);
+    free(pState->Scratch);
+    free(pState->Copy);
+    free(pState->Edited);
+}
+
+/*************************
+ * scaling
+ * every operation is timed over the same shape of document at sizes spread over orders of magnitude,
+ * the growth rate is the slope of log(time) over log(bytes), and it must stay linear
+**************************/
+
+#define BENCH_SCALING_STEPS 5
+#define BENCH_SCALING_TOLERANCE 0.5//slack over linear for caches, allocators and timer noise, halfway to quadratic
+#define BENCH_SCALING_MIN_NS 20e6//each size is repeated until it has run for at least this long
+#define BENCH_SCALING_ROUNDS 3//the sizes are timed again in every round and each keeps its best time, so a slow moment hits one round only
+
+typedef char* (*BenchShapeGenerator)(int nCount, size_t* pSize);
+
+typedef struct BenchShape
+{
+    const char* Name;
+    BenchShapeGenerator Generate;
+    int Sizes[BENCH_SCALING_STEPS];//the count the shape grows along
+} BenchShape;
+
+//a path that is linear in bytes * depth instead of bytes, held to that contract,
+//and failing once it is linear in bytes so it gets removed
+typedef struct BenchDepthBound
+{
+    const char* Shape;
+    const char* Operation;
+    const char* Reason;
+} BenchDepthBound;
+
+//array width, small records side by side
+char* bench_shape_array(int nCount, size_t* pSize)
+{
+    char pName[32];
+    char* pBuffer = Json_CreateAppendBuffer();
+    Json_AddArray(&pBuffer);
+    for (int i = 0; i < nCount; i++)
+    {
+        sprintf(pName, "item %i", i);
+        Json_AddObject(&pBuffer);
+        Json_AddPropertyInt64(&pBuffer, "id", i);
+        Json_AddPropertyString(&pBuffer, "name", pName);
+        Json_AddPropertyNumber(&pBuffer, "score", i / 8.0);
+        Json_ExitScope(&pBuffer);
+    }
+    Json_ExitScope(&pBuffer);
+    return bench_take_text(pBuffer, pSize);
+}
+
+//object width, every value found by its own name
+char* bench_shape_object(int nCount, size_t* pSize)
+{
+    char pName[32];
+    char* pBuffer = Json_CreateAppendBuffer();
+    Json_AddObject(&pBuffer);
+    for (int i = 0; i < nCount; i++)
+    {
+        sprintf(pName, "property_%i", i);
+        Json_AddPropertyInt64(&pBuffer, pName, i);
+    }
+    Json_ExitScope(&pBuffer);
+    return bench_take_text(pBuffer, pSize);
+}
+
+//depth, objects and arrays nested one in the other
+char* bench_shape_deep(int nCount, size_t* pSize)
+{
+    char* pBuffer = Json_CreateBuffer();
+    Json_AddArray(&pBuffer);
+    for (int i = 0; i < nCount; i++)
+    {
+        Json_AddObject(&pBuffer);
+        Json_AddPropertyInt64(&pBuffer, "level", i);
+        Json_AddPropertyArray(&pBuffer, "child");
+    }
+    Json_AddNull(&pBuffer);
+    for (int i = 0; i < nCount; i++)
+    {
+        Json_ExitScope(&pBuffer);
+        Json_ExitScope(&pBuffer);
+    }
+    Json_ExitScope(&pBuffer);
+    return bench_take_text(pBuffer, pSize);
+}
+
+//element size, a few strings that grow
+char* bench_shape_strings(int nCount, size_t* pSize)
+{
+    char* pText = (char*)malloc(nCount + 1);
+    char* pBuffer = Json_CreateAppendBuffer();
+    Json_AddArray(&pBuffer);
+    for (int i = 0; i < 16; i++)
+    {
+        for (int c = 0; c < nCount; c++)
+            pText[c] = c % 61 == 60 ? '\n' : 'a' + (c + i) % 26;
+        pText[nCount] = '\0';
+        Json_AddString(&pBuffer, pText);
+    }
+    Json_ExitScope(&pBuffer);
+    free(pText);
+    return bench_take_text(pBuffer, pSize);
+}
+
+int bench_event_ignore(void* pUser)
+{
+    (void)pUser;
+    return JsonEventContinue;
+}
+
+void bench_events(BenchState* pState)
+{
+    JsonEventHandler oHandler = { 0 };
+    oHandler.StartObject = bench_event_ignore;
+    oHandler.StartArray = bench_event_ignore;
+    pState->Sink += Json_ParseEvents(pState->Corpus->Text, &oHandler, pState->Work, (int)pState->Corpus->Size + 1).Success;
+}
+
+void bench_count(BenchState* pState)
+{
+    JsonObject oRoot = pState->Roots[0];
+    pState->Sink += oRoot.Type == JsonTypeObject ? Json_GetPropertyCount(oRoot) : Json_GetElementCount(oRoot);
+}
+
+//a few elements spread over the root array, the last one included
+void bench_index(BenchState* pState)
+{
+    JsonObject oRoot = pState->Roots[0];
+    long long nCount = Json_GetElementCount(oRoot);
+    for (int i = 1; i <= 8; i++)
+        pState->Sink += Json_GetElementAtIndex(oRoot, nCount * i / 8 - 1).Value.Type;
+}
+
+void bench_measure(BenchState* pState)
+{
+    JsonObject oCopy = Json_CopySubtree(pState->Roots[0], pState->Work, (long long)pState->Corpus->Size + 1);
+    pState->Sink += oCopy.Type;
+}
+
+void bench_hash(BenchState* pState)
+{
+    pState->Sink += (double)(Json_Hash(pState->Roots[0]) & 0xFF);
+}
+
+void bench_equals(BenchState* pState)
+{
+    pState->Sink += Json_Equals(pState->Roots[0], pState->Twin);
+}
+
+void bench_append(BenchState* pState)
+{
+    char* pBuffer = Json_CreateAppendBuffer();
+    bench_write_value(&pBuffer, 0, pState->Roots[0]);
+    pState->Sink += strlen(pBuffer);
+    Json_ReleaseBuffer(pBuffer);
+}
+
+//the parsed root written back as text in one call
+void bench_value(BenchState* pState)
+{
+    char* pBuffer = Json_CreateBuffer();
+    Json_AddValue(&pBuffer, pState->Roots[0]);
+    pState->Sink += strlen(pBuffer);
+    Json_ReleaseBuffer(pBuffer);
+}
+
+//a copy of the root loses its first child and gets it back at the end, one edit at a time
+void bench_edit(BenchState* pState)
+{
+    long long nCapacity = 2 * ((long long)pState->Corpus->Size + 1);
+    JsonObject oRoot = Json_CopySubtree(pState->Roots[0], pState->Edited, nCapacity);
+    JsonEditor oEditor;
+    Json_InitEditor(&oEditor, pState->Edited, nCapacity);
+    if (oRoot.Type == JsonTypeObject)
+    {
+        JsonProperty oFirst = Json_IterateProperties(pState->Roots[0]);
+        Json_RemoveProperty(&oEditor, oRoot, oFirst.Name);
+        Json_InsertProperty(&oEditor, Json_Load(pState->Edited), oFirst.Name, oFirst.Value);
+    }
+    else
+    {
+        Json_RemoveElement(&oEditor, oRoot, 0);
+        Json_AppendElement(&oEditor, Json_Load(pState->Edited), Json_IterateElements(pState->Roots[0]).Value);
+    }
+    pState->Sink += oEditor.Error ? -1 : (double)oEditor.Size;
+}
+
+//the same two edits committed as one batch
+void bench_batch(BenchState* pState)
+{
+    long long nCapacity = 2 * ((long long)pState->Corpus->Size + 1);
+    JsonObject oRoot = Json_CopySubtree(pState->Roots[0], pState->Edited, nCapacity);
+    JsonEditor oEditor;
+    JsonEdit pEdits[2];
+    JsonEditBatch oBatch;
+    Json_InitEditor(&oEditor, pState->Edited, nCapacity);
+    Json_InitBatch(&oBatch, pEdits, 2);
+    if (oRoot.Type == JsonTypeObject)
+    {
+        JsonProperty oFirst = Json_IterateProperties(pState->Roots[0]);
+        Json_BatchRemoveProperty(&oBatch, oRoot, oFirst.Name);
+        Json_BatchInsertProperty(&oBatch, oRoot, oFirst.Name, oFirst.Value);
+    }
+    else
+    {
+        Json_BatchRemoveElement(&oBatch, oRoot, 0);
+        Json_BatchAppendElement(&oBatch, oRoot, Json_IterateElements(pState->Roots[0]).Value);
+    }
+    Json_CommitBatch(&oEditor, &oBatch);
+    pState->Sink += oEditor.Error || oBatch.Error ? -1 : (double)oEditor.Size;
+}
+
+//least squares slope of log(time) over log(size)
+double bench_fit_exponent(const double* pSizes, const double* pTimes, int nCount)
+{
+    double nMeanX = 0, nMeanY = 0;
+    for (int i = 0; i < nCount; i++)
+    {
+        nMeanX += log(pSizes[i]) / nCount;
+        nMeanY += log(pTimes[i]) / nCount;
+    }
+    double nCovariance = 0, nVariance = 0;
+    for (int i = 0; i < nCount; i++)
+    {
+        nCovariance += (log(pSizes[i]) - nMeanX) * (log(pTimes[i]) - nMeanY);
+        nVariance += (log(pSizes[i]) - nMeanX) * (log(pSizes[i]) - nMeanX);
+    }
+    return nCovariance / nVariance;
+}
+
+const char* bench_depth_bound(const BenchDepthBound* pBounds, int nCount, const char* sShape, const char* sOperation)
+{
+    for (int i = 0; i < nCount; i++)
+        if (strcmp(pBounds[i].Shape, sShape) == 0 && strcmp(pBounds[i].Operation, sOperation) == 0)
+            return pBounds[i].Reason;
+    return 0;
+}
+
+//returns the number of operations that grew faster than their contract, and of depth bound ones that became linear in bytes
+int bench_scaling(int bJson)
+{
+    BenchShape pShapes[] = {
+        { "array", bench_shape_array, { 1000, 3162, 10000, 31623, 100000 } },
+        { "object", bench_shape_object, { 1000, 3162, 10000, 31623, 100000 } },
+        { "deep", bench_shape_deep, { 16, 50, 160, 500, 1600 } },
+        { "strings", bench_shape_strings, { 1000, 3162, 10000, 31623, 100000 } },
+    };
+    //every operation is held to a linear contract in bytes, at any depth, except the paths that read or write the document
+    //with the iterators : a large container does not store its size, so skipping one walks it, and each level pays for the levels below it
+    BenchDepthBound pBounds[] = {
+        { "deep", "iterate", "Json_NextElement and Json_NextProperty skip a large container by walking it, so every level walks all the levels below it" },
+        { "deep", "build", "it reads the document with the iterators, and the writer moves the closing chars of the open scopes after every value" },
+        { "deep", "append", "it reads the document with the iterators, and only the first JSON_APPEND_MAX_DEPTH scopes keep their closing char off the buffer" },
+        { "deep", "equals", "the keys of the twin are in another order, the unordered comparison lists the properties with Json_NextProperty and measures every level" },
+    };
+    //indenting writes and compressing reads the indented text, that grows with size * depth, so they are linear in its size
+    struct { const char* Name; BenchOperation Run; int Indented; } pOperations[] = {
+        { "parse", bench_parse, 0 }, { "events", bench_events, 0 }, { "iterate", bench_iterate, 0 }, { "lookup", bench_lookup, 0 },
+        { "count", bench_count, 0 }, { "index", bench_index, 0 }, { "measure", bench_measure, 0 }, { "equals", bench_equals, 0 },
+        { "hash", bench_hash, 0 }, { "build", bench_build, 0 }, { "append", bench_append, 0 }, { "value", bench_value, 0 },
+        { "edit", bench_edit, 0 }, { "batch", bench_batch, 0 }, { "indent", bench_indent, 1 }, { "compress", bench_compress, 1 },
+    };
+    int nShapes = (int)(sizeof(pShapes) / sizeof(pShapes[0]));
+    int nOperations = (int)(sizeof(pOperations) / sizeof(pOperations[0]));
+    int nBounds = (int)(sizeof(pBounds) / sizeof(pBounds[0]));
+    static double pTimes[24][BENCH_SCALING_STEPS];
+    double pSizes[BENCH_SCALING_STEPS];
+    double pIndentedSizes[BENCH_SCALING_STEPS];
+    double pDepthSizes[BENCH_SCALING_STEPS];//bytes * depth
+    static BenchState oState;
+    int nFailures = 0;
+
+    char* pReport = Json_CreateBuffer();
+    Json_AddArray(&pReport);
+    if (!bJson)
+        printf("%-8s %-9s %12s %12s %9s\n", "shape", "operation", "first ns", "last ns", "exponent");
+    for (int s = 0; s < nShapes; s++)
+    {
+        for (int r = 0; r < BENCH_SCALING_ROUNDS; r++)
+        {
+            for (int k = 0; k < BENCH_SCALING_STEPS; k++)
+            {
+                char pKey[32];
+                BenchCorpus oCorpus;
+                memset(&oCorpus, 0, sizeof(oCorpus));
+                oCorpus.Name = pShapes[s].Name;
+                oCorpus.Text = pShapes[s].Generate(pShapes[s].Sizes[k], &oCorpus.Size);
+                sprintf(pKey, "property_%i", pShapes[s].Sizes[k] - 1);//the last property of the object shape
+                oCorpus.LookupKey = pKey;
+                pSizes[k] = (double)oCorpus.Size;
+                if (!bench_prepare(&oState, &oCorpus))
+                {
+                    bench_release(&oState);
+                    free(oCorpus.Text);
+                    Json_ReleaseBuffer(pReport);
+                    return 1;
+                }
+                pIndentedSizes[k] = (double)strlen(oState.Indented);
+                JsonParseStats oStats;
+                memcpy(oState.Work, oCorpus.Text, oCorpus.Size + 1);
+                Json_ParseWithStats(oState.Work, 0, &oStats);
+                pDepthSizes[k] = pSizes[k] * oStats.MaxDepth;
+                for (int o = 0; o < nOperations; o++)
+                {
+                    //one timed pass decides how many it takes to fill the minimum time
+                    double nStart = bench_now_ns();
+                    pOperations[o].Run(&oState);
+                    double nOnce = bench_now_ns() - nStart;
+                    int nRepetitions = nOnce > 0 ? (int)(BENCH_SCALING_MIN_NS / nOnce) : BENCH_MAX_REPETITIONS;
+                    nRepetitions = nRepetitions < 3 ? 3 : nRepetitions > 200 ? 200 : nRepetitions;
+                    double nTime = bench_run(&oState, pOperations[o].Name, pOperations[o].Run, oCorpus.Size, nRepetitions).Min;
+                    pTimes[o][k] = r == 0 || nTime < pTimes[o][k] ? nTime : pTimes[o][k];
+                }
+                bench_release(&oState);
+                free(oCorpus.Text);
+            }
+        }
+        for (int o = 0; o < nOperations; o++)
+        {
+            double nExponent = bench_fit_exponent(pOperations[o].Indented ? pIndentedSizes : pSizes, pTimes[o], BENCH_SCALING_STEPS);
+            const char* sBound = bench_depth_bound(pBounds, nBounds, pShapes[s].Name, pOperations[o].Name);
+            double nDepthExponent = sBound ? bench_fit_exponent(pDepthSizes, pTimes[o], BENCH_SCALING_STEPS) : 0;
+            int bLinear = nExponent <= 1.0 + BENCH_SCALING_TOLERANCE;
+            int bFixed = sBound && bLinear;//linear in bytes, it must be taken off the list
+            int bFailed = sBound ? bFixed || nDepthExponent > 1.0 + BENCH_SCALING_TOLERANCE : !bLinear;
+            nFailures += bFailed;
+            if (bJson)
+            {
+                Json_AddObject(&pReport);
+                Json_AddPropertyString(&pReport, "shape", pShapes[s].Name);
+                Json_AddPropertyString(&pReport, "operation", pOperations[o].Name);
+                Json_AddPropertyNumberArray(&pReport, "bytes", pOperations[o].Indented ? pIndentedSizes : pSizes, BENCH_SCALING_STEPS);
+                Json_AddPropertyNumberArray(&pReport, "min_ns", pTimes[o], BENCH_SCALING_STEPS);
+                Json_AddPropertyNumber(&pReport, "exponent", nExponent);
+                Json_AddPropertyBool(&pReport, "depth_bound", sBound != 0);
+                if (sBound)
+                {
+                    Json_AddPropertyNumberArray(&pReport, "bytes_times_depth", pDepthSizes, BENCH_SCALING_STEPS);
+                    Json_AddPropertyNumber(&pReport, "depth_exponent", nDepthExponent);
+                    Json_AddPropertyString(&pReport, "reason", sBound);
+                }
+                Json_AddPropertyBool(&pReport, "failed", bFailed);
+                Json_ExitScope(&pReport);
+            }
+            else if (!sBound)
+                printf("%-8s %-9s %12.0f %12.0f %9.2f%s\n", pShapes[s].Name, pOperations[o].Name, pTimes[o][0], pTimes[o][BENCH_SCALING_STEPS - 1], nExponent,
+                    bFailed ? "  SUPER-LINEAR" : "");
+            else
+            {
+                printf("%-8s %-9s %12.0f %12.0f %9.2f  %s %.2f over bytes * depth\n", pShapes[s].Name, pOperations[o].Name, pTimes[o][0], pTimes[o][BENCH_SCALING_STEPS - 1],
+                    nExponent, bFixed ? "FIXED, remove it from the depth bound paths," : bFailed ? "SUPER-LINEAR" : "DEPTH BOUND", nDepthExponent);
+                printf("%22s%s\n", "", sBound);
+            }
+        }
+    }
+    Json_ExitScope(&pReport);
+    if (bJson)
+        printf("%s\n", pReport);
+    Json_ReleaseBuffer(pReport);
+    return nFailures;
+}
+
+int main(int argc, char** argv)
+{
+    int nRepetitions = 20;
+    int bJson = 0;
+    int bScaling = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--json") == 0)
+            bJson = 1;
+        else if (strcmp(argv[i], "--scaling") == 0)
+            bScaling = 1;
+        else if (atoi(argv[i]) > 0)
+            nRepetitions = atoi(argv[i]) < BENCH_MAX_REPETITIONS ? atoi(argv[i]) : BENCH_MAX_REPETITIONS;
+    }
+    if (bScaling)
+        return bench_scaling(bJson) ? 1 : 0;
+
+    BenchCorpus pCorpora[6];
+    memset(pCorpora, 0, sizeof(pCorpora));
+    pCorpora[0].Name = "twitter";
+    pCorpora[0].Text = bench_generate_twitter(&pCorpora[0].Size);
+    pCorpora[0].LookupKey = "retweet_count";
+    pCorpora[1].Name = "numbers";
+    pCorpora[1].Text = bench_generate_numbers(&pCorpora[1].Size);
+    pCorpora[1].LookupKey = "none";
+    pCorpora[2].Name = "logs";
+    pCorpora[2].Text = bench_generate_logs(&pCorpora[2].Size);
+    pCorpora[2].LookupKey = "pid";
+    pCorpora[3].Name = "deep";
+    pCorpora[3].Text = bench_generate_deep(&pCorpora[3].Size);
+    pCorpora[3].LookupKey = "level";
+    pCorpora[4].Name = "wide";
+    pCorpora[4].Text = bench_generate_wide(&pCorpora[4].Size);
+    pCorpora[4].LookupKey = "property_49999";
+    pCorpora[5].Name = "ndjson";
+    pCorpora[5].Text = bench_generate_ndjson(&pCorpora[5].Size, &pCorpora[5].Lines);
+    pCorpora[5].LookupKey = "level";
+
+    static BenchState oState;
+    char* pReport = Json_CreateBuffer();
+    Json_AddArray(&pReport);
+    if (!bJson)
+        printf("%-10s %-10s %10s %14s %14s %14s\n", "corpus", "operation", "MB/s", "p50 ns/op", "p90 ns/op", "p99 ns/op");
+    for (int i = 0; i < 6; i++)
+    {
+        if (!bench_prepare(&oState, &pCorpora[i]))
+        {
+            bench_release(&oState);
+            for (int c = i; c < 6; c++)
+                free(pCorpora[c].Text);
+            Json_ReleaseBuffer(pReport);
+            return 1;
+        }
+        BenchResult pResults[6];
+        int nResults = 0;
+        size_t nSize = pCorpora[i].Size;
+        pResults[nResults++] = bench_run(&oState, "parse", bench_parse, nSize, nRepetitions);
+        pResults[nResults++] = bench_run(&oState, "iterate", bench_iterate, nSize, nRepetitions);
+        pResults[nResults++] = bench_run(&oState, "lookup", bench_lookup, nSize, nRepetitions);
+        pResults[nResults++] = bench_run(&oState, "build", bench_build, nSize, nRepetitions);
+        if (!pCorpora[i].Lines)//a stream of documents is not a single json text
+        {
+            pResults[nResults++] = bench_run(&oState, "indent", bench_indent, nSize, nRepetitions);
+            pResults[nResults++] = bench_run(&oState, "compress", bench_compress, strlen(oState.Indented), nRepetitions);//measured on the indented input
+        }
+        for (int r = 0; r < nResults; r++)
+        {
+            if (bJson)
+                bench_add_result(&pReport, &pResults[r]);
+            else
+                bench_print(&pResults[r]);
+        }
+        bench_release(&oState);
+        free(pCorpora[i].Text);
+    }
+    Json_ExitScope(&pReport);
+    if (bJson)
+        printf("%s\n", pReport);
+    Json_ReleaseBuffer(pReport);
+    return 0;
+}
@@ -1,3 +1,6 @@
+#include <stddef.h>
+#include <stdio.h>
+
 /********************************
 json reading
 *********************************/
@@ -28,13 +31,50 @@ typedef struct JsonResult
 {
     int Success;
     const char* Error;
-    int Index;
-    int InitialSize;
-    int EndSize;
+    long long Index;
+    long long InitialSize;
+    long long EndSize;
     JsonObject RootObject;
 } JsonResult;
 
+typedef enum
+{
+    JsonParseValidateUtf8 = 1,//raw chars of strings must be well formed utf-8
+} JsonParseOption;
+
 JsonResult Json_Parse(char* pJson);
+JsonResult Json_ParseWithOptions(char* pJson, int nOptions);
+
+//what a parse went through, the cycles are only measured when the library is compiled with JSON_PARSE_PROFILE
+typedef struct JsonParseStats
+{
+    long long Nulls;
+    long long Bools;
+    long long Numbers;
+    long long Strings;//string values, keys are counted apart
+    long long Keys;
+    long long SmallObjects;
+    long long LargeObjects;
+    long long SmallArrays;
+    long long LargeArrays;
+    long long SmallStrings;//keys included
+    long long LargeStrings;
+    long long StringBytes;//decoded chars of keys and values
+    long long Escapes;
+    long long Digits;//numbers by the encoding of their mantissa
+    long long Int8s;
+    long long Int16s;
+    long long Int32s;
+    long long Int64s;
+    long long Exponents;//numbers that also carry an exponent marker
+    int MaxDepth;
+    unsigned long long ParseCycles;
+    unsigned long long WhitespaceCycles;
+    unsigned long long StringCycles;//keys included
+    unsigned long long NumberCycles;
+} JsonParseStats;
+
+JsonResult Json_ParseWithStats(char* pJson, int nOptions, JsonParseStats* pStats);
 JsonObject Json_Load(const char* pJson);
 
 typedef struct JsonProperty
@@ -47,19 +87,144 @@ typedef struct JsonProperty
 JsonProperty Json_IterateProperties(JsonObject oJsonObject);
 JsonProperty Json_NextProperty(JsonProperty oJsonProperty);
 JsonProperty Json_GetPropertyByName(JsonObject oJsonObject, char* pName);
-int Json_GetPropertyCount(JsonObject oJsonObject);
+long long Json_GetPropertyCount(JsonObject oJsonObject);
 
 typedef struct JsonElement
 {
     const unsigned char* Position;
-    unsigned int Index;
+    unsigned long long Index;
     JsonObject Value;
 } JsonElement;
 
 JsonElement Json_IterateElements(JsonObject oJsonArray);
 JsonElement Json_NextElement(JsonElement oJsonElement);
-JsonElement Json_GetElementAtIndex(JsonObject oJsonArray, int nIndex);
-int Json_GetElementCount(JsonObject oJsonArray);
+JsonElement Json_GetElementAtIndex(JsonObject oJsonArray, long long nIndex);
+long long Json_GetElementCount(JsonObject oJsonArray);
+
+typedef struct JsonArena
+{
+    char* Memory;
+    long long Size;
+    long long Used;
+} JsonArena;
+
+long long Json_MeasureSubtree(JsonObject oJsonObject);
+JsonObject Json_CopySubtree(JsonObject oJsonObject, char* pBuffer, long long nBufferSize);
+void Json_InitArena(JsonArena* pArena, char* pMemory, long long nSize);
+JsonObject Json_CopySubtreeToArena(JsonArena* pArena, JsonObject oJsonObject);
+int Json_CompactSubtrees(JsonArena* pArena, JsonObject* pObjects, int nCount);
+
+//in place edits of parsed buffers, they return 0 when the new value does not fit the slot of the old one
+int Json_SetNumber(JsonObject* pJsonObject, double nValue);
+int Json_SetBool(JsonObject* pJsonObject, int bValue);
+int Json_SetNull(JsonObject* pJsonObject);
+int Json_SetString(JsonObject* pJsonObject, const char* sValue);
+
+//structural edits of a parsed buffer that has spare capacity after the root value
+typedef struct JsonEditor
+{
+    char* Buffer;
+    long long Size;
+    long long Capacity;
+    const char* Error;
+} JsonEditor;
+
+void Json_InitEditor(JsonEditor* pEditor, char* pBuffer, long long nCapacity);
+int Json_RemoveProperty(JsonEditor* pEditor, JsonObject oJsonObject, const char* sName);
+int Json_RemoveElement(JsonEditor* pEditor, JsonObject oJsonArray, int nIndex);
+int Json_InsertProperty(JsonEditor* pEditor, JsonObject oJsonObject, const char* sName, JsonObject oValue);
+int Json_InsertElement(JsonEditor* pEditor, JsonObject oJsonArray, int nIndex, JsonObject oValue);
+int Json_AppendElement(JsonEditor* pEditor, JsonObject oJsonArray, JsonObject oValue);
+int Json_MoveProperty(JsonEditor* pEditor, JsonObject oSource, const char* sName, JsonObject oDestination);
+int Json_MoveElement(JsonEditor* pEditor, JsonObject oSource, int nIndex, JsonObject oDestination);
+
+typedef struct JsonEdit
+{
+    const unsigned char* Position;
+    long long RemoveSize;
+    const char* Name;
+    const unsigned char* Value;
+    long long InsertSize;
+    long long Offset;
+} JsonEdit;
+
+typedef struct JsonEditBatch
+{
+    JsonEdit* Edits;
+    int Count;
+    int Capacity;
+    const char* Error;
+} JsonEditBatch;
+
+void Json_InitBatch(JsonEditBatch* pBatch, JsonEdit* pEdits, int nCapacity);
+int Json_BatchRemoveProperty(JsonEditBatch* pBatch, JsonObject oJsonObject, const char* sName);
+int Json_BatchRemoveElement(JsonEditBatch* pBatch, JsonObject oJsonArray, int nIndex);
+int Json_BatchInsertProperty(JsonEditBatch* pBatch, JsonObject oJsonObject, const char* sName, JsonObject oValue);
+int Json_BatchAppendElement(JsonEditBatch* pBatch, JsonObject oJsonArray, JsonObject oValue);
+int Json_CommitBatch(JsonEditor* pEditor, JsonEditBatch* pBatch);
+
+//builds the parsed encoding straight into an arena, so in process documents skip the text and Json_Parse
+#define JSON_BUILD_MAX_DEPTH 64
+
+typedef struct JsonBuilder
+{
+    JsonArena* Arena;
+    long long Root;
+    int Depth;
+    long long Starts[JSON_BUILD_MAX_DEPTH];//offset of the marker of each open container
+    int Counts[JSON_BUILD_MAX_DEPTH];//values written in each open container, keys included
+    const char* Error;
+} JsonBuilder;
+
+void Json_InitBuilder(JsonBuilder* pBuilder, JsonArena* pArena);
+int Json_BuildObject(JsonBuilder* pBuilder);
+int Json_BuildArray(JsonBuilder* pBuilder);
+int Json_BuildEnd(JsonBuilder* pBuilder);
+int Json_BuildKey(JsonBuilder* pBuilder, const char* sName);
+int Json_BuildNull(JsonBuilder* pBuilder);
+int Json_BuildBool(JsonBuilder* pBuilder, int bValue);
+int Json_BuildNumber(JsonBuilder* pBuilder, double nValue);
+int Json_BuildInt64(JsonBuilder* pBuilder, long long nValue);
+int Json_BuildString(JsonBuilder* pBuilder, const char* sValue);
+JsonObject Json_BuildFinish(JsonBuilder* pBuilder);
+
+//content comparison, the order of object properties is ignored while the order of array elements is not
+unsigned long long Json_Hash(JsonObject oJson);
+int Json_Equals(JsonObject oLeft, JsonObject oRight);
+
+//event parsing, the text is never written, strings are decoded into the scratch area and are only valid during the callback
+typedef enum
+{
+    JsonEventContinue = 0,
+    JsonEventSkip = 1,//from StartObject, StartArray or Key, jumps over that subtree without reporting it
+    JsonEventAbort = 2,
+} JsonEventAction;
+
+typedef struct JsonEventHandler
+{
+    //every callback is optional and returns a JsonEventAction
+    int (*StartObject)(void* pUser);
+    int (*EndObject)(void* pUser);
+    int (*StartArray)(void* pUser);
+    int (*EndArray)(void* pUser);
+    int (*Key)(void* pUser, const char* sName, int nLength);
+    int (*String)(void* pUser, const char* sValue, int nLength);
+    int (*Number)(void* pUser, double nValue);
+    int (*Bool)(void* pUser, int bValue);
+    int (*Null)(void* pUser);
+    void* User;
+} JsonEventHandler;
+
+JsonResult Json_ParseEvents(const char* pJson, const JsonEventHandler* pHandler, char* pScratch, int nScratchSize);
+
+//MessagePack and CBOR in one pass each way, the writers return the size written or -1 when pDest is too small,
+//containers of more than 63 bytes of markers get a 32 bits count so they are written without looking ahead
+long long Json_ToMessagePack(JsonObject oJson, char* pDest, long long nCapacity);
+long long Json_ToCbor(JsonObject oJson, char* pDest, long long nCapacity);
+//the readers write the parsed encoding into pDest, 4 * nSize bytes are always enough,
+//InitialSize is where the value ends in pData and EndSize what was written in pDest
+JsonResult Json_FromMessagePack(const char* pData, long long nSize, char* pDest, long long nCapacity);
+JsonResult Json_FromCbor(const char* pData, long long nSize, char* pDest, long long nCapacity);
 
 
 
@@ -67,7 +232,27 @@ int Json_GetElementCount(JsonObject oJsonArray);
 json writing
 *********************************/
 
+typedef struct JsonAllocator
+{
+    void* (*Alloc)(void* pUser, size_t nSize);
+    void* (*Realloc)(void* pUser, void* pMemory, size_t nSize);
+    void (*Free)(void* pUser, void* pMemory);
+    void* User;
+} JsonAllocator;
+
 char* Json_CreateBuffer();
+char* Json_CreateBufferWith(const JsonAllocator* pAllocator);
+//pMemory must be aligned for pointers (as from malloc or a long long array), only its first 2GB are used
+char* Json_CreateBufferIn(void* pMemory, size_t nCapacity);
+void Json_ResetBuffer(char* pBuffer);
+
+//streams flush the text to a sink in blocks, so they use the same memory whatever the size of the document
+typedef int (*JsonWriteCallback)(void* pUser, const char* pData, size_t nSize);
+char* Json_CreateStream(JsonWriteCallback fWrite, void* pUser, int nBlockSize);
+char* Json_CreateFileStream(FILE* hFile, int nBlockSize);
+char* Json_CreateFdStream(int nFd, int nBlockSize);
+int Json_CloseStream(char** pBuffer);
+char* Json_CreateAppendBuffer();
 void Json_ReleaseBuffer(char*);
 int Json_AddArray(char** pBuffer);
 int Json_AddObject(char** pBuffer);
@@ -75,6 +260,7 @@ int Json_AddNull(char** pBuffer);
 int Json_AddBool(char** pBuffer, int bValue);
 int Json_AddString(char** pBuffer, const char* sValue);
 int Json_AddNumber(char** pBuffer, double nValue);
+int Json_AddInt64(char** pBuffer, long long nValue);
 
 int Json_AddPropertyArray(char** pBuffer, const char* sName);
 int Json_AddPropertyObject(char** pBuffer, const char* sName);
@@ -82,12 +268,136 @@ int Json_AddPropertyNull(char** pBuffer, const char* sName);
 int Json_AddPropertyBool(char** pBuffer, const char* sName, int bValue);
 int Json_AddPropertyString(char** pBuffer, const char* sName, const char* sValue);
 int Json_AddPropertyNumber(char** pBuffer, const char* sName, double nValue);
+int Json_AddPropertyInt64(char** pBuffer, const char* sName, long long nValue);
+
+//parsed values are written whole and raw text is copied as is, it must be valid json
+int Json_AddValue(char** pBuffer, JsonObject oValue);
+int Json_AddPropertyValue(char** pBuffer, const char* sName, JsonObject oValue);
+int Json_AddRaw(char** pBuffer, const char* pText, int nTextSize);
+int Json_AddPropertyRaw(char** pBuffer, const char* sName, const char* pText, int nTextSize);
+
+//whole arrays in one call, the scope is validated once and the values are formatted in a tight loop
+int Json_AddNumberArray(char** pBuffer, const double* pValues, int nCount);
+int Json_AddInt64Array(char** pBuffer, const long long* pValues, int nCount);
+int Json_AddStringArray(char** pBuffer, const char* const* pValues, int nCount);
+int Json_AddPropertyNumberArray(char** pBuffer, const char* sName, const double* pValues, int nCount);
+int Json_AddPropertyInt64Array(char** pBuffer, const char* sName, const long long* pValues, int nCount);
+int Json_AddPropertyStringArray(char** pBuffer, const char* sName, const char* const* pValues, int nCount);
+
+//fragments hold elements (or members when bMembers is set) written apart, for example on another thread,
+//and are appended to the current scope of a buffer with the commas in place
+char* Json_CreateFragment(int bMembers);
+int Json_AppendFragments(char** pBuffer, char** pFragments, int nCount, int bMembers);
+
+//writes nRecords elements (or members) to the current scope splitting them across threads, the text is the same as a sequential write
+typedef int (*JsonWriteRecord)(char** pBuffer, int nIndex, void* pUser);
+int Json_WriteParallel(char** pBuffer, int nRecords, int bMembers, JsonWriteRecord fWrite, void* pUser, int nThreads);
 
 int Json_ExitScope(char** pBuffer);
+int Json_Finalize(char** pBuffer);
 const char* Json_GetError(char* pBuffer);
 
+//per buffer accounting, only collected when the library is compiled with JSON_BUFFER_STATS
+typedef enum
+{
+    JsonAddKindScope = 0,//objects and arrays, the bulk adds also count the array they open
+    JsonAddKindNull,
+    JsonAddKindBool,
+    JsonAddKindString,
+    JsonAddKindRaw,
+    JsonAddKindNumber,//doubles and int64
+    JsonAddKindValue,
+    JsonAddKindBulk,
+    JsonAddKindFragments,
+    JsonAddKindStruct,
+    JsonAddKindCount,
+} JsonAddKind;
+
+typedef struct JsonBufferStats
+{
+    long long Calls[JsonAddKindCount];//property and element adds together
+    long long Gaps;//times room was made at the insertion point
+    long long Reallocs;
+    long long ReallocBytes;//size of the blocks that were grown, the most realloc may have copied
+    long long BytesMoved;//memmoved to open and close gaps and to drop flushed text
+    long long Flushes;
+    long long PeakCapacity;
+} JsonBufferStats;
+
+//returns 0 and zeroed stats when the library is built without JSON_BUFFER_STATS
+int Json_GetBufferStats(char* pBuffer, JsonBufferStats* pStats);
+
+/********************************
+json struct serializers
+*********************************/
+
+//the fields of a struct are listed once in a X-macro, and a serializer is generated from it
+/*
+#define USER_FIELDS(FIELD) \
+    FIELD(User, id, Int64) \
+    FIELD(User, name, String) \
+    FIELD(User, score, Number)
+JSON_DEFINE_SERIALIZER(User, USER_FIELDS)
+*/
+//generates Json_AddUser(char** pBuffer, const User* pValue) and Json_AddPropertyUser(char** pBuffer, const char* sName, const User* pValue)
+//the keys are escaped at compile time (field names are identifiers, nothing to escape) and the size of the output is bounded
+//at compile time except for the strings, so writing a struct is one gap, a memcpy per key and the formatting of the values
+typedef enum
+{
+    JsonFieldInt = 0,//int
+    JsonFieldInt64 = 1,//long long
+    JsonFieldNumber = 2,//double
+    JsonFieldBool = 3,//int, 0 is false
+    JsonFieldString = 4,//const char*, a null pointer is written as null
+} JsonFieldType;
+
+typedef struct JsonFieldDescriptor
+{
+    const char* Key;//,"<name>":
+    int KeySize;
+    JsonFieldType Type;
+    size_t Offset;
+} JsonFieldDescriptor;
+
+int Json_AddStruct(char** pBuffer, const char* sName, const void* pValue, const JsonFieldDescriptor* pFields, int nFields, int nFixedSize);
+
+#define JSON_FIELD_BOUND_Int 11
+#define JSON_FIELD_BOUND_Int64 20
+#define JSON_FIELD_BOUND_Number 25
+#define JSON_FIELD_BOUND_Bool 5
+#define JSON_FIELD_BOUND_String 4//null, the text of the strings is added when written
+
+#define JSON_FIELD_DESCRIPTOR(Type, Field, Kind) { ",\"" #Field "\":", sizeof(",\"" #Field "\":") - 1, JsonField##Kind, offsetof(Type, Field) },
+#define JSON_FIELD_FIXED_SIZE(Type, Field, Kind) + (sizeof(",\"" #Field "\":") - 1) + JSON_FIELD_BOUND_##Kind
+
+#define JSON_DEFINE_SERIALIZER(Type, FIELDS) \
+    static const JsonFieldDescriptor Json_##Type##_Fields[] = { FIELDS(JSON_FIELD_DESCRIPTOR) }; \
+    enum { Json_##Type##_FixedSize = 2 FIELDS(JSON_FIELD_FIXED_SIZE) }; \
+    static inline int Json_Add##Type(char** pBuffer, const Type* pValue) \
+    { \
+        return Json_AddStruct(pBuffer, 0, pValue, Json_##Type##_Fields, (int)(sizeof(Json_##Type##_Fields) / sizeof(JsonFieldDescriptor)), Json_##Type##_FixedSize); \
+    } \
+    static inline int Json_AddProperty##Type(char** pBuffer, const char* sName, const Type* pValue) \
+    { \
+        return Json_AddStruct(pBuffer, sName, pValue, Json_##Type##_Fields, (int)(sizeof(Json_##Type##_Fields) / sizeof(JsonFieldDescriptor)), Json_##Type##_FixedSize); \
+    }
+
 /********************************
 json format
 *********************************/
+typedef struct JsonFormatStyle
+{
+    int IndentWidth;
+    char IndentChar;
+    const char* Colon;//written between a key and its value
+    const char* NewLine;
+} JsonFormatStyle;
+
+JsonFormatStyle Json_DefaultFormatStyle();
+//a null style is the default one, 4 spaces and " : "
+int Json_FormatTo(const char* pJson, const JsonFormatStyle* pStyle, JsonWriteCallback fWrite, void* pUser);
+long long Json_FormatInto(const char* pJson, const JsonFormatStyle* pStyle, char* pDest, long long nCapacity);
 char* Json_Indent(char*);
-char* Json_Compress(char* pChar);
\ No newline at end of file
+char* Json_Compress(char* pChar);
+//pDest needs as much room as the source, it may be the source itself
+long long Json_CompressInto(const char* pJson, char* pDest);
\ No newline at end of file
@@ -0,0 +1,253 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+
+#include "json.h"
+
+typedef  signed char        int8;
+typedef  unsigned char      uint8;
+typedef  signed short       int16;
+typedef  unsigned short     uint16;
+typedef  signed int         int32;
+typedef  unsigned int       uint32;
+typedef  signed long long   int64;
+typedef  unsigned long long uint64;
+
+typedef  unsigned char      bool;
+typedef  unsigned char      byte;
+
+//same encoding as json_read.c
+typedef enum
+{
+    JsonMarkerSmallString = 0b00000001,//6bits reserved
+    JsonMarkerSmallObject = 0b00000010,//6bits reserved
+    JsonMarkerSmallArray = 0b00000011,//6bits reserved
+    JsonMarkerExponent = 0b00000100,//5bits reserved
+    JsonMarkerDigit = 0b00001000,//4bits reserved
+    JsonMarkerInt = 0b00010000,//3bits reserved
+    JsonMarkerLargeString = 0b10000000,
+    JsonMarkerLargeObject = 0b10100000,
+    JsonMarkerLargeArray = 0b11000000,
+    JsonMarkerSequenceEnd = 0b11100000,
+    JsonMarkerNull = 0b00100000,
+    JsonMarkerTrue = 0b01000000,
+    JsonMarkerFalse = 0b01100000,
+} JsonMarker;
+
+//implemented in json_read.c
+JsonObject Json_LoadUnkown(const byte* pJson);
+int Json_SizeOfMantissa(long long nMantissa);
+byte* Json_WriteNumberMarkers(byte* pWrite, long long nMantissa, long long nExponent, int bWriteExponent, int nMantissaSize);
+int Json_DecomposeNumber(double nValue, long long* pMantissa, long long* pExponent);
+
+/*************************
+ * direct builder
+ * values are appended to the arena already in the parsed encoding, each container remembers where its marker is
+ * and gets its size when it is closed, exactly like Json_ParseObject / Json_ParseArray do
+**************************/
+
+void Json_InitBuilder(JsonBuilder* pBuilder, JsonArena* pArena)
+{
+    pBuilder->Arena = pArena;
+    pBuilder->Root = pArena->Used;
+    pBuilder->Depth = 0;
+    pBuilder->Starts[0] = pArena->Used;
+    pBuilder->Counts[0] = 0;
+    pBuilder->Error = 0;
+}
+
+byte* Json_BuildReserve(JsonBuilder* pBuilder, long long nSize)
+{
+    JsonArena* pArena = pBuilder->Arena;
+    if (pArena->Size - pArena->Used < nSize)
+    {
+        pBuilder->Error = "Out of space in the arena";
+        return 0;
+    }
+    byte* pWrite = (byte*)pArena->Memory + pArena->Used;
+    pArena->Used += nSize;
+    return pWrite;
+}
+
+//checks a value can be added at the current scope, and counts it
+int Json_BuildBeginValue(JsonBuilder* pBuilder)
+{
+    if (pBuilder->Error)
+        return 0;
+    int nDepth = pBuilder->Depth;
+    if (nDepth == 0 && pBuilder->Counts[0] > 0)
+        pBuilder->Error = "Only one value can be root of a json document";
+    else if (nDepth > 0 && (*((byte*)pBuilder->Arena->Memory + pBuilder->Starts[nDepth]) == JsonMarkerLargeObject) && (pBuilder->Counts[nDepth] % 2) == 0)
+        pBuilder->Error = "Inside an object scope you must add a key before the value";
+    if (pBuilder->Error)
+        return 0;
+    pBuilder->Counts[nDepth]++;
+    return 1;
+}
+
+int Json_BuildContainer(JsonBuilder* pBuilder, byte nMarker)
+{
+    if (pBuilder->Depth + 1 >= JSON_BUILD_MAX_DEPTH)
+    {
+        pBuilder->Error = "Too many nested scopes";
+        return 0;
+    }
+    if (!Json_BuildBeginValue(pBuilder))
+        return 0;
+    byte* pWrite = Json_BuildReserve(pBuilder, 1);
+    if (!pWrite)
+        return 0;
+    *pWrite = nMarker;//the large marker is kept until the end, it tells objects from arrays
+    pBuilder->Depth++;
+    pBuilder->Starts[pBuilder->Depth] = pWrite - (byte*)pBuilder->Arena->Memory;
+    pBuilder->Counts[pBuilder->Depth] = 0;
+    return 1;
+}
+
+int Json_BuildObject(JsonBuilder* pBuilder)
+{
+    return Json_BuildContainer(pBuilder, JsonMarkerLargeObject);
+}
+
+int Json_BuildArray(JsonBuilder* pBuilder)
+{
+    return Json_BuildContainer(pBuilder, JsonMarkerLargeArray);
+}
+
+int Json_BuildEnd(JsonBuilder* pBuilder)
+{
+    if (pBuilder->Error)
+        return 0;
+    if (pBuilder->Depth == 0)
+    {
+        pBuilder->Error = "Not inside a valid scope";
+        return 0;
+    }
+    byte* pMarker = (byte*)pBuilder->Arena->Memory + pBuilder->Starts[pBuilder->Depth];
+    int bIsObject = *pMarker == JsonMarkerLargeObject;
+    if (bIsObject && (pBuilder->Counts[pBuilder->Depth] % 2) != 0)
+    {
+        pBuilder->Error = "Missing value after key";
+        return 0;
+    }
+    byte* pWrite = Json_BuildReserve(pBuilder, 1);
+    if (!pWrite)
+        return 0;
+    *pWrite = JsonMarkerSequenceEnd;
+    long long nLen = pWrite + 1 - pMarker;
+    if (nLen <= 63)
+        *pMarker = (byte)((nLen << 2) | (bIsObject ? JsonMarkerSmallObject : JsonMarkerSmallArray));
+    pBuilder->Depth--;
+    return 1;
+}
+
+int Json_BuildStringMarkers(JsonBuilder* pBuilder, const char* sValue)
+{
+    long long nLength = (long long)strlen(sValue);
+    byte* pWrite = Json_BuildReserve(pBuilder, nLength + 2);
+    if (!pWrite)
+        return 0;
+    if (nLength + 2 <= 63)
+        *pWrite = (byte)(((nLength + 2) << 2) | JsonMarkerSmallString);
+    else
+        *pWrite = JsonMarkerLargeString;
+    memcpy(pWrite + 1, sValue, nLength + 1);//include terminating null
+    return 1;
+}
+
+int Json_BuildKey(JsonBuilder* pBuilder, const char* sName)
+{
+    if (pBuilder->Error)
+        return 0;
+    int nDepth = pBuilder->Depth;
+    if (nDepth == 0 || *((byte*)pBuilder->Arena->Memory + pBuilder->Starts[nDepth]) != JsonMarkerLargeObject)
+        pBuilder->Error = "Keys can only be added inside an object scope";
+    else if ((pBuilder->Counts[nDepth] % 2) != 0)
+        pBuilder->Error = "Missing value after key";
+    if (pBuilder->Error)
+        return 0;
+    pBuilder->Counts[nDepth]++;
+    return Json_BuildStringMarkers(pBuilder, sName);
+}
+
+int Json_BuildString(JsonBuilder* pBuilder, const char* sValue)
+{
+    if (!Json_BuildBeginValue(pBuilder))
+        return 0;
+    return Json_BuildStringMarkers(pBuilder, sValue);
+}
+
+int Json_BuildMarker(JsonBuilder* pBuilder, byte nMarker)
+{
+    if (!Json_BuildBeginValue(pBuilder))
+        return 0;
+    byte* pWrite = Json_BuildReserve(pBuilder, 1);
+    if (!pWrite)
+        return 0;
+    *pWrite = nMarker;
+    return 1;
+}
+
+int Json_BuildNull(JsonBuilder* pBuilder)
+{
+    return Json_BuildMarker(pBuilder, JsonMarkerNull);
+}
+
+int Json_BuildBool(JsonBuilder* pBuilder, int bValue)
+{
+    return Json_BuildMarker(pBuilder, bValue ? JsonMarkerTrue : JsonMarkerFalse);
+}
+
+int Json_BuildNumberMarkers(JsonBuilder* pBuilder, long long nMantissa, long long nExponent)
+{
+    int nMantissaSize = Json_SizeOfMantissa(nMantissa);
+    if (nMantissaSize == 0)
+    {
+        pBuilder->Error = "numeric value out of range";
+        return 0;
+    }
+    byte* pWrite = Json_BuildReserve(pBuilder, (nExponent != 0) + nMantissaSize);
+    if (!pWrite)
+        return 0;
+    Json_WriteNumberMarkers(pWrite, nMantissa, nExponent, nExponent != 0, nMantissaSize);
+    return 1;
+}
+
+int Json_BuildNumber(JsonBuilder* pBuilder, double nValue)
+{
+    long long nMantissa = 0;
+    long long nExponent = 0;
+    if (!Json_BuildBeginValue(pBuilder))
+        return 0;
+    if (!Json_DecomposeNumber(nValue, &nMantissa, &nExponent))
+    {
+        pBuilder->Error = "Number can't be encoded";
+        return 0;
+    }
+    return Json_BuildNumberMarkers(pBuilder, nMantissa, nExponent);
+}
+
+int Json_BuildInt64(JsonBuilder* pBuilder, long long nValue)
+{
+    if (Json_SizeOfMantissa(nValue) == 0)//the extremes of int64 only fit with an exponent
+        return Json_BuildNumber(pBuilder, (double)nValue);
+    if (!Json_BuildBeginValue(pBuilder))
+        return 0;
+    return Json_BuildNumberMarkers(pBuilder, nValue, 0);
+}
+
+JsonObject Json_BuildFinish(JsonBuilder* pBuilder)
+{
+    JsonObject oJson;
+    oJson.Position = 0;
+    oJson.Type = JsonTypeInvalid;
+    if (!pBuilder->Error && pBuilder->Depth != 0)
+        pBuilder->Error = "Some scopes were not closed";
+    if (!pBuilder->Error && pBuilder->Counts[0] == 0)
+        pBuilder->Error = "Nothing was built";
+    if (pBuilder->Error)
+        return oJson;
+    return Json_LoadUnkown((byte*)pBuilder->Arena->Memory + pBuilder->Root);
+}
@@ -0,0 +1,247 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+
+#include "json.h"
+
+typedef  signed char        int8;
+typedef  unsigned char      uint8;
+typedef  signed short       int16;
+typedef  unsigned short     uint16;
+typedef  signed int         int32;
+typedef  unsigned int       uint32;
+typedef  signed long long   int64;
+typedef  unsigned long long uint64;
+
+typedef  unsigned char      bool;
+typedef  unsigned char      byte;
+
+//same encoding as json_read.c, the hash only needs to find where a container ends
+typedef enum
+{
+    JsonMarkerSequenceEnd = 0b11100000,
+} JsonMarker;
+
+//implemented in json_read.c
+uint64 Json_GetSize(const byte* pJson);
+JsonObject Json_LoadUnkown(const byte* pJson);
+
+#define JSON_HASH_PRIME1 0x9E3779B185EBCA87ULL
+#define JSON_HASH_PRIME2 0xC2B2AE3D27D4EB4FULL
+#define JSON_HASH_PRIME3 0x165667B19E3779F9ULL
+
+//a function and not a macro, so the hash passed to it is only computed once
+static inline uint64 rotl64(uint64 nValue, int nShift)
+{
+    return (nValue << nShift) | (nValue >> (64 - nShift));
+}
+
+uint64 Json_MixHash(uint64 nHash)
+{
+    nHash ^= nHash >> 33;
+    nHash *= 0xff51afd7ed558ccdULL;
+    nHash ^= nHash >> 33;
+    nHash *= 0xc4ceb9fe1a85ec53ULL;
+    nHash ^= nHash >> 33;
+    return nHash;
+}
+
+uint64 Json_ReadWord(const byte* pData)
+{
+    uint64 nWord;
+    memcpy(&nWord, pData, 8);//unaligned safe, compiles to a single load
+    return nWord;
+}
+
+uint64 Json_HashBytes(const byte* pData, size_t nSize, uint64 nSeed)
+{
+    const byte* pEnd = pData + nSize;
+    uint64 nHash = nSeed + JSON_HASH_PRIME3 + nSize;
+    if (nSize >= 32)
+    {
+        //4 independent lanes, so the multiplications don't wait on each other and the loop can be vectorized
+        uint64 pLanes[4] = { nSeed + JSON_HASH_PRIME1, nSeed + JSON_HASH_PRIME2, nSeed, nSeed - JSON_HASH_PRIME1 };
+        while (pData + 32 <= pEnd)
+        {
+            for (int i = 0; i < 4; i++)
+            {
+                pLanes[i] += Json_ReadWord(pData + i * 8) * JSON_HASH_PRIME2;
+                pLanes[i] = rotl64(pLanes[i], 31) * JSON_HASH_PRIME1;
+            }
+            pData += 32;
+        }
+        nHash += rotl64(pLanes[0], 1) + rotl64(pLanes[1], 7) + rotl64(pLanes[2], 12) + rotl64(pLanes[3], 18);
+    }
+    while (pData + 8 <= pEnd)
+    {
+        nHash ^= rotl64(Json_ReadWord(pData) * JSON_HASH_PRIME2, 31) * JSON_HASH_PRIME1;
+        nHash = rotl64(nHash, 27) * JSON_HASH_PRIME1 + JSON_HASH_PRIME3;
+        pData += 8;
+    }
+    while (pData < pEnd)
+    {
+        nHash ^= (*pData++) * JSON_HASH_PRIME3;
+        nHash = rotl64(nHash, 11) * JSON_HASH_PRIME1;
+    }
+    return Json_MixHash(nHash);
+}
+
+uint64 Json_HashScalar(JsonObject oJson)
+{
+    uint64 nHash = Json_MixHash(oJson.Type + JSON_HASH_PRIME3);//different types never collide by design
+    switch (oJson.Type)
+    {
+        case JsonTypeNull:
+            return nHash;
+        case JsonTypeBool:
+            return Json_MixHash(nHash + oJson.BoolValue);
+        case JsonTypeNumber:
+        {
+            double nValue = oJson.DoubleValue == 0 ? 0 : oJson.DoubleValue;//-0 equals 0
+            uint64 nBits;
+            memcpy(&nBits, &nValue, 8);
+            return Json_MixHash(nHash ^ nBits);
+        }
+        case JsonTypeString:
+            return Json_HashBytes((const byte*)oJson.StringValue, strlen(oJson.StringValue), nHash);
+        default:
+            return 0;
+    }
+}
+
+//hashes the value at the marker and returns the marker after it, the children of a container are walked in one pass
+//instead of going through the iterators, that skip each child by walking it again and make nested containers cost size * depth
+const byte* Json_HashMarkers(const byte* pJson, uint64* pHash)
+{
+    JsonObject oJson = Json_LoadUnkown(pJson);
+    if (oJson.Type != JsonTypeArray && oJson.Type != JsonTypeObject)
+    {
+        *pHash = Json_HashScalar(oJson);
+        return pJson + Json_GetSize(pJson);
+    }
+    uint64 nHash = Json_MixHash(oJson.Type + JSON_HASH_PRIME3);
+    uint64 nMembers = 0;
+    const byte* pChild = pJson + 1;
+    while (*pChild != JsonMarkerSequenceEnd)
+    {
+        uint64 nChildHash = 0;
+        if (oJson.Type == JsonTypeArray)
+        {
+            //elements are combined in sequence, so order changes the hash
+            pChild = Json_HashMarkers(pChild, &nChildHash);
+            nHash = rotl64(nHash ^ nChildHash, 27) * JSON_HASH_PRIME1 + JSON_HASH_PRIME2;
+        }
+        else
+        {
+            //members are combined with a sum, so the order of the properties doesn't matter
+            const char* sName = (const char*)pChild + 1;
+            uint64 nNameHash = Json_HashBytes((const byte*)sName, strlen(sName), JSON_HASH_PRIME1);
+            pChild = Json_HashMarkers(pChild + Json_GetSize(pChild), &nChildHash);
+            nMembers += Json_MixHash(nNameHash ^ rotl64(nChildHash, 32));
+        }
+    }
+    *pHash = oJson.Type == JsonTypeArray ? Json_MixHash(nHash) : Json_MixHash(nHash ^ nMembers);
+    return pChild + 1;
+}
+
+unsigned long long Json_Hash(JsonObject oJson)
+{
+    if (oJson.Type != JsonTypeArray && oJson.Type != JsonTypeObject)
+        return Json_HashScalar(oJson);
+    uint64 nHash = 0;
+    Json_HashMarkers(oJson.Position, &nHash);
+    return nHash;
+}
+
+//orders properties by name, and the ones with the same name by their place in the object
+int Json_CompareProperties(const void* pLeft, const void* pRight)
+{
+    const JsonProperty* pLeftProperty = (const JsonProperty*)pLeft;
+    const JsonProperty* pRightProperty = (const JsonProperty*)pRight;
+    int nComparison = strcmp(pLeftProperty->Name, pRightProperty->Name);
+    if (nComparison != 0)
+        return nComparison;
+    return pLeftProperty->Position < pRightProperty->Position ? -1 : pLeftProperty->Position > pRightProperty->Position;
+}
+
+//compares the nCount properties from oLeftProperty and from oRightProperty regardless of their order,
+//both sides are sorted by name once so the cost is n log n instead of a search by name for every property
+int Json_EqualsUnordered(JsonProperty oLeftProperty, JsonProperty oRightProperty, long long nCount)
+{
+    JsonProperty* pLeft = (JsonProperty*)malloc(sizeof(JsonProperty) * nCount);
+    JsonProperty* pRight = (JsonProperty*)malloc(sizeof(JsonProperty) * nCount);
+    int bEquals = pLeft && pRight;
+    for (long long i = 0; bEquals && i < nCount; i++)
+    {
+        pLeft[i] = oLeftProperty;
+        pRight[i] = oRightProperty;
+        oLeftProperty = Json_NextProperty(oLeftProperty);
+        oRightProperty = Json_NextProperty(oRightProperty);
+    }
+    if (bEquals)
+    {
+        qsort(pLeft, nCount, sizeof(JsonProperty), Json_CompareProperties);
+        qsort(pRight, nCount, sizeof(JsonProperty), Json_CompareProperties);
+    }
+    for (long long i = 0; bEquals && i < nCount; i++)
+        bEquals = strcmp(pLeft[i].Name, pRight[i].Name) == 0 && Json_Equals(pLeft[i].Value, pRight[i].Value);
+    free(pLeft);
+    free(pRight);
+    return bEquals;
+}
+
+int Json_Equals(JsonObject oLeft, JsonObject oRight)
+{
+    if (oLeft.Type != oRight.Type || oLeft.Type == JsonTypeInvalid)
+        return 0;
+    //identical encodings are identical values, this is the common case for deduplication
+    uint64 nLeftSize = Json_GetSize(oLeft.Position);
+    if (oLeft.Position == oRight.Position
+        || (nLeftSize == Json_GetSize(oRight.Position) && memcmp(oLeft.Position, oRight.Position, nLeftSize) == 0))
+        return 1;
+    switch (oLeft.Type)
+    {
+        case JsonTypeNull:
+            return 1;
+        case JsonTypeBool:
+            return oLeft.BoolValue == oRight.BoolValue;
+        case JsonTypeNumber:
+            return oLeft.DoubleValue == oRight.DoubleValue;
+        case JsonTypeString:
+            return strcmp(oLeft.StringValue, oRight.StringValue) == 0;
+        case JsonTypeArray:
+        {
+            JsonElement oLeftElement = Json_IterateElements(oLeft);
+            JsonElement oRightElement = Json_IterateElements(oRight);
+            while (oLeftElement.Value.Type != JsonTypeInvalid && oRightElement.Value.Type != JsonTypeInvalid)
+            {
+                if (!Json_Equals(oLeftElement.Value, oRightElement.Value))
+                    return 0;
+                oLeftElement = Json_NextElement(oLeftElement);
+                oRightElement = Json_NextElement(oRightElement);
+            }
+            return oLeftElement.Value.Type == oRightElement.Value.Type;//both must have ended
+        }
+        case JsonTypeObject:
+        {
+            long long nCount = Json_GetPropertyCount(oLeft);
+            if (nCount != Json_GetPropertyCount(oRight))
+                return 0;
+            //walk both in parallel while the names match, once the order differs the rest is compared sorted by name
+            JsonProperty oLeftProperty = Json_IterateProperties(oLeft);
+            JsonProperty oRightProperty = Json_IterateProperties(oRight);
+            for (; oLeftProperty.Value.Type != JsonTypeInvalid; oLeftProperty = Json_NextProperty(oLeftProperty), oRightProperty = Json_NextProperty(oRightProperty), nCount--)
+            {
+                if (strcmp(oLeftProperty.Name, oRightProperty.Name) != 0)
+                    return Json_EqualsUnordered(oLeftProperty, oRightProperty, nCount);
+                if (!Json_Equals(oLeftProperty.Value, oRightProperty.Value))
+                    return 0;
+            }
+            return 1;
+        }
+        default:
+            return 0;
+    }
+}
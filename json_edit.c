@@ -0,0 +1,528 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+
+#include "json.h"
+
+typedef  signed char        int8;
+typedef  unsigned char      uint8;
+typedef  signed short       int16;
+typedef  unsigned short     uint16;
+typedef  signed int         int32;
+typedef  unsigned int       uint32;
+typedef  signed long long   int64;
+typedef  unsigned long long uint64;
+
+typedef  unsigned char      bool;
+typedef  unsigned char      byte;
+
+//same encoding as json_read.c
+typedef enum
+{
+    JsonMarkerSmallString = 0b00000001,//6bits reserved
+    JsonMarkerSmallObject = 0b00000010,//6bits reserved
+    JsonMarkerSmallArray = 0b00000011,//6bits reserved
+    JsonMarkerExponent = 0b00000100,//5bits reserved
+    JsonMarkerDigit = 0b00001000,//4bits reserved
+    JsonMarkerInt = 0b00010000,//3bits reserved
+    JsonMarkerLargeString = 0b10000000,
+    JsonMarkerLargeObject = 0b10100000,
+    JsonMarkerLargeArray = 0b11000000,
+    JsonMarkerSequenceEnd = 0b11100000,
+    JsonMarkerNull = 0b00100000,
+    JsonMarkerTrue = 0b01000000,
+    JsonMarkerFalse = 0b01100000,
+} JsonMarker;
+
+//implemented in json_read.c
+uint64 Json_GetSize(const byte* pJson);
+JsonObject Json_LoadUnkown(const byte* pJson);
+int Json_SizeOfMantissa(long long nMantissa);
+byte* Json_WriteNumberMarkers(byte* pWrite, long long nMantissa, long long nExponent, int bWriteExponent, int nMantissaSize);
+int Json_DecomposeNumber(double nValue, long long* pMantissa, long long* pExponent);
+
+/*************************
+ * in place scalar edits
+ * a value is only rewritten when the new encoding has exactly the size of the old one (the slot),
+ * that way no other byte of the buffer is moved and the container sizes remain valid
+**************************/
+
+int Json_GetSlotSize(JsonObject* pJsonObject)
+{
+    if (pJsonObject->Position == 0)
+        return 0;
+    if (pJsonObject->Type == JsonTypeInvalid || pJsonObject->Type == JsonTypeObject || pJsonObject->Type == JsonTypeArray)
+        return 0;//only scalars are replaced in place
+    return (int)Json_GetSize(pJsonObject->Position);
+}
+
+int Json_SetNumber(JsonObject* pJsonObject, double nValue)
+{
+    int nSlotSize = Json_GetSlotSize(pJsonObject);
+    long long nMantissa = 0;
+    long long nExponent = 0;
+    if (nSlotSize == 0 || !Json_DecomposeNumber(nValue, &nMantissa, &nExponent))
+        return 0;
+
+    //the mantissa can always be written wider than needed, and a 0 exponent can be added, to fill the slot
+    int nMinimumSize = Json_SizeOfMantissa(nMantissa);
+    int pSizes[] = { 1, 2, 3, 5, 9 };
+    for (int bWriteExponent = (nExponent != 0); bWriteExponent <= 1; bWriteExponent++)
+        for (int i = 0; i < 5; i++)
+        {
+            if (pSizes[i] < nMinimumSize || (pSizes[i] == 1 && nMinimumSize != 1))
+                continue;
+            if (bWriteExponent + pSizes[i] != nSlotSize)
+                continue;
+            Json_WriteNumberMarkers((byte*)pJsonObject->Position, nMantissa, nExponent, bWriteExponent, pSizes[i]);
+            *pJsonObject = Json_LoadUnkown(pJsonObject->Position);
+            return 1;
+        }
+    return 0;
+}
+
+int Json_SetBool(JsonObject* pJsonObject, int bValue)
+{
+    if (Json_GetSlotSize(pJsonObject) != 1)
+        return 0;
+    *((byte*)pJsonObject->Position) = bValue ? JsonMarkerTrue : JsonMarkerFalse;
+    *pJsonObject = Json_LoadUnkown(pJsonObject->Position);
+    return 1;
+}
+
+int Json_SetNull(JsonObject* pJsonObject)
+{
+    if (Json_GetSlotSize(pJsonObject) != 1)
+        return 0;
+    *((byte*)pJsonObject->Position) = JsonMarkerNull;
+    *pJsonObject = Json_LoadUnkown(pJsonObject->Position);
+    return 1;
+}
+
+int Json_SetString(JsonObject* pJsonObject, const char* sValue)
+{
+    int nSlotSize = Json_GetSlotSize(pJsonObject);
+    int nSize = (int)strlen(sValue) + 2;//marker + chars + null
+    if (nSlotSize == 0 || nSize > nSlotSize)
+        return 0;
+    byte* pSlot = (byte*)pJsonObject->Position;
+    if (nSlotSize <= 63)//the small string keeps the slot size in the marker, the tail is padded with nulls
+    {
+        memcpy(pSlot + 1, sValue, nSize - 1);
+        memset(pSlot + nSize, 0, nSlotSize - nSize);
+        *pSlot = (byte)((nSlotSize << 2) | JsonMarkerSmallString);
+    }
+    else if (nSize == nSlotSize)//large strings are measured by their length, so it must be the same
+    {
+        memcpy(pSlot + 1, sValue, nSize - 1);
+        *pSlot = JsonMarkerLargeString;
+    }
+    else
+        return 0;
+    *pJsonObject = Json_LoadUnkown(pJsonObject->Position);
+    return 1;
+}
+
+/*************************
+ * structural edits
+ * the editor owns a parsed buffer with some spare capacity after the root value,
+ * values are removed/inserted by moving the suffix of the buffer and then fixing the size of every enclosing container
+ * (small containers store their size in the marker, and switch to/from large markers when crossing 63 bytes)
+ * any JsonObject taken from the buffer before an edit must be fetched again after it
+**************************/
+
+#define JSON_EDIT_MAX_DEPTH 256
+
+void Json_InitEditor(JsonEditor* pEditor, char* pBuffer, long long nCapacity)
+{
+    pEditor->Buffer = pBuffer;
+    pEditor->Capacity = nCapacity;
+    pEditor->Size = (long long)Json_GetSize((byte*)pBuffer);
+    pEditor->Error = 0;
+}
+
+void Json_SetContainerSize(byte* pContainer, uint64 nSize)
+{
+    int bIsObject = *pContainer == JsonMarkerLargeObject || (*pContainer & 0x3) == JsonMarkerSmallObject;
+    if (nSize <= 63)
+        *pContainer = (byte)((nSize << 2) | (bIsObject ? JsonMarkerSmallObject : JsonMarkerSmallArray));
+    else
+        *pContainer = bIsObject ? JsonMarkerLargeObject : JsonMarkerLargeArray;
+}
+
+int Json_IsContainer(const byte* pJson)
+{
+    byte nType = *pJson;
+    return (nType & 0x3) == JsonMarkerSmallObject || (nType & 0x3) == JsonMarkerSmallArray
+        || nType == JsonMarkerLargeObject || nType == JsonMarkerLargeArray;
+}
+
+//collects every container that encloses pPosition, from the root down, with their current sizes
+int Json_FindAncestors(byte* pRoot, const byte* pPosition, byte** pAncestors, uint64* pSizes)
+{
+    int nDepth = 0;
+    byte* pContainer = pRoot;
+    while (pContainer && Json_IsContainer(pContainer))
+    {
+        uint64 nSize = Json_GetSize(pContainer);
+        if (pPosition <= pContainer || pPosition >= pContainer + nSize)
+            break;
+        if (nDepth == JSON_EDIT_MAX_DEPTH)
+            return -1;
+        pAncestors[nDepth] = pContainer;
+        pSizes[nDepth] = nSize;
+        nDepth++;
+
+        byte* pChild = pContainer + 1;
+        pContainer = 0;
+        while (*pChild != JsonMarkerSequenceEnd)
+        {
+            uint64 nChildSize = Json_GetSize(pChild);
+            if (pPosition > pChild && pPosition < pChild + nChildSize)
+            {
+                pContainer = pChild;
+                break;
+            }
+            pChild += nChildSize;
+        }
+    }
+    return nDepth;
+}
+
+//replaces nRemove bytes at pPosition by a gap of nInsert bytes, that must be filled by the caller
+int Json_ResizeRange(JsonEditor* pEditor, byte* pPosition, long long nRemove, long long nInsert)
+{
+    byte* pAncestors[JSON_EDIT_MAX_DEPTH];
+    uint64 pSizes[JSON_EDIT_MAX_DEPTH];
+    int nDepth = Json_FindAncestors((byte*)pEditor->Buffer, pPosition, pAncestors, pSizes);
+    if (nDepth < 0)
+    {
+        pEditor->Error = "Document is too deep to edit";
+        return 0;
+    }
+    long long nDelta = nInsert - nRemove;
+    if (pEditor->Size + nDelta > pEditor->Capacity)
+    {
+        pEditor->Error = "Not enough capacity in the buffer";
+        return 0;
+    }
+    byte* pBufferEnd = (byte*)pEditor->Buffer + pEditor->Size;
+    memmove(pPosition + nInsert, pPosition + nRemove, pBufferEnd - (pPosition + nRemove));
+    if (nDelta < 0)
+        memset(pBufferEnd + nDelta, 0, -nDelta);//same as the parser, unused bytes are zeroed
+    for (int i = 0; i < nDepth; i++)//the markers are all before pPosition so they did not move
+        Json_SetContainerSize(pAncestors[i], pSizes[i] + nDelta);
+    pEditor->Size += nDelta;
+    pEditor->Error = 0;
+    return 1;
+}
+
+int Json_SizeOfKey(const char* sName)
+{
+    return (int)strlen(sName) + 2;//marker + chars + null
+}
+void Json_WriteKey(byte* pWrite, const char* sName)
+{
+    int nSize = Json_SizeOfKey(sName);
+    *pWrite = nSize <= 63 ? (byte)((nSize << 2) | JsonMarkerSmallString) : JsonMarkerLargeString;
+    memcpy(pWrite + 1, sName, nSize - 1);
+}
+
+byte* Json_GetSequenceEnd(JsonObject oJsonObject)
+{
+    return (byte*)oJsonObject.Position + Json_GetSize(oJsonObject.Position) - 1;
+}
+
+int Json_RemoveProperty(JsonEditor* pEditor, JsonObject oJsonObject, const char* sName)
+{
+    JsonProperty oProperty = Json_GetPropertyByName(oJsonObject, (char*)sName);
+    if (oProperty.Value.Type == JsonTypeInvalid)
+    {
+        pEditor->Error = "Property not found";
+        return 0;
+    }
+    long long nSize = Json_GetSize(oProperty.Position) + Json_GetSize(oProperty.Value.Position);
+    return Json_ResizeRange(pEditor, (byte*)oProperty.Position, nSize, 0);
+}
+
+int Json_RemoveElement(JsonEditor* pEditor, JsonObject oJsonArray, int nIndex)
+{
+    JsonElement oElement = Json_GetElementAtIndex(oJsonArray, nIndex);
+    if (oElement.Value.Type == JsonTypeInvalid)
+    {
+        pEditor->Error = "Element not found";
+        return 0;
+    }
+    return Json_ResizeRange(pEditor, (byte*)oElement.Position, Json_GetSize(oElement.Position), 0);
+}
+
+int Json_InsertProperty(JsonEditor* pEditor, JsonObject oJsonObject, const char* sName, JsonObject oValue)
+{
+    if (oJsonObject.Type != JsonTypeObject || oValue.Type == JsonTypeInvalid)
+    {
+        pEditor->Error = "Can only insert a valid value into an object";
+        return 0;
+    }
+    byte* pPosition = Json_GetSequenceEnd(oJsonObject);//properties are appended at the end of the object
+    int nKeySize = Json_SizeOfKey(sName);
+    long long nValueSize = Json_GetSize(oValue.Position);
+    if (!Json_ResizeRange(pEditor, pPosition, 0, nKeySize + nValueSize))
+        return 0;
+    Json_WriteKey(pPosition, sName);
+    memcpy(pPosition + nKeySize, oValue.Position, nValueSize);
+    return 1;
+}
+
+int Json_InsertElement(JsonEditor* pEditor, JsonObject oJsonArray, int nIndex, JsonObject oValue)
+{
+    if (oJsonArray.Type != JsonTypeArray || oValue.Type == JsonTypeInvalid)
+    {
+        pEditor->Error = "Can only insert a valid value into an array";
+        return 0;
+    }
+    byte* pPosition = Json_GetSequenceEnd(oJsonArray);
+    if (nIndex >= 0)
+    {
+        JsonElement oElement = Json_GetElementAtIndex(oJsonArray, nIndex);
+        if (oElement.Value.Type != JsonTypeInvalid)
+            pPosition = (byte*)oElement.Position;
+    }
+    long long nValueSize = Json_GetSize(oValue.Position);
+    if (!Json_ResizeRange(pEditor, pPosition, 0, nValueSize))
+        return 0;
+    memcpy(pPosition, oValue.Position, nValueSize);
+    return 1;
+}
+
+int Json_AppendElement(JsonEditor* pEditor, JsonObject oJsonArray, JsonObject oValue)
+{
+    return Json_InsertElement(pEditor, oJsonArray, -1, oValue);
+}
+
+//recomputes the markers of every container under pJson, used when sizes are unreliable after moving ranges around
+uint64 Json_RepackContainers(byte* pJson)
+{
+    if (!Json_IsContainer(pJson))
+        return Json_GetSize(pJson);
+    uint64 nSize = 2;
+    byte* pChild = pJson + 1;
+    while (*pChild != JsonMarkerSequenceEnd)
+    {
+        uint64 nChildSize = Json_RepackContainers(pChild);
+        pChild += nChildSize;
+        nSize += nChildSize;
+    }
+    Json_SetContainerSize(pJson, nSize);
+    return nSize;
+}
+
+void Json_ReverseRange(byte* pStart, byte* pEnd)
+{
+    while (pStart < --pEnd)
+    {
+        byte nSwap = *pStart;
+        *pStart++ = *pEnd;
+        *pEnd = nSwap;
+    }
+}
+
+//moves the range [pFrom, pFrom + nSize) to pTo without any extra memory, by rotating the bytes in between
+int Json_MoveRange(JsonEditor* pEditor, byte* pFrom, long long nSize, byte* pTo)
+{
+    if (pTo > pFrom && pTo < pFrom + nSize)
+    {
+        pEditor->Error = "Can't move a value into itself";
+        return 0;
+    }
+    byte* pStart = pTo < pFrom ? pTo : pFrom;
+    byte* pEnd = pTo < pFrom ? pFrom + nSize : pTo;
+    byte* pMiddle = pTo < pFrom ? pFrom : pFrom + nSize;
+    Json_ReverseRange(pStart, pMiddle);
+    Json_ReverseRange(pMiddle, pEnd);
+    Json_ReverseRange(pStart, pEnd);
+    Json_RepackContainers((byte*)pEditor->Buffer);
+    pEditor->Error = 0;
+    return 1;
+}
+
+int Json_MoveProperty(JsonEditor* pEditor, JsonObject oSource, const char* sName, JsonObject oDestination)
+{
+    JsonProperty oProperty = Json_GetPropertyByName(oSource, (char*)sName);
+    if (oProperty.Value.Type == JsonTypeInvalid || oDestination.Type != JsonTypeObject)
+    {
+        pEditor->Error = "Property not found";
+        return 0;
+    }
+    long long nSize = Json_GetSize(oProperty.Position) + Json_GetSize(oProperty.Value.Position);
+    return Json_MoveRange(pEditor, (byte*)oProperty.Position, nSize, Json_GetSequenceEnd(oDestination));
+}
+
+int Json_MoveElement(JsonEditor* pEditor, JsonObject oSource, int nIndex, JsonObject oDestination)
+{
+    JsonElement oElement = Json_GetElementAtIndex(oSource, nIndex);
+    if (oElement.Value.Type == JsonTypeInvalid || oDestination.Type != JsonTypeArray)
+    {
+        pEditor->Error = "Element not found";
+        return 0;
+    }
+    return Json_MoveRange(pEditor, (byte*)oElement.Position, Json_GetSize(oElement.Position), Json_GetSequenceEnd(oDestination));
+}
+
+/*************************
+ * batched edits
+ * the edits only record positions, so they all refer to the buffer as it was before the commit,
+ * the commit moves every byte at most twice (one pass for removals, one for insertions) and fixes the containers once
+**************************/
+
+void Json_InitBatch(JsonEditBatch* pBatch, JsonEdit* pEdits, int nCapacity)
+{
+    pBatch->Edits = pEdits;
+    pBatch->Capacity = nCapacity;
+    pBatch->Count = 0;
+    pBatch->Error = 0;
+}
+
+int Json_BatchAdd(JsonEditBatch* pBatch, const unsigned char* pPosition, long long nRemoveSize, const char* sName, JsonObject oValue)
+{
+    if (pBatch->Count == pBatch->Capacity)
+    {
+        pBatch->Error = "Batch is full";
+        return 0;
+    }
+    JsonEdit* pEdit = pBatch->Edits + pBatch->Count;
+    pEdit->Position = pPosition;
+    pEdit->RemoveSize = nRemoveSize;
+    pEdit->Name = sName;
+    pEdit->Value = oValue.Type == JsonTypeInvalid ? 0 : oValue.Position;
+    pEdit->InsertSize = (sName ? Json_SizeOfKey(sName) : 0) + (pEdit->Value ? Json_GetSize(pEdit->Value) : 0);
+    pEdit->Offset = pBatch->Count;
+    pBatch->Count++;
+    return 1;
+}
+
+int Json_BatchRemoveProperty(JsonEditBatch* pBatch, JsonObject oJsonObject, const char* sName)
+{
+    JsonProperty oProperty = Json_GetPropertyByName(oJsonObject, (char*)sName);
+    if (oProperty.Value.Type == JsonTypeInvalid)
+    {
+        pBatch->Error = "Property not found";
+        return 0;
+    }
+    JsonObject oNone;
+    oNone.Type = JsonTypeInvalid;
+    long long nSize = Json_GetSize(oProperty.Position) + Json_GetSize(oProperty.Value.Position);
+    return Json_BatchAdd(pBatch, oProperty.Position, nSize, 0, oNone);
+}
+
+int Json_BatchRemoveElement(JsonEditBatch* pBatch, JsonObject oJsonArray, int nIndex)
+{
+    JsonElement oElement = Json_GetElementAtIndex(oJsonArray, nIndex);
+    if (oElement.Value.Type == JsonTypeInvalid)
+    {
+        pBatch->Error = "Element not found";
+        return 0;
+    }
+    JsonObject oNone;
+    oNone.Type = JsonTypeInvalid;
+    return Json_BatchAdd(pBatch, oElement.Position, Json_GetSize(oElement.Position), 0, oNone);
+}
+
+int Json_BatchInsertProperty(JsonEditBatch* pBatch, JsonObject oJsonObject, const char* sName, JsonObject oValue)
+{
+    if (oJsonObject.Type != JsonTypeObject || oValue.Type == JsonTypeInvalid)
+    {
+        pBatch->Error = "Can only insert a valid value into an object";
+        return 0;
+    }
+    return Json_BatchAdd(pBatch, Json_GetSequenceEnd(oJsonObject), 0, sName, oValue);
+}
+
+int Json_BatchAppendElement(JsonEditBatch* pBatch, JsonObject oJsonArray, JsonObject oValue)
+{
+    if (oJsonArray.Type != JsonTypeArray || oValue.Type == JsonTypeInvalid)
+    {
+        pBatch->Error = "Can only insert a valid value into an array";
+        return 0;
+    }
+    return Json_BatchAdd(pBatch, Json_GetSequenceEnd(oJsonArray), 0, 0, oValue);
+}
+
+int Json_CompareEdits(const void* pLeft, const void* pRight)
+{
+    const JsonEdit* pA = (const JsonEdit*)pLeft;
+    const JsonEdit* pB = (const JsonEdit*)pRight;
+    if (pA->Position != pB->Position)
+        return pA->Position < pB->Position ? -1 : 1;
+    return pA->Offset < pB->Offset ? -1 : pA->Offset > pB->Offset;//keep the order the edits were added in
+}
+
+int Json_CommitBatch(JsonEditor* pEditor, JsonEditBatch* pBatch)
+{
+    JsonEdit* pEdits = pBatch->Edits;
+    int nCount = pBatch->Count;
+    byte* pBuffer = (byte*)pEditor->Buffer;
+    qsort(pEdits, nCount, sizeof(JsonEdit), Json_CompareEdits);
+
+    long long nRemoved = 0;
+    long long nInserted = 0;
+    for (int i = 0; i < nCount; i++)
+    {
+        if (i > 0 && pEdits[i - 1].Position + pEdits[i - 1].RemoveSize > pEdits[i].Position)
+        {
+            pEditor->Error = "Edits overlap";
+            return 0;
+        }
+        nRemoved += pEdits[i].RemoveSize;
+        nInserted += pEdits[i].InsertSize;
+    }
+    if (pEditor->Size - nRemoved + nInserted > pEditor->Capacity)
+    {
+        pEditor->Error = "Not enough capacity in the buffer";
+        return 0;
+    }
+
+    //first pass, front to back, squeeze out the removed ranges
+    byte* pWrite = pBuffer;
+    const byte* pRead = pBuffer;
+    for (int i = 0; i < nCount; i++)
+    {
+        long long nKeep = pEdits[i].Position - pRead;
+        memmove(pWrite, pRead, nKeep);
+        pWrite += nKeep;
+        pEdits[i].Offset = pWrite - pBuffer;
+        pRead = pEdits[i].Position + pEdits[i].RemoveSize;
+    }
+    long long nTail = pBuffer + pEditor->Size - pRead;
+    memmove(pWrite, pRead, nTail);
+    long long nCompactSize = (pWrite - pBuffer) + nTail;
+
+    //second pass, back to front, open the gaps and copy the inserted values
+    long long nShift = nInserted;
+    long long nSegmentEnd = nCompactSize;
+    for (int i = nCount - 1; i >= 0; i--)
+    {
+        long long nSegmentStart = pEdits[i].Offset;
+        memmove(pBuffer + nSegmentStart + nShift, pBuffer + nSegmentStart, nSegmentEnd - nSegmentStart);
+        nShift -= pEdits[i].InsertSize;
+        byte* pInsert = pBuffer + nSegmentStart + nShift;
+        if (pEdits[i].Name)
+        {
+            Json_WriteKey(pInsert, pEdits[i].Name);
+            pInsert += Json_SizeOfKey(pEdits[i].Name);
+        }
+        if (pEdits[i].Value)
+            memcpy(pInsert, pEdits[i].Value, Json_GetSize(pEdits[i].Value));
+        nSegmentEnd = nSegmentStart;
+    }
+
+    long long nNewSize = nCompactSize + nInserted;
+    if (nNewSize < pEditor->Size)
+        memset(pBuffer + nNewSize, 0, pEditor->Size - nNewSize);
+    pEditor->Size = nNewSize;
+    Json_RepackContainers(pBuffer);
+    pBatch->Count = 0;
+    pEditor->Error = 0;
+    return 1;
+}
@@ -6,187 +6,454 @@
 
 #include "json.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define JSON_SIMD_SSE2 1
+#else
+#define JSON_SIMD_SSE2 0
+#endif
+
+#if defined(__SSSE3__) || defined(__AVX__)
+#include <tmmintrin.h>
+#define JSON_SIMD_SSSE3 1
+#else
+#define JSON_SIMD_SSSE3 0
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+static int json_ctz(unsigned nValue) { unsigned long nIndex; _BitScanForward(&nIndex, nValue); return (int)nIndex; }
+#else
+#define json_ctz(x) __builtin_ctz(x)
+#endif
+#ifdef _MSC_VER
+#define json_popcount(x) ((int)__popcnt(x))
+#else
+#define json_popcount(x) __builtin_popcount(x)
+#endif
+
 typedef  signed char        int8;
 typedef  unsigned char      uint8;
 typedef  signed short       int16;
 typedef  unsigned short     uint16;
-typedef  signed long        int32;
-typedef  unsigned long      uint32;
+typedef  signed int         int32;
+typedef  unsigned int       uint32;
 typedef  signed long long   int64;
 typedef  unsigned long long uint64;
 
 typedef  unsigned char      bool;
 typedef  unsigned char      byte;
 
-int Json_MeasureSize(char* pChar)
+#define JSON_FORMAT_BLOCK_SIZE 4096
+
+//first quote or backslash in the range, or pEnd, the text inside strings is skipped 16 bytes at a time
+const char* Json_FindQuoteOrEscape(const char* pRead, const char* pEnd)
 {
-    char sChar = 0;
-    int nDepth = 0;
-    int nDepthIncrement = 4;
-    int nOutputSizeSize = 0;
-    while (sChar = *pChar++)
+#if JSON_SIMD_SSE2
+    __m128i vQuote = _mm_set1_epi8('"');
+    __m128i vBackslash = _mm_set1_epi8('\\');
+    while (pRead + 16 <= pEnd)
     {
-        switch (sChar)
-        {
-            case '{':
-            case '[':
-                nOutputSizeSize += 1;//char
-                nOutputSizeSize += 1;//\n
-                nDepth += nDepthIncrement;
-                nOutputSizeSize += nDepth;//ident
+        __m128i vChars = _mm_loadu_si128((const __m128i*)pRead);
+        int nMask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(vChars, vQuote), _mm_cmpeq_epi8(vChars, vBackslash)));
+        if (nMask)
+            return pRead + json_ctz(nMask);
+        pRead += 16;
+    }
+#endif
+    while (pRead < pEnd && *pRead != '"' && *pRead != '\\')
+        pRead++;
+    return pRead;
+}
 
-                break;
-            case '}':
-            case ']':
-                nOutputSizeSize += 1;//\n
-                nDepth -= nDepthIncrement;
-                if (nDepth < 0)//bad json text
-                    return -1;
-                nOutputSizeSize += nDepth;//ident
-                nOutputSizeSize += 1;//char
-                break;
-            case '"':
-                int nStringSize = 1;//open "
-                while (sChar && (sChar = *pChar++) != '"')
-                {
-                    if (sChar == '\\')//escaped pair
-                    {
-                        pChar++;
-                        nStringSize++;
-                    }
-                    nStringSize++;
-                }
-                nStringSize++;//close "
-                nOutputSizeSize += nStringSize;
-            case ',':
-                nOutputSizeSize += 1;//char
-                nOutputSizeSize += 1;//\n
-                nOutputSizeSize += nDepth;//ident
-                break;
-            case ':':
-                nOutputSizeSize += 3;// : 
-                break;
-            default:
-                nOutputSizeSize += 1;// char 
-                break;
+/*************************
+ * pretty printing
+ * the text is read once and written to a small staging block that is flushed to a sink,
+ * so the output is never measured beforehand and never needs to be in memory as a whole
+**************************/
+
+typedef struct JsonFormatOutput
+{
+    char Block[JSON_FORMAT_BLOCK_SIZE];
+    int Used;
+    JsonWriteCallback Write;
+    void* User;
+    int Failed;
+} JsonFormatOutput;
+
+void Json_FormatFlush(JsonFormatOutput* pOut)
+{
+    if (pOut->Used > 0 && !pOut->Failed && !pOut->Write(pOut->User, pOut->Block, pOut->Used))
+        pOut->Failed = 1;
+    pOut->Used = 0;
+}
+
+void Json_FormatPut(JsonFormatOutput* pOut, const char* pData, int nSize)
+{
+    if (pOut->Used + nSize > JSON_FORMAT_BLOCK_SIZE)
+    {
+        Json_FormatFlush(pOut);
+        if (nSize > JSON_FORMAT_BLOCK_SIZE)//long strings go straight to the sink
+        {
+            if (!pOut->Failed && !pOut->Write(pOut->User, pData, nSize))
+                pOut->Failed = 1;
+            return;
         }
     }
-    return nOutputSizeSize;
+    memcpy(pOut->Block + pOut->Used, pData, nSize);
+    pOut->Used += nSize;
 }
 
-char* Json_Indent(char* pChar)
+void Json_FormatNewLine(JsonFormatOutput* pOut, const JsonFormatStyle* pStyle, int nNewLineSize, int nDepth)
 {
-    int nOutputSizeSize = Json_MeasureSize(pChar);
-    if (nOutputSizeSize < 0)
-        return 0;
+    Json_FormatPut(pOut, pStyle->NewLine, nNewLineSize);
+    int nIndent = nDepth * pStyle->IndentWidth;
+    while (nIndent > 0)
+    {
+        if (pOut->Used == JSON_FORMAT_BLOCK_SIZE)
+            Json_FormatFlush(pOut);
+        int nSize = JSON_FORMAT_BLOCK_SIZE - pOut->Used;
+        if (nSize > nIndent)
+            nSize = nIndent;
+        memset(pOut->Block + pOut->Used, pStyle->IndentChar, nSize);
+        pOut->Used += nSize;
+        nIndent -= nSize;
+    }
+}
 
-    char* pOut = malloc(nOutputSizeSize + 1);
-    char* pReturn = pOut;
-    //memset(pOut, '-', nOutputSizeSize + 1);
-    *(pOut + nOutputSizeSize) = '\0';
-    char sChar = 0;
+JsonFormatStyle Json_DefaultFormatStyle()
+{
+    JsonFormatStyle oStyle;
+    oStyle.IndentWidth = 4;
+    oStyle.IndentChar = ' ';
+    oStyle.Colon = " : ";
+    oStyle.NewLine = "\n";
+    return oStyle;
+}
+
+int Json_FormatTo(const char* pJson, const JsonFormatStyle* pStyle, JsonWriteCallback fWrite, void* pUser)
+{
+    JsonFormatStyle oStyle = pStyle ? *pStyle : Json_DefaultFormatStyle();
+    int nColonSize = (int)strlen(oStyle.Colon);
+    int nNewLineSize = (int)strlen(oStyle.NewLine);
+    JsonFormatOutput oOut;
+    oOut.Used = 0;
+    oOut.Write = fWrite;
+    oOut.User = pUser;
+    oOut.Failed = 0;
+
+    const char* pRead = pJson;
+    const char* pEnd = pJson + strlen(pJson);
     int nDepth = 0;
-    int nDepthIncrement = 4;
-    char sDepthChar = ' ';
     int bIsScopeOpening = 0;
-    while (sChar = *pChar++)
+    while (pRead < pEnd && !oOut.Failed)
     {
-        if (sChar <= 32)//skip spaces and white chars
+        char sChar = *pRead++;
+        if ((byte)sChar <= 32)//skip spaces and white chars
             continue;
-        if (bIsScopeOpening && sChar != '}' && sChar != '}')
+        if (bIsScopeOpening)
         {
-            nDepth += nDepthIncrement;
-            *pOut++ = '\n';
-            for (int i = 0;i < nDepth;i++)
-                *pOut++ = sDepthChar;
+            bIsScopeOpening = 0;
+            if (sChar == '}' || sChar == ']')//empty scopes stay in one line
+            {
+                Json_FormatPut(&oOut, &sChar, 1);
+                continue;
+            }
+            nDepth++;
+            Json_FormatNewLine(&oOut, &oStyle, nNewLineSize, nDepth);
         }
         switch (sChar)
         {
             case '{':
             case '[':
                 bIsScopeOpening = 1;
-                *pOut++ = sChar;
-
+                Json_FormatPut(&oOut, &sChar, 1);
                 break;
-
             case '}':
             case ']':
-                if (!bIsScopeOpening)
-                {
-                    *pOut++ = '\n';
-                    nDepth -= nDepthIncrement;
-                    for (int i = 0;i < nDepth;i++)
-                        *pOut++ = sDepthChar;
-                }
-                *pOut++ = sChar;
-                bIsScopeOpening = 0;
+                if (nDepth == 0)//bad json text
+                    return 0;
+                nDepth--;
+                Json_FormatNewLine(&oOut, &oStyle, nNewLineSize, nDepth);
+                Json_FormatPut(&oOut, &sChar, 1);
                 break;
-
             case '"':
-                bIsScopeOpening = 0;
-                *pOut++ = '"';
-                while (sChar && (sChar = *pChar++) != '"')
+            {
+                //the whole string is copied as a single run, escaped pairs included
+                const char* pStart = pRead - 1;
+                while (1)
                 {
-                    if (sChar == '\\')//escaped pair
-                    {
-                        *pOut++ = sChar;
-                        *pOut++ = *pChar++;
-                    }
-                    else
-                        *pOut++ = sChar;
+                    pRead = Json_FindQuoteOrEscape(pRead, pEnd);
+                    if (pRead >= pEnd)
+                        break;
+                    if (*pRead++ == '"')
+                        break;
+                    pRead++;//the escaped char
                 }
-                *pOut++ = '"';
+                if (pRead > pEnd)
+                    pRead = pEnd;
+                Json_FormatPut(&oOut, pStart, (int)(pRead - pStart));
                 break;
+            }
             case ',':
-                bIsScopeOpening = 0;
-                *pOut++ = ',';
-                *pOut++ = '\n';
-                for (int i = 0;i < nDepth;i++)
-                    *pOut++ = sDepthChar;
+                Json_FormatPut(&oOut, ",", 1);
+                Json_FormatNewLine(&oOut, &oStyle, nNewLineSize, nDepth);
                 break;
             case ':':
-                bIsScopeOpening = 0;
-                *pOut++ = ' ';
-                *pOut++ = ':';
-                *pOut++ = ' ';
+                Json_FormatPut(&oOut, oStyle.Colon, nColonSize);
                 break;
             default:
-                bIsScopeOpening = 0;
-                *pOut++ = sChar;// char
+                Json_FormatPut(&oOut, &sChar, 1);
                 break;
         }
     }
+    Json_FormatFlush(&oOut);
+    return !oOut.Failed;
+}
+
+typedef struct JsonFormatMemory
+{
+    char* Memory;
+    long long Capacity;
+    long long Used;
+    int Growable;
+} JsonFormatMemory;
 
-    *pOut = '\0';
-    return pReturn;
+int Json_FormatToMemory(void* pUser, const char* pData, size_t nSize)
+{
+    JsonFormatMemory* pMemory = (JsonFormatMemory*)pUser;
+    long long nNeeded = (long long)pMemory->Used + nSize + 1;//keep room for the terminating null
+    if (nNeeded > pMemory->Capacity)
+    {
+        if (!pMemory->Growable)
+            return 0;
+        long long nCapacity = pMemory->Capacity < 64 ? 64 : pMemory->Capacity;
+        while (nCapacity < nNeeded)
+            nCapacity *= 2;
+        char* pGrown = (char*)realloc(pMemory->Memory, (size_t)nCapacity);
+        if (!pGrown)
+            return 0;
+        pMemory->Memory = pGrown;
+        pMemory->Capacity = nCapacity;
+    }
+    memcpy(pMemory->Memory + pMemory->Used, pData, nSize);
+    pMemory->Used += nSize;
+    return 1;
 }
 
-char* Json_Compress(char* pChar)
+long long Json_FormatInto(const char* pJson, const JsonFormatStyle* pStyle, char* pDest, long long nCapacity)
+{
+    JsonFormatMemory oMemory = { pDest, nCapacity, 0, 0 };
+    if (nCapacity < 1 || !Json_FormatTo(pJson, pStyle, Json_FormatToMemory, &oMemory))
+        return -1;
+    pDest[oMemory.Used] = '\0';
+    return oMemory.Used;
+}
+
+char* Json_Indent(char* pChar)
 {
-    char* pRead = pChar;
-    char* pWrite = pChar;
-    char sChar = 0;
-    while (sChar = *pRead++)
+    JsonFormatMemory oMemory = { 0, 0, 0, 1 };
+    if (!Json_FormatTo(pChar, 0, Json_FormatToMemory, &oMemory) || !Json_FormatToMemory(&oMemory, "", 0))
     {
-        if (sChar <= 32)
+        free(oMemory.Memory);
+        return 0;
+    }
+    oMemory.Memory[oMemory.Used] = '\0';
+    return oMemory.Memory;
+}
+
+/*************************
+ * minifying
+ * the text is classified 16 bytes at a time: whitespace, quotes and backslashes become bit masks, the escaped chars
+ * and the quotes that open and close strings are resolved on the masks (carrying across blocks), a prefix xor of the
+ * quotes gives the bytes inside strings, and the bytes to keep are packed with a shuffle table
+**************************/
+
+#if JSON_SIMD_SSSE3
+//for each 8 bit mask, the indexes of the set bits packed at the start (0x80 clears the byte)
+static const uint64 pCompressShuffle[256] =
+{
+    0x8080808080808080ULL, 0x8080808080808000ULL, 0x8080808080808001ULL, 0x8080808080800100ULL,
+    0x8080808080808002ULL, 0x8080808080800200ULL, 0x8080808080800201ULL, 0x8080808080020100ULL,
+    0x8080808080808003ULL, 0x8080808080800300ULL, 0x8080808080800301ULL, 0x8080808080030100ULL,
+    0x8080808080800302ULL, 0x8080808080030200ULL, 0x8080808080030201ULL, 0x8080808003020100ULL,
+    0x8080808080808004ULL, 0x8080808080800400ULL, 0x8080808080800401ULL, 0x8080808080040100ULL,
+    0x8080808080800402ULL, 0x8080808080040200ULL, 0x8080808080040201ULL, 0x8080808004020100ULL,
+    0x8080808080800403ULL, 0x8080808080040300ULL, 0x8080808080040301ULL, 0x8080808004030100ULL,
+    0x8080808080040302ULL, 0x8080808004030200ULL, 0x8080808004030201ULL, 0x8080800403020100ULL,
+    0x8080808080808005ULL, 0x8080808080800500ULL, 0x8080808080800501ULL, 0x8080808080050100ULL,
+    0x8080808080800502ULL, 0x8080808080050200ULL, 0x8080808080050201ULL, 0x8080808005020100ULL,
+    0x8080808080800503ULL, 0x8080808080050300ULL, 0x8080808080050301ULL, 0x8080808005030100ULL,
+    0x8080808080050302ULL, 0x8080808005030200ULL, 0x8080808005030201ULL, 0x8080800503020100ULL,
+    0x8080808080800504ULL, 0x8080808080050400ULL, 0x8080808080050401ULL, 0x8080808005040100ULL,
+    0x8080808080050402ULL, 0x8080808005040200ULL, 0x8080808005040201ULL, 0x8080800504020100ULL,
+    0x8080808080050403ULL, 0x8080808005040300ULL, 0x8080808005040301ULL, 0x8080800504030100ULL,
+    0x8080808005040302ULL, 0x8080800504030200ULL, 0x8080800504030201ULL, 0x8080050403020100ULL,
+    0x8080808080808006ULL, 0x8080808080800600ULL, 0x8080808080800601ULL, 0x8080808080060100ULL,
+    0x8080808080800602ULL, 0x8080808080060200ULL, 0x8080808080060201ULL, 0x8080808006020100ULL,
+    0x8080808080800603ULL, 0x8080808080060300ULL, 0x8080808080060301ULL, 0x8080808006030100ULL,
+    0x8080808080060302ULL, 0x8080808006030200ULL, 0x8080808006030201ULL, 0x8080800603020100ULL,
+    0x8080808080800604ULL, 0x8080808080060400ULL, 0x8080808080060401ULL, 0x8080808006040100ULL,
+    0x8080808080060402ULL, 0x8080808006040200ULL, 0x8080808006040201ULL, 0x8080800604020100ULL,
+    0x8080808080060403ULL, 0x8080808006040300ULL, 0x8080808006040301ULL, 0x8080800604030100ULL,
+    0x8080808006040302ULL, 0x8080800604030200ULL, 0x8080800604030201ULL, 0x8080060403020100ULL,
+    0x8080808080800605ULL, 0x8080808080060500ULL, 0x8080808080060501ULL, 0x8080808006050100ULL,
+    0x8080808080060502ULL, 0x8080808006050200ULL, 0x8080808006050201ULL, 0x8080800605020100ULL,
+    0x8080808080060503ULL, 0x8080808006050300ULL, 0x8080808006050301ULL, 0x8080800605030100ULL,
+    0x8080808006050302ULL, 0x8080800605030200ULL, 0x8080800605030201ULL, 0x8080060503020100ULL,
+    0x8080808080060504ULL, 0x8080808006050400ULL, 0x8080808006050401ULL, 0x8080800605040100ULL,
+    0x8080808006050402ULL, 0x8080800605040200ULL, 0x8080800605040201ULL, 0x8080060504020100ULL,
+    0x8080808006050403ULL, 0x8080800605040300ULL, 0x8080800605040301ULL, 0x8080060504030100ULL,
+    0x8080800605040302ULL, 0x8080060504030200ULL, 0x8080060504030201ULL, 0x8006050403020100ULL,
+    0x8080808080808007ULL, 0x8080808080800700ULL, 0x8080808080800701ULL, 0x8080808080070100ULL,
+    0x8080808080800702ULL, 0x8080808080070200ULL, 0x8080808080070201ULL, 0x8080808007020100ULL,
+    0x8080808080800703ULL, 0x8080808080070300ULL, 0x8080808080070301ULL, 0x8080808007030100ULL,
+    0x8080808080070302ULL, 0x8080808007030200ULL, 0x8080808007030201ULL, 0x8080800703020100ULL,
+    0x8080808080800704ULL, 0x8080808080070400ULL, 0x8080808080070401ULL, 0x8080808007040100ULL,
+    0x8080808080070402ULL, 0x8080808007040200ULL, 0x8080808007040201ULL, 0x8080800704020100ULL,
+    0x8080808080070403ULL, 0x8080808007040300ULL, 0x8080808007040301ULL, 0x8080800704030100ULL,
+    0x8080808007040302ULL, 0x8080800704030200ULL, 0x8080800704030201ULL, 0x8080070403020100ULL,
+    0x8080808080800705ULL, 0x8080808080070500ULL, 0x8080808080070501ULL, 0x8080808007050100ULL,
+    0x8080808080070502ULL, 0x8080808007050200ULL, 0x8080808007050201ULL, 0x8080800705020100ULL,
+    0x8080808080070503ULL, 0x8080808007050300ULL, 0x8080808007050301ULL, 0x8080800705030100ULL,
+    0x8080808007050302ULL, 0x8080800705030200ULL, 0x8080800705030201ULL, 0x8080070503020100ULL,
+    0x8080808080070504ULL, 0x8080808007050400ULL, 0x8080808007050401ULL, 0x8080800705040100ULL,
+    0x8080808007050402ULL, 0x8080800705040200ULL, 0x8080800705040201ULL, 0x8080070504020100ULL,
+    0x8080808007050403ULL, 0x8080800705040300ULL, 0x8080800705040301ULL, 0x8080070504030100ULL,
+    0x8080800705040302ULL, 0x8080070504030200ULL, 0x8080070504030201ULL, 0x8007050403020100ULL,
+    0x8080808080800706ULL, 0x8080808080070600ULL, 0x8080808080070601ULL, 0x8080808007060100ULL,
+    0x8080808080070602ULL, 0x8080808007060200ULL, 0x8080808007060201ULL, 0x8080800706020100ULL,
+    0x8080808080070603ULL, 0x8080808007060300ULL, 0x8080808007060301ULL, 0x8080800706030100ULL,
+    0x8080808007060302ULL, 0x8080800706030200ULL, 0x8080800706030201ULL, 0x8080070603020100ULL,
+    0x8080808080070604ULL, 0x8080808007060400ULL, 0x8080808007060401ULL, 0x8080800706040100ULL,
+    0x8080808007060402ULL, 0x8080800706040200ULL, 0x8080800706040201ULL, 0x8080070604020100ULL,
+    0x8080808007060403ULL, 0x8080800706040300ULL, 0x8080800706040301ULL, 0x8080070604030100ULL,
+    0x8080800706040302ULL, 0x8080070604030200ULL, 0x8080070604030201ULL, 0x8007060403020100ULL,
+    0x8080808080070605ULL, 0x8080808007060500ULL, 0x8080808007060501ULL, 0x8080800706050100ULL,
+    0x8080808007060502ULL, 0x8080800706050200ULL, 0x8080800706050201ULL, 0x8080070605020100ULL,
+    0x8080808007060503ULL, 0x8080800706050300ULL, 0x8080800706050301ULL, 0x8080070605030100ULL,
+    0x8080800706050302ULL, 0x8080070605030200ULL, 0x8080070605030201ULL, 0x8007060503020100ULL,
+    0x8080808007060504ULL, 0x8080800706050400ULL, 0x8080800706050401ULL, 0x8080070605040100ULL,
+    0x8080800706050402ULL, 0x8080070605040200ULL, 0x8080070605040201ULL, 0x8007060504020100ULL,
+    0x8080800706050403ULL, 0x8080070605040300ULL, 0x8080070605040301ULL, 0x8007060504030100ULL,
+    0x8080070605040302ULL, 0x8007060504030200ULL, 0x8007060504030201ULL, 0x0706050403020100ULL,
+};
+#endif
+
+#if JSON_SIMD_SSE2
+//bit i is set if the char at i is escaped by a backslash, nCarry is the escape pending from the previous block
+int Json_EscapedMask(int nBackslashes, int* nCarry)
+{
+    int nEscaped = *nCarry;
+    *nCarry = 0;
+    while (nBackslashes)
+    {
+        int i = json_ctz(nBackslashes);
+        nBackslashes &= nBackslashes - 1;
+        if (nEscaped & (1 << i))//an escaped backslash escapes nothing
             continue;
-        if (sChar == '"')
+        if (i == 15)
+            *nCarry = 1;
+        else
+            nEscaped |= 1 << (i + 1);
+    }
+    return nEscaped;
+}
+
+//bit i is set if the char at i is inside a string, the opening quote included
+int Json_InStringMask(int nQuotes, int* bInString)
+{
+    int nMask = nQuotes;
+    nMask ^= nMask << 1;
+    nMask ^= nMask << 2;
+    nMask ^= nMask << 4;
+    nMask ^= nMask << 8;
+    if (*bInString)
+        nMask = ~nMask;
+    nMask &= 0xFFFF;
+    *bInString = (nMask >> 15) & 1;
+    return nMask;
+}
+
+//writes the kept bytes of the block, a whole block store is safe in place because the write cursor never passes the read one
+char* Json_PackBlock(char* pWrite, __m128i vChars, int nKeep)
+{
+    if (nKeep == 0xFFFF)
+    {
+        _mm_storeu_si128((__m128i*)pWrite, vChars);
+        return pWrite + 16;
+    }
+#if JSON_SIMD_SSSE3
+    __m128i vLow = _mm_shuffle_epi8(vChars, _mm_loadl_epi64((const __m128i*)&pCompressShuffle[nKeep & 0xFF]));
+    _mm_storel_epi64((__m128i*)pWrite, vLow);
+    pWrite += json_popcount(nKeep & 0xFF);
+    __m128i vHigh = _mm_shuffle_epi8(_mm_srli_si128(vChars, 8), _mm_loadl_epi64((const __m128i*)&pCompressShuffle[nKeep >> 8]));
+    _mm_storel_epi64((__m128i*)pWrite, vHigh);
+    pWrite += json_popcount(nKeep >> 8);
+#else
+    char pChars[16];
+    _mm_storeu_si128((__m128i*)pChars, vChars);
+    while (nKeep)
+    {
+        *pWrite++ = pChars[json_ctz(nKeep)];
+        nKeep &= nKeep - 1;
+    }
+#endif
+    return pWrite;
+}
+#endif
+
+//pDest may be pJson itself, the text never grows, returns the size of the minified text
+long long Json_CompressInto(const char* pJson, char* pDest)
+{
+    const char* pRead = pJson;
+    const char* pEnd = pJson + strlen(pJson);
+    char* pWrite = pDest;
+    int bInString = 0;
+    int bEscaped = 0;
+#if JSON_SIMD_SSE2
+    __m128i vQuote = _mm_set1_epi8('"');
+    __m128i vBackslash = _mm_set1_epi8('\\');
+    __m128i vSpace = _mm_set1_epi8(32);
+    while (pRead + 16 <= pEnd)
+    {
+        __m128i vChars = _mm_loadu_si128((const __m128i*)pRead);
+        int nWhite = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(vChars, vSpace), vChars));//unsigned <= 32
+        int nQuotes = _mm_movemask_epi8(_mm_cmpeq_epi8(vChars, vQuote));
+        int nBackslashes = _mm_movemask_epi8(_mm_cmpeq_epi8(vChars, vBackslash));
+        if (nBackslashes || bEscaped)
+            nQuotes &= ~Json_EscapedMask(nBackslashes, &bEscaped);
+        int nKeep = (~nWhite | Json_InStringMask(nQuotes, &bInString)) & 0xFFFF;
+        pWrite = Json_PackBlock(pWrite, vChars, nKeep);
+        pRead += 16;
+    }
+#endif
+    while (pRead < pEnd)
+    {
+        char sChar = *pRead++;
+        if (bInString)
         {
-            *pWrite++ = '"';
-            while (sChar && (sChar = *pRead++) != '"')
-            {
-                if (sChar == '\\')//escaped pair
-                {
-                    *pWrite++ = sChar;//write the backslash 
-                    sChar = *pRead++;//read next
-                }
-                *pWrite++ = sChar;
-            }
-            *pWrite++ = '"';
+            *pWrite++ = sChar;
+            if (bEscaped)
+                bEscaped = 0;
+            else if (sChar == '\\')
+                bEscaped = 1;
+            else if (sChar == '"')
+                bInString = 0;
             continue;
         }
+        if ((byte)sChar <= 32)
+            continue;
+        if (sChar == '"')
+            bInString = 1;
         *pWrite++ = sChar;
     }
     *pWrite = '\0';
+    return pWrite - pDest;
+}
+
+char* Json_Compress(char* pChar)
+{
+    Json_CompressInto(pChar, pChar);
     return pChar;
-}
\ No newline at end of file
+}
@@ -0,0 +1,352 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+
+#include "json.h"
+
+typedef  signed char        int8;
+typedef  unsigned char      uint8;
+typedef  signed short       int16;
+typedef  unsigned short     uint16;
+typedef  signed int         int32;
+typedef  unsigned int       uint32;
+typedef  signed long long   int64;
+typedef  unsigned long long uint64;
+
+typedef  unsigned char      bool;
+typedef  unsigned char      byte;
+
+/*************************
+ * number formatting
+ * integers are written two digits at a time from a table, other doubles use Grisu2 (Florian Loitsch, 2010)
+ * which produces the shortest digits that parse back to the same double in almost every case, and always round trips
+**************************/
+
+static const char pDigitPairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+int Json_FormatUInt64(char* pDest, uint64 nValue)
+{
+    char pDigits[20];
+    char* pWrite = pDigits + 20;
+    while (nValue >= 100)
+    {
+        int nPair = (int)(nValue % 100) * 2;
+        nValue /= 100;
+        *--pWrite = pDigitPairs[nPair + 1];
+        *--pWrite = pDigitPairs[nPair];
+    }
+    if (nValue >= 10)
+    {
+        int nPair = (int)nValue * 2;
+        *--pWrite = pDigitPairs[nPair + 1];
+        *--pWrite = pDigitPairs[nPair];
+    }
+    else
+        *--pWrite = (char)('0' + nValue);
+    int nLength = (int)(pDigits + 20 - pWrite);
+    memcpy(pDest, pWrite, nLength);
+    return nLength;
+}
+
+int Json_FormatInt64(char* pDest, long long nValue)
+{
+    if (nValue < 0)
+    {
+        *pDest = '-';
+        return 1 + Json_FormatUInt64(pDest + 1, 0 - (uint64)nValue);//works for the minimum value too
+    }
+    return Json_FormatUInt64(pDest, (uint64)nValue);
+}
+
+typedef struct JsonDiyFp
+{
+    uint64 F;
+    int E;
+} JsonDiyFp;
+
+//normalized 10^k for k = -348, -340, ... , 340 as F * 2^E
+static const uint64 pCachedPowersF[] =
+{
+    0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL, 0xcf42894a5dce35eaULL,
+    0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL, 0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL,
+    0xbe5691ef416bd60cULL, 0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+    0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL, 0xc21094364dfb5637ULL,
+    0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL, 0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL,
+    0xb23867fb2a35b28eULL, 0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+    0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL, 0xb5b5ada8aaff80b8ULL,
+    0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL, 0x964e858c91ba2655ULL, 0xdff9772470297ebdULL,
+    0xa6dfbd9fb8e5b88fULL, 0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+    0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL, 0xaa242499697392d3ULL,
+    0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL, 0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL,
+    0x9c40000000000000ULL, 0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+    0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL, 0x9f4f2726179a2245ULL,
+    0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL, 0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL,
+    0x924d692ca61be758ULL, 0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+    0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL, 0x952ab45cfa97a0b3ULL,
+    0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL, 0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL,
+    0x88fcf317f22241e2ULL, 0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+    0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL, 0x8bab8eefb6409c1aULL,
+    0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL, 0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL,
+    0x80444b5e7aa7cf85ULL, 0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+    0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL
+};
+static const int16 pCachedPowersE[] =
+{
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954, -927,
+    -901, -874, -847, -821, -794, -768, -741, -715, -688, -661, -635, -608,
+    -582, -555, -529, -502, -475, -449, -422, -396, -369, -343, -316, -289,
+    -263, -236, -210, -183, -157, -130, -103, -77, -50, -24, 3, 30,
+    56, 83, 109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+    375, 402, 428, 455, 481, 508, 534, 561, 588, 614, 641, 667,
+    694, 720, 747, 774, 800, 827, 853, 880, 907, 933, 960, 986,
+    1013, 1039, 1066
+};
+
+static const uint64 pPowersOf10[] =
+{
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL,
+    10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL, 100000000000000ULL,
+    1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+};
+
+JsonDiyFp Json_MultiplyDiyFp(JsonDiyFp oLeft, JsonDiyFp oRight)
+{
+    const uint64 nMask = 0xFFFFFFFFULL;
+    uint64 a = oLeft.F >> 32;
+    uint64 b = oLeft.F & nMask;
+    uint64 c = oRight.F >> 32;
+    uint64 d = oRight.F & nMask;
+    uint64 ac = a * c;
+    uint64 bc = b * c;
+    uint64 ad = a * d;
+    uint64 bd = b * d;
+    uint64 nMiddle = (bd >> 32) + (ad & nMask) + (bc & nMask);
+    nMiddle += 1ULL << 31;//round
+    JsonDiyFp oResult;
+    oResult.F = ac + (ad >> 32) + (bc >> 32) + (nMiddle >> 32);
+    oResult.E = oLeft.E + oRight.E + 64;
+    return oResult;
+}
+
+JsonDiyFp Json_NormalizeDiyFp(JsonDiyFp oValue)
+{
+    while (!(oValue.F & (1ULL << 63)))
+    {
+        oValue.F <<= 1;
+        oValue.E--;
+    }
+    return oValue;
+}
+
+int Json_CountDigits32(uint32 nValue)
+{
+    int nDigits = 1;
+    while (nValue >= 10)
+    {
+        nValue /= 10;
+        nDigits++;
+    }
+    return nDigits;
+}
+
+void Json_GrisuRound(char* pBuffer, int nLength, uint64 nDelta, uint64 nRest, uint64 nTenKappa, uint64 nDistance)
+{
+    while (nRest < nDistance && nDelta - nRest >= nTenKappa
+        && (nRest + nTenKappa < nDistance || nDistance - nRest > nRest + nTenKappa - nDistance))
+    {
+        pBuffer[nLength - 1]--;
+        nRest += nTenKappa;
+    }
+}
+
+void Json_GrisuDigits(JsonDiyFp oValue, JsonDiyFp oUpper, uint64 nDelta, char* pBuffer, int* pLength, int* pK)
+{
+    JsonDiyFp oOne;
+    oOne.F = 1ULL << -oUpper.E;
+    oOne.E = oUpper.E;
+    uint64 nDistance = oUpper.F - oValue.F;
+    uint32 nIntegral = (uint32)(oUpper.F >> -oOne.E);
+    uint64 nFraction = oUpper.F & (oOne.F - 1);
+    int nKappa = Json_CountDigits32(nIntegral);
+    *pLength = 0;
+    while (nKappa > 0)
+    {
+        uint32 nDivisor = (uint32)pPowersOf10[nKappa - 1];
+        int nDigit = nIntegral / nDivisor;
+        nIntegral %= nDivisor;
+        if (nDigit || *pLength)
+            pBuffer[(*pLength)++] = (char)('0' + nDigit);
+        nKappa--;
+        uint64 nRest = ((uint64)nIntegral << -oOne.E) + nFraction;
+        if (nRest <= nDelta)
+        {
+            *pK += nKappa;
+            Json_GrisuRound(pBuffer, *pLength, nDelta, nRest, pPowersOf10[nKappa] << -oOne.E, nDistance);
+            return;
+        }
+    }
+    for (;;)
+    {
+        nFraction *= 10;
+        nDelta *= 10;
+        int nDigit = (int)(nFraction >> -oOne.E);
+        if (nDigit || *pLength)
+            pBuffer[(*pLength)++] = (char)('0' + nDigit);
+        nFraction &= oOne.F - 1;
+        nKappa--;
+        if (nFraction < nDelta)
+        {
+            *pK += nKappa;
+            int nIndex = -nKappa;
+            Json_GrisuRound(pBuffer, *pLength, nDelta, nFraction, oOne.F, nDistance * (nIndex < 20 ? pPowersOf10[nIndex] : 0));
+            return;
+        }
+    }
+}
+
+//writes the shortest digits of a positive finite value into pBuffer, the value is digits * 10^k
+void Json_Grisu2(double nValue, char* pBuffer, int* pLength, int* pK)
+{
+    uint64 nBits;
+    memcpy(&nBits, &nValue, 8);
+    int nBiasedExponent = (int)((nBits >> 52) & 0x7FF);
+    JsonDiyFp oValue;
+    oValue.F = nBits & 0x000FFFFFFFFFFFFFULL;
+    if (nBiasedExponent != 0)
+    {
+        oValue.F += 1ULL << 52;//hidden bit
+        oValue.E = nBiasedExponent - 1075;
+    }
+    else
+        oValue.E = -1074;//subnormal
+
+    //the boundaries halfway to the neighbour doubles
+    JsonDiyFp oPlus;
+    oPlus.F = (oValue.F << 1) + 1;
+    oPlus.E = oValue.E - 1;
+    while (!(oPlus.F & (1ULL << 53)))
+    {
+        oPlus.F <<= 1;
+        oPlus.E--;
+    }
+    oPlus.F <<= 10;
+    oPlus.E -= 10;
+    JsonDiyFp oMinus;
+    if (oValue.F == (1ULL << 52))//the lower neighbour is closer at powers of 2
+    {
+        oMinus.F = (oValue.F << 2) - 1;
+        oMinus.E = oValue.E - 2;
+    }
+    else
+    {
+        oMinus.F = (oValue.F << 1) - 1;
+        oMinus.E = oValue.E - 1;
+    }
+    oMinus.F <<= oMinus.E - oPlus.E;
+    oMinus.E = oPlus.E;
+
+    //scale by a cached power of 10 so the exponent lands in a range where the digits can be extracted with integers
+    double nEstimate = (-61 - oPlus.E) * 0.30102999566398114 + 347;
+    int k = (int)nEstimate;
+    if (nEstimate - k > 0.0)
+        k++;
+    int nIndex = (k >> 3) + 1;
+    *pK = -(-348 + nIndex * 8);
+    JsonDiyFp oCachedPower;
+    oCachedPower.F = pCachedPowersF[nIndex];
+    oCachedPower.E = pCachedPowersE[nIndex];
+
+    JsonDiyFp oScaled = Json_MultiplyDiyFp(Json_NormalizeDiyFp(oValue), oCachedPower);
+    JsonDiyFp oUpper = Json_MultiplyDiyFp(oPlus, oCachedPower);
+    JsonDiyFp oLower = Json_MultiplyDiyFp(oMinus, oCachedPower);
+    oLower.F++;
+    oUpper.F--;
+    Json_GrisuDigits(oScaled, oUpper, oUpper.F - oLower.F, pBuffer, pLength, pK);
+}
+
+int Json_WriteExponent(char* pDest, int nExponent)
+{
+    char* pWrite = pDest;
+    *pWrite++ = 'e';
+    if (nExponent < 0)
+    {
+        *pWrite++ = '-';
+        nExponent = -nExponent;
+    }
+    pWrite += Json_FormatUInt64(pWrite, nExponent);
+    return (int)(pWrite - pDest);
+}
+
+//turns digits * 10^k into plain or exponent notation, pBuffer already holds the digits
+int Json_PlaceDecimalPoint(char* pBuffer, int nLength, int k)
+{
+    int nPointPosition = nLength + k;//10^(nPointPosition-1) <= value < 10^nPointPosition
+    if (k >= 0 && nPointPosition <= 21)//1234e7 -> 12340000000
+    {
+        memset(pBuffer + nLength, '0', k);
+        return nPointPosition;
+    }
+    else if (nPointPosition > 0 && nPointPosition <= 21)//1234e-2 -> 12.34
+    {
+        memmove(pBuffer + nPointPosition + 1, pBuffer + nPointPosition, nLength - nPointPosition);
+        pBuffer[nPointPosition] = '.';
+        return nLength + 1;
+    }
+    else if (nPointPosition > -6 && nPointPosition <= 0)//1234e-6 -> 0.001234
+    {
+        int nOffset = 2 - nPointPosition;
+        memmove(pBuffer + nOffset, pBuffer, nLength);
+        pBuffer[0] = '0';
+        pBuffer[1] = '.';
+        memset(pBuffer + 2, '0', nOffset - 2);
+        return nLength + nOffset;
+    }
+    else if (nLength == 1)//1e30
+        return 1 + Json_WriteExponent(pBuffer + 1, nPointPosition - 1);
+    else//1234e30 -> 1.234e33
+    {
+        memmove(pBuffer + 2, pBuffer + 1, nLength - 1);
+        pBuffer[1] = '.';
+        return nLength + 1 + Json_WriteExponent(pBuffer + nLength + 1, nPointPosition - 1);
+    }
+}
+
+//writes the value in at most 25 chars, returns the number of chars written
+int Json_FormatNumber(char* pDest, double nValue)
+{
+    if (nValue != nValue || nValue - nValue != 0)//NaN and infinity have no json representation
+    {
+        memcpy(pDest, "null", 4);
+        return 4;
+    }
+    if (nValue == 0)
+    {
+        *pDest = '0';
+        return 1;
+    }
+    if (nValue > -9007199254740992.0 && nValue < 9007199254740992.0 && nValue == (double)(int64)nValue)//integers up to 2^53 are exact
+        return Json_FormatInt64(pDest, (int64)nValue);
+
+    char* pWrite = pDest;
+    if (nValue < 0)
+    {
+        *pWrite++ = '-';
+        nValue = -nValue;
+    }
+    int nLength = 0;
+    int k = 0;
+    Json_Grisu2(nValue, pWrite, &nLength, &k);
+    return (int)(pWrite - pDest) + Json_PlaceDecimalPoint(pWrite, nLength, k);
+}
@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#include "json.h"
+
+#define JSON_PARALLEL_MAX_THREADS 64
+
+//implemented in json_write.c
+void Json_SetError(char* pBuffer, char* sError);
+
+/*************************
+ * parallel writing
+ * the records are split in contiguous ranges, each range is written to its own fragment on its own thread
+ * and the fragments are appended in order, so the text is the same as writing them one after the other
+**************************/
+
+typedef struct JsonParallelTask
+{
+    char* Fragment;
+    int Begin;
+    int End;
+    int Members;
+    JsonWriteRecord Write;
+    void* User;
+    int Success;
+} JsonParallelTask;
+
+void Json_RunParallelTask(JsonParallelTask* pTask)
+{
+    pTask->Success = 0;
+    pTask->Fragment = Json_CreateFragment(pTask->Members);
+    if (!pTask->Fragment)
+        return;
+    for (int i = pTask->Begin; i < pTask->End; i++)
+        if (!pTask->Write(&pTask->Fragment, i, pTask->User))
+            return;
+    pTask->Success = 1;
+}
+
+#ifdef _WIN32
+DWORD WINAPI Json_ParallelThread(LPVOID pTask)
+{
+    Json_RunParallelTask((JsonParallelTask*)pTask);
+    return 0;
+}
+#else
+void* Json_ParallelThread(void* pTask)
+{
+    Json_RunParallelTask((JsonParallelTask*)pTask);
+    return 0;
+}
+#endif
+
+int Json_WriteParallel(char** pBuffer, int nRecords, int bMembers, JsonWriteRecord fWrite, void* pUser, int nThreads)
+{
+    if (nThreads > JSON_PARALLEL_MAX_THREADS)
+        nThreads = JSON_PARALLEL_MAX_THREADS;
+    if (nThreads > nRecords)
+        nThreads = nRecords;
+    if (nThreads <= 1)//nothing to split, write straight into the buffer
+    {
+        for (int i = 0; i < nRecords; i++)
+            if (!fWrite(pBuffer, i, pUser))
+                return 0;
+        return 1;
+    }
+
+    JsonParallelTask pTasks[JSON_PARALLEL_MAX_THREADS];
+#ifdef _WIN32
+    HANDLE pThreads[JSON_PARALLEL_MAX_THREADS];
+#else
+    pthread_t pThreads[JSON_PARALLEL_MAX_THREADS];
+#endif
+    int pStarted[JSON_PARALLEL_MAX_THREADS];
+    for (int i = 0; i < nThreads; i++)
+    {
+        pTasks[i].Fragment = 0;
+        pTasks[i].Begin = (int)((long long)nRecords * i / nThreads);
+        pTasks[i].End = (int)((long long)nRecords * (i + 1) / nThreads);
+        pTasks[i].Members = bMembers;
+        pTasks[i].Write = fWrite;
+        pTasks[i].User = pUser;
+        pTasks[i].Success = 0;
+    }
+    //the first range is written by the calling thread, if a thread can't be started its range is written here too
+    for (int i = 1; i < nThreads; i++)
+    {
+#ifdef _WIN32
+        pThreads[i] = CreateThread(0, 0, Json_ParallelThread, &pTasks[i], 0, 0);
+        pStarted[i] = pThreads[i] != 0;
+#else
+        pStarted[i] = pthread_create(&pThreads[i], 0, Json_ParallelThread, &pTasks[i]) == 0;
+#endif
+    }
+    Json_RunParallelTask(&pTasks[0]);
+    for (int i = 1; i < nThreads; i++)
+    {
+        if (!pStarted[i])
+        {
+            Json_RunParallelTask(&pTasks[i]);
+            continue;
+        }
+#ifdef _WIN32
+        WaitForSingleObject(pThreads[i], INFINITE);
+        CloseHandle(pThreads[i]);
+#else
+        pthread_join(pThreads[i], 0);
+#endif
+    }
+
+    int bSuccess = 1;
+    char* pFragments[JSON_PARALLEL_MAX_THREADS];
+    for (int i = 0; i < nThreads; i++)
+    {
+        pFragments[i] = pTasks[i].Fragment;
+        if (bSuccess && !pTasks[i].Success)
+        {
+            Json_SetError(*pBuffer, "Failed to write a record");
+            bSuccess = 0;
+        }
+    }
+    if (bSuccess)
+        bSuccess = Json_AppendFragments(pBuffer, pFragments, nThreads, bMembers);
+    for (int i = 0; i < nThreads; i++)
+        if (pFragments[i])
+            Json_ReleaseBuffer(pFragments[i]);
+    return bSuccess;
+}
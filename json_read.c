@@ -6,12 +6,44 @@
 
 #include "json.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define JSON_SIMD_SSE2 1
+#else
+#define JSON_SIMD_SSE2 0
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+static int json_ctz(unsigned nValue) { unsigned long nIndex; _BitScanForward(&nIndex, nValue); return (int)nIndex; }
+#else
+#define json_ctz(x) __builtin_ctz(x)
+#endif
+
+//with JSON_PARSE_PROFILE the phases of the parser are timed into the stats, without it these macros are empty
+#ifdef JSON_PARSE_PROFILE
+#if defined(_MSC_VER)
+#define json_cycles() __rdtsc()
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define json_cycles() __rdtsc()
+#else
+#include <time.h>
+static unsigned long long json_cycles() { struct timespec oTime; clock_gettime(CLOCK_MONOTONIC, &oTime); return oTime.tv_sec * 1000000000ULL + oTime.tv_nsec; }
+#endif
+#define JSON_PROFILE_BEGIN(nStart) unsigned long long nStart = json_cycles()
+#define JSON_PROFILE_END(oCursors, Field, nStart) do { if ((oCursors)->pStats) (oCursors)->pStats->Field += json_cycles() - (nStart); } while (0)
+#else
+#define JSON_PROFILE_BEGIN(nStart)
+#define JSON_PROFILE_END(oCursors, Field, nStart) do { (void)(oCursors); } while (0)//keeps the cursors used when a function only takes them to profile
+#endif
+
 typedef  signed char        int8;
 typedef  unsigned char      uint8;
 typedef  signed short       int16;
 typedef  unsigned short     uint16;
-typedef  signed long        int32;
-typedef  unsigned long      uint32;
+typedef  signed int         int32;
+typedef  unsigned int       uint32;
 typedef  signed long long   int64;
 typedef  unsigned long long uint64;
 
@@ -23,6 +55,9 @@ typedef struct JsonCursors
     byte* pRead;
     byte* pWrite;
     char* pError;
+    byte* pEnd;//the null terminator, blocks are only loaded before it
+    int bValidateUtf8;
+    JsonParseStats* pStats;//only touched by the profiling macros while parsing
 } JsonCursors;
 
 
@@ -71,12 +106,19 @@ byte* Json_SkipWhitespace(byte* pJson)
         pJson++;
     return pJson;
 }
+byte* Json_SkipCursorWhitespace(JsonCursors* oCursors, byte* pJson)
+{
+    JSON_PROFILE_BEGIN(nStart);
+    pJson = Json_SkipWhitespace(pJson);
+    JSON_PROFILE_END(oCursors, WhitespaceCycles, nStart);
+    return pJson;
+}
 void Json_ParseObject(JsonCursors* oCursors)
 {
-    uint32 nLen = 2;//minimum object size
+    uint64 nLen = 2;//minimum object size
     byte* pMarker = oCursors->pWrite;//where to put the type, will be the { char
     oCursors->pWrite += 1;//leave space for the type
-    oCursors->pRead = Json_SkipWhitespace(oCursors->pRead + 1); //skip the first { and spaces before first value
+    oCursors->pRead = Json_SkipCursorWhitespace(oCursors, oCursors->pRead + 1); //skip the first { and spaces before first value
     byte sCurrent = 0;
     while (sCurrent = *(oCursors->pRead))
     {
@@ -92,7 +134,7 @@ void Json_ParseObject(JsonCursors* oCursors)
         }
         else if (sCurrent == ',')
         {
-            oCursors->pRead = Json_SkipWhitespace(oCursors->pRead + 1); //skip the , and spaces before the next value
+            oCursors->pRead = Json_SkipCursorWhitespace(oCursors, oCursors->pRead + 1); //skip the , and spaces before the next value
             if (*(oCursors->pRead) == ',') //{a,,b}
             {
                 oCursors->pError = "unexpected ','";
@@ -115,7 +157,7 @@ void Json_ParseObject(JsonCursors* oCursors)
             Json_ParseUnkown(oCursors);
             if (oCursors->pError)
                 return;
-            oCursors->pRead = Json_SkipWhitespace(oCursors->pRead); //skip spaces after the key
+            oCursors->pRead = Json_SkipCursorWhitespace(oCursors, oCursors->pRead); //skip spaces after the key
             sCurrent = *(oCursors->pRead);
             if (sCurrent != ':')
             {
@@ -123,21 +165,22 @@ void Json_ParseObject(JsonCursors* oCursors)
                 return;
             }
             oCursors->pRead += 1;//skip :
-            oCursors->pRead = Json_SkipWhitespace(oCursors->pRead); //skip spaces before the value
+            oCursors->pRead = Json_SkipCursorWhitespace(oCursors, oCursors->pRead); //skip spaces before the value
             Json_ParseUnkown(oCursors);
             if (oCursors->pError)
                 return;
             nLen += oCursors->pWrite - bBefore;//len of child
-            oCursors->pRead = Json_SkipWhitespace(oCursors->pRead); //skip spaces after the value
+            oCursors->pRead = Json_SkipCursorWhitespace(oCursors, oCursors->pRead); //skip spaces after the value
         }
     }
+    oCursors->pError = "unexpected end of stream";//the text ended before the }
 }
 void Json_ParseArray(JsonCursors* oCursors)
 {
-    int nLen = 2;
+    uint64 nLen = 2;
     byte* pMarker = oCursors->pWrite;//where to put the type, will be the [ char
     oCursors->pWrite += 1;//leave space for the type
-    oCursors->pRead = Json_SkipWhitespace(oCursors->pRead + 1); //skip the first [ and spaces before first value
+    oCursors->pRead = Json_SkipCursorWhitespace(oCursors, oCursors->pRead + 1); //skip the first [ and spaces before first value
     byte sCurrent = 0;
     while (sCurrent = *(oCursors->pRead))
     {
@@ -154,7 +197,7 @@ void Json_ParseArray(JsonCursors* oCursors)
         }
         else if (sCurrent == ',')
         {
-            oCursors->pRead = Json_SkipWhitespace(oCursors->pRead + 1); //skip the , and spaces before the next value
+            oCursors->pRead = Json_SkipCursorWhitespace(oCursors, oCursors->pRead + 1); //skip the , and spaces before the next value
             if (*(oCursors->pRead) == ',') //[a,,b]
             {
                 oCursors->pError = "unexpected ','";
@@ -173,14 +216,173 @@ void Json_ParseArray(JsonCursors* oCursors)
             if (oCursors->pError)
                 return;
             nLen += oCursors->pWrite - bBefore;
-            oCursors->pRead = Json_SkipWhitespace(oCursors->pRead); //skip spaces after the value
+            oCursors->pRead = Json_SkipCursorWhitespace(oCursors, oCursors->pRead); //skip spaces after the value
+        }
+    }
+    oCursors->pError = "unexpected end of stream";//the text ended before the ]
+}
+//reads the 4 hex digits of a \u escape, -1 if they are not valid
+int Json_ReadHex4(const byte* pRead)
+{
+    int nValue = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        byte c = pRead[i];
+        if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F')))
+            return -1;
+        nValue = (nValue << 4) | ((c & 0xF) + 9 * (c >> 6));
+    }
+    return nValue;
+}
+//reads a \u escape (pRead at the u) and the low surrogate that may follow it, returns the code point or -1
+int Json_ReadEscapedCodePoint(const byte** pRead, char** pError)
+{
+    int nCodePoint = Json_ReadHex4(*pRead + 1);
+    if (nCodePoint < 0)
+    {
+        *pError = "invalid unicode encoding";
+        return -1;
+    }
+    *pRead += 4;//at the last hex digit
+    if (nCodePoint >= 0xD800 && nCodePoint <= 0xDBFF && (*pRead)[1] == '\\' && (*pRead)[2] == 'u')
+    {
+        int nLow = Json_ReadHex4(*pRead + 3);
+        if (nLow >= 0xDC00 && nLow <= 0xDFFF)
+        {
+            *pRead += 6;
+            return 0x10000 + ((nCodePoint - 0xD800) << 10) + (nLow - 0xDC00);
+        }
+    }
+    if (nCodePoint >= 0xD800 && nCodePoint <= 0xDFFF)
+    {
+        *pError = "invalid unicode surrogate";
+        return -1;
+    }
+    if (nCodePoint == 0)//large strings are measured up to their null, so one inside would cut them
+    {
+        *pError = "strings with a null char can't be stored";
+        return -1;
+    }
+    return nCodePoint;
+}
+//never longer than the escape it comes from, 6 chars give at most 3 bytes and a surrogate pair of 12 chars gives 4
+int Json_WriteUtf8(byte* pWrite, int nCodePoint)
+{
+    if (nCodePoint < 0x80)
+    {
+        pWrite[0] = (byte)nCodePoint;
+        return 1;
+    }
+    if (nCodePoint < 0x800)
+    {
+        pWrite[0] = (byte)(0xC0 | (nCodePoint >> 6));
+        pWrite[1] = (byte)(0x80 | (nCodePoint & 0x3F));
+        return 2;
+    }
+    if (nCodePoint < 0x10000)
+    {
+        pWrite[0] = (byte)(0xE0 | (nCodePoint >> 12));
+        pWrite[1] = (byte)(0x80 | ((nCodePoint >> 6) & 0x3F));
+        pWrite[2] = (byte)(0x80 | (nCodePoint & 0x3F));
+        return 3;
+    }
+    pWrite[0] = (byte)(0xF0 | (nCodePoint >> 18));
+    pWrite[1] = (byte)(0x80 | ((nCodePoint >> 12) & 0x3F));
+    pWrite[2] = (byte)(0x80 | ((nCodePoint >> 6) & 0x3F));
+    pWrite[3] = (byte)(0x80 | (nCodePoint & 0x3F));
+    return 4;
+}
+//checks a run of raw chars is well formed utf-8, overlong encodings and surrogates are rejected
+//blocks of 16 ascii chars are skipped at once, only the multi byte sequences are decoded
+int Json_IsValidUtf8(const byte* pRead, const byte* pEnd)
+{
+    while (pRead < pEnd)
+    {
+#if JSON_SIMD_SSE2
+        while (pEnd - pRead >= 16 && _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)pRead)) == 0)
+            pRead += 16;
+        if (pRead == pEnd)
+            break;
+#endif
+        byte c = *pRead;
+        if (c < 0x80)
+        {
+            pRead++;
+            continue;
+        }
+        int nFollow;
+        byte nMin = 0x80;
+        byte nMax = 0xBF;
+        if (c >= 0xC2 && c <= 0xDF)
+            nFollow = 1;
+        else if (c >= 0xE0 && c <= 0xEF)
+        {
+            nFollow = 2;
+            if (c == 0xE0)
+                nMin = 0xA0;
+            else if (c == 0xED)
+                nMax = 0x9F;
+        }
+        else if (c >= 0xF0 && c <= 0xF4)
+        {
+            nFollow = 3;
+            if (c == 0xF0)
+                nMin = 0x90;
+            else if (c == 0xF4)
+                nMax = 0x8F;
+        }
+        else
+            return 0;
+        if (pEnd - pRead <= nFollow || pRead[1] < nMin || pRead[1] > nMax)
+            return 0;
+        for (int i = 2; i <= nFollow; i++)
+            if ((pRead[i] & 0xC0) != 0x80)
+                return 0;
+        pRead += nFollow + 1;
+    }
+    return 1;
+}
+//moves the chars up to the next " \\ or null, returns where it stopped, pHighBits gets the or of the chars
+byte* Json_CopyPlainRun(byte* pRead, byte* pWrite, byte* pEnd, byte* pHighBits)
+{
+    byte nBits = 0;
+#if JSON_SIMD_SSE2
+    __m128i vQuote = _mm_set1_epi8('"');
+    __m128i vBackslash = _mm_set1_epi8('\\');
+    __m128i vHigh = _mm_setzero_si128();
+    while (pRead + 16 <= pEnd)
+    {
+        __m128i vChars = _mm_loadu_si128((const __m128i*)pRead);
+        int nMask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(vChars, vQuote), _mm_cmpeq_epi8(vChars, vBackslash)));
+        if (nMask)
+        {
+            int nCount = json_ctz(nMask);
+            if (_mm_movemask_epi8(vChars) & ((1 << nCount) - 1))
+                nBits |= 0x80;
+            memmove(pWrite, pRead, nCount);
+            pRead += nCount;
+            break;
         }
+        _mm_storeu_si128((__m128i*)pWrite, vChars);//the write cursor is never ahead of the read cursor
+        vHigh = _mm_or_si128(vHigh, vChars);
+        pRead += 16;
+        pWrite += 16;
     }
+    if (_mm_movemask_epi8(vHigh))
+        nBits |= 0x80;
+#endif
+    while (*pRead && *pRead != '"' && *pRead != '\\')
+    {
+        nBits |= *pRead;
+        *(pWrite++) = *(pRead++);
+    }
+    *pHighBits = nBits;
+    return pRead;
 }
 void Json_ParseString(JsonCursors* oCursors)
 {
     byte sCurrent = 0;
-    int nLen = 2;
+    uint64 nLen = 2;
     byte* pMarker = oCursors->pWrite;//where to put the type, will be the " char
     oCursors->pWrite += 1;//leave space for the type
     oCursors->pRead += 1;//skip the first "
@@ -222,36 +424,14 @@ void Json_ParseString(JsonCursors* oCursors)
                 *(oCursors->pWrite) = '\r';
             else if (sNext == 't')//tab
                 *(oCursors->pWrite) = '\t';
-            else if (sNext == 'u')//we are gonna read the next 4 hex chars
+            else if (sNext == 'u')//the code point is written as utf-8, joining surrogate pairs
             {
-                byte a = *(++(oCursors->pRead));
-                if (a == '\0')
-                    return;//"unexpected end of stream" 
-                byte b = *(++(oCursors->pRead));
-                if (b == '\0')
-                    return;//"unexpected end of stream"
-                byte c = *(++(oCursors->pRead));
-                if (c == '\0')
-                    return;//"unexpected end of stream"
-                byte d = *(++(oCursors->pRead));
-                if (d == '\0')
-                    return;//"unexpected end of stream"
-
-                if (!((a >= '0' && a <= '9') || (a >= 'a' && a <= 'f') || (a >= 'A' && a <= 'F'))
-                    || !((b >= '0' && b <= '9') || (b >= 'a' && b <= 'f') || (b >= 'A' && b <= 'F'))
-                    || !((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'))
-                    || !((d >= '0' && d <= '9') || (d >= 'a' && d <= 'f') || (d >= 'A' && d <= 'F')))
-                {
-                    oCursors->pError = "invalid unicode encoding";
+                int nCodePoint = Json_ReadEscapedCodePoint((const byte**)&oCursors->pRead, &oCursors->pError);
+                if (nCodePoint < 0)
                     return;
-                }
-                a = (a & 0xF) + 9 * (a >> 6);
-                b = (b & 0xF) + 9 * (b >> 6);
-                c = (c & 0xF) + 9 * (c >> 6);
-                d = (d & 0xF) + 9 * (d >> 6);
-                (*((uint16*)oCursors->pWrite)) = (uint16)((a << 12) | (b << 8) | (c << 4) | d);
-                oCursors->pWrite += 1;
-                nLen++; // the second byte will be incremented after the if
+                int nSize = Json_WriteUtf8(oCursors->pWrite, nCodePoint);
+                oCursors->pWrite += nSize - 1;
+                nLen += nSize - 1; // the last byte will be incremented after the if
             }
             else
             {
@@ -264,47 +444,147 @@ void Json_ParseString(JsonCursors* oCursors)
             return;//"unexpected end of stream"
         else
         {
-            *(oCursors->pWrite) = sCurrent;
-            nLen++;
+            byte nHighBits = 0;
+            byte* pRun = oCursors->pRead;
+            oCursors->pRead = Json_CopyPlainRun(pRun, oCursors->pWrite, oCursors->pEnd, &nHighBits);
+            if (oCursors->bValidateUtf8 && (nHighBits & 0x80) && !Json_IsValidUtf8(oCursors->pWrite, oCursors->pWrite + (oCursors->pRead - pRun)))
+            {
+                oCursors->pError = "invalid utf-8 sequence";
+                return;
+            }
+            nLen += oCursors->pRead - pRun;
+            oCursors->pWrite += oCursors->pRead - pRun;
+            continue;
         }
         oCursors->pRead += 1;
         oCursors->pWrite += 1;
     }
 }
-void Json_ParseNumber(JsonCursors* oCursors)
+int Json_SizeOfMantissa(long long nMantissa)
+{
+    if (nMantissa >= 0 && nMantissa < 10) // 0,1,2,2,4,5,6,7,8,9
+        return 1;
+    else if (nMantissa >= -128 && nMantissa <= 127)
+        return 2;
+    else if (nMantissa >= -32768 && nMantissa <= 32767)
+        return 3;
+    else if (nMantissa >= -2147483648 && nMantissa <= 2147483647)
+        return 5;
+    else if (nMantissa >= -9223372036854775806LL && nMantissa <= 9223372036854775807LL)
+        return 9;
+    return 0;
+}
+byte* Json_WriteNumberMarkers(byte* pWrite, long long nMantissa, long long nExponent, int bWriteExponent, int nMantissaSize)
+{
+    if (bWriteExponent)
+        *(pWrite++) = (byte)((nExponent << 3) | JsonMarkerExponent);
+
+    //write the int part, the size may be larger than the minimum if a slot must be filled
+    if (nMantissaSize == 1)
+    {
+        *(pWrite++) = (byte)((nMantissa << 4) | JsonMarkerDigit);
+    }
+    else if (nMantissaSize == 2)
+    {
+        *(pWrite++) = (byte)((1 << 5) | JsonMarkerInt);
+        *((int8*)pWrite) = (int8)nMantissa;
+        pWrite += 1;
+    }
+    else if (nMantissaSize == 3)
+    {
+        *(pWrite++) = (byte)((2 << 5) | JsonMarkerInt);
+        *((int16*)pWrite) = (int16)nMantissa;
+        pWrite += 2;
+    }
+    else if (nMantissaSize == 5)
+    {
+        *(pWrite++) = (byte)((3 << 5) | JsonMarkerInt);
+        *((int32*)pWrite) = (int32)nMantissa;
+        pWrite += 4;
+    }
+    else if (nMantissaSize == 9)
+    {
+        *(pWrite++) = (byte)((4 << 5) | JsonMarkerInt);
+        *((int64*)pWrite) = (int64)nMantissa;
+        pWrite += 8;
+    }
+    return pWrite;
+}
+//powers of 10 up to 10^22 are exact doubles, dividing by them keeps 0.3 as 3 / 10 instead of 3 * 0.1 (0.30000000000000004)
+double Json_ScaleMantissa(double nMantissa, int nExponent)
+{
+    if (nExponent < 0)
+        return nMantissa / pow(10.0, -nExponent);
+    return nMantissa * pow(10.0, nExponent);
+}
+int Json_DecomposeNumber(double nValue, long long* pMantissa, long long* pExponent)
+{
+    if (nValue != nValue || nValue - nValue != 0)//NaN and infinity have no json representation
+        return 0;
+    //find the smallest decimal exponent that reads back exactly the same double
+    for (int nExponent = 0; nExponent >= -16; nExponent--)
+    {
+        double nScaled = nValue * pow(10.0, -nExponent);
+        if (fabs(nScaled) >= 9.2e18)
+            break;
+        long long nMantissa = llround(nScaled);
+        if (Json_ScaleMantissa((double)nMantissa, nExponent) == nValue)
+        {
+            *pMantissa = nMantissa;
+            *pExponent = nExponent;
+            return 1;
+        }
+    }
+    for (int nExponent = 1; nExponent <= 15; nExponent++)
+    {
+        double nScaled = nValue / pow(10.0, nExponent);
+        if (fabs(nScaled) >= 9.2e18)
+            continue;
+        long long nMantissa = llround(nScaled);
+        if (Json_ScaleMantissa((double)nMantissa, nExponent) == nValue)
+        {
+            *pMantissa = nMantissa;
+            *pExponent = nExponent;
+            return 1;
+        }
+    }
+    return 0;
+}
+//reads the text of a number as a mantissa and a decimal exponent, returns where the number ends
+const byte* Json_ReadNumber(const byte* pRead, long long* pMantissa, long long* pExponent, char** pError)
 {
     bool bIsNegative = 0;
     long long nMantissa = 0;
     long long nExponent = 0;
     int nDigits = 0;
-    if (bIsNegative = *(oCursors->pRead) == '-')
-        oCursors->pRead++;
+    if (bIsNegative = *(pRead) == '-')
+        pRead++;
 
-    while (*(oCursors->pRead) >= '0' && *(oCursors->pRead) <= '9')
+    while (*(pRead) >= '0' && *(pRead) <= '9')
     {
         if (nMantissa < 9223372036854775797LL)
-            nMantissa = (nMantissa * 10) + (*(oCursors->pRead)++ - '0');
+            nMantissa = (nMantissa * 10) + (*(pRead)++ - '0');
         else
             nExponent++;
         nDigits++;
     }
     if (nDigits == 0)
     {
-        oCursors->pError = "numerical value must start with a digit";
-        return;
+        *pError = "numerical value must start with a digit";
+        return pRead;
     }
     nDigits = 0;
 
-    if (*(oCursors->pRead) == '.')//has decimals
+    if (*(pRead) == '.')//has decimals
     {
-        oCursors->pRead++;//skip the .
+        pRead++;//skip the .
         int nTrailingZeros = 0;
-        while (*(oCursors->pRead) >= '0' && *(oCursors->pRead) <= '9')
+        while (*(pRead) >= '0' && *(pRead) <= '9')
         {
             nDigits++;
             if (nMantissa < 9223372036854775797LL)
             {
-                char nDigit = (*(oCursors->pRead)++ - '0');
+                char nDigit = (*(pRead)++ - '0');
                 if (nDigit == 0)//if have a 0, don't push the mantissa because if it is a trailing 0 we will be loosing accuracy for nothing 
                 {
                     nTrailingZeros++;
@@ -315,6 +595,7 @@ void Json_ParseNumber(JsonCursors* oCursors)
                     int nOffset = (int64)pow(10, nTrailingZeros);
                     nMantissa *= nOffset;
                     nExponent -= nTrailingZeros;
+                    nTrailingZeros = 0;
                 }
                 nMantissa = (nMantissa * 10) + nDigit;
                 nExponent--;
@@ -323,28 +604,28 @@ void Json_ParseNumber(JsonCursors* oCursors)
         }
         if (nDigits == 0)
         {
-            oCursors->pError = "numerical value must have a digits after decimal point";
-            return;
+            *pError = "numerical value must have a digits after decimal point";
+            return pRead;
         }
         nDigits = 0;
     }
-    if (*(oCursors->pRead) == 'e' || *(oCursors->pRead) == 'e')//has exponent
+    if (*(pRead) == 'e' || *(pRead) == 'e')//has exponent
     {
         long long nExplicitExponent = 0;
         bool bIsExplicitExponentNegative = 0;
-        oCursors->pRead++;//skip the "e"
-        if (bIsExplicitExponentNegative = *(oCursors->pRead) == '-')
-            oCursors->pRead++;
+        pRead++;//skip the "e"
+        if (bIsExplicitExponentNegative = *(pRead) == '-')
+            pRead++;
 
-        while (*(oCursors->pRead) >= '0' && *(oCursors->pRead) <= '9')
+        while (*(pRead) >= '0' && *(pRead) <= '9')
         {
-            nExplicitExponent = (nExplicitExponent * 10) + (*(oCursors->pRead)++ - '0');
+            nExplicitExponent = (nExplicitExponent * 10) + (*(pRead)++ - '0');
             nDigits++;
         }
         if (nDigits == 0)
         {
-            oCursors->pError = "numerical value must have a digits after exponent ";
-            return;
+            *pError = "numerical value must have a digits after exponent ";
+            return pRead;
         }
         if (bIsExplicitExponentNegative)
             nExplicitExponent = -nExplicitExponent;
@@ -353,66 +634,52 @@ void Json_ParseNumber(JsonCursors* oCursors)
     }
     if (bIsNegative)
         nMantissa = -nMantissa;
+    *pMantissa = nMantissa;
+    *pExponent = nExponent;
+    return pRead;
+}
+void Json_ParseNumber(JsonCursors* oCursors)
+{
+    long long nMantissa = 0;
+    long long nExponent = 0;
+    oCursors->pRead = (byte*)Json_ReadNumber(oCursors->pRead, &nMantissa, &nExponent, &oCursors->pError);
+    if (oCursors->pError)
+        return;
     //double nValue = nMantissa * pow(10.0, nExponent);
 
-    if (nExponent != 0)
-    {
-        if (nExponent < -16 || nExponent > 15)
-        {
-            oCursors->pError = "parser does not support more than 16 decimal places";
-            return;
-        }
-        *(oCursors->pWrite) = (byte)((nExponent << 3) | JsonMarkerExponent);
-        oCursors->pWrite += 1;
-    }
-
-
-    //write the int part
-    if (nMantissa >= 0 && nMantissa < 10) // 0,1,2,2,4,5,6,7,8,9
-    {
-        *(oCursors->pWrite++) = (byte)((nMantissa << 4) | JsonMarkerDigit);
-    }
-    else if (nMantissa >= -128 && nMantissa <= 127)
-    {
-        *(oCursors->pWrite++) = (byte)((1 << 5) | JsonMarkerInt);
-        *((int8*)oCursors->pWrite) = (int8)nMantissa;
-        oCursors->pWrite += 1;
-    }
-    else if (nMantissa >= -32768 && nMantissa <= 32767)
-    {
-        *(oCursors->pWrite++) = (byte)((2 << 5) | JsonMarkerInt);
-        *((int16*)oCursors->pWrite) = (int16)nMantissa;
-        oCursors->pWrite += 2;
-    }
-    else if (nMantissa >= -2147483648 && nMantissa <= 2147483647)
+    if (nExponent < -16 || nExponent > 15)
     {
-        *(oCursors->pWrite++) = (byte)((3 << 5) | JsonMarkerInt);
-        *((int32*)oCursors->pWrite) = (int32)nMantissa;
-        oCursors->pWrite += 4;
-    }
-    else if (nMantissa >= -9223372036854775806LL && nMantissa <= 9223372036854775807LL)
-    {
-        *(oCursors->pWrite++) = (byte)((4 << 5) | JsonMarkerInt);
-        *((int64*)oCursors->pWrite) = (int64)nMantissa;
-        oCursors->pWrite += 8;
+        oCursors->pError = "parser does not support more than 16 decimal places";
+        return;
     }
-    else//out of range should not happen because double as less precision than int64
+    int nMantissaSize = Json_SizeOfMantissa(nMantissa);
+    if (nMantissaSize == 0)//out of range should not happen because double as less precision than int64
     {
         oCursors->pError = "numeric value out of range";
+        return;
     }
+    oCursors->pWrite = Json_WriteNumberMarkers(oCursors->pWrite, nMantissa, nExponent, nExponent != 0, nMantissaSize);
 }
 void Json_ParseUnkown(JsonCursors* oCursors)
 {
-    oCursors->pRead = Json_SkipWhitespace(oCursors->pRead);
+    oCursors->pRead = Json_SkipCursorWhitespace(oCursors, oCursors->pRead);
     byte sCurrent = *(oCursors->pRead);
     if (sCurrent == '{')
         Json_ParseObject(oCursors);
     else if (sCurrent == '[')
         Json_ParseArray(oCursors);
     else if (sCurrent == '"')
+    {
+        JSON_PROFILE_BEGIN(nStart);
         Json_ParseString(oCursors);
+        JSON_PROFILE_END(oCursors, StringCycles, nStart);
+    }
     else if ((sCurrent >= '0' && sCurrent <= '9') || sCurrent == '-' || sCurrent == '.')
+    {
+        JSON_PROFILE_BEGIN(nStart);
         Json_ParseNumber(oCursors);
+        JSON_PROFILE_END(oCursors, NumberCycles, nStart);
+    }
     else if (sCurrent == 'n' && *(oCursors->pRead + 1) == 'u' && *(oCursors->pRead + 2) == 'l' && *(oCursors->pRead + 3) == 'l')
     {
         *(oCursors->pWrite) = JsonMarkerNull;
@@ -440,10 +707,10 @@ void Json_ParseUnkown(JsonCursors* oCursors)
 /*************************
  * loading functions
 **************************/
-uint32 Json_GetSize(const byte* pJson)
+uint64 Json_GetSize(const byte* pJson)
 {
     byte nType = *pJson;
-    uint32 nSize = 0;
+    uint64 nSize = 0;
     switch (nType & 0x3)
     {
         case JsonMarkerSmallString:
@@ -468,7 +735,7 @@ uint32 Json_GetSize(const byte* pJson)
                     pJson++;
                     while (*pJson != JsonMarkerSequenceEnd)
                     {
-                        uint32 nItemSize = Json_GetSize(pJson);
+                        uint64 nItemSize = Json_GetSize(pJson);
                         pJson += nItemSize;
                         nSize += nItemSize;
                     }
@@ -556,7 +823,7 @@ JsonObject Json_LoadUnkown(const byte* pJson)
                         if (oMantissa.Type == JsonTypeNumber)
                         {
                             oJson.Type = JsonTypeNumber;
-                            oJson.DoubleValue = oMantissa.DoubleValue * pow(10.0, nExponent);
+                            oJson.DoubleValue = Json_ScaleMantissa(oMantissa.DoubleValue, nExponent);
                         }
                         else
                             oJson.Type = JsonTypeInvalid;
@@ -606,7 +873,7 @@ JsonProperty Json_IterateProperties(JsonObject oJsonObject)
     if (oJsonObject.Type != JsonTypeObject)
         return oProperty;
     oProperty.Position = oJsonObject.Position + 1;
-    uint32 nKeySize = Json_GetSize(oProperty.Position);
+    uint64 nKeySize = Json_GetSize(oProperty.Position);
     oProperty.Name = oProperty.Position + 1;
     oProperty.Value = Json_LoadUnkown(oProperty.Position + nKeySize);
     return oProperty;
@@ -620,14 +887,14 @@ JsonProperty Json_NextProperty(JsonProperty oJsonPreviousProperty)
     if (oJsonPreviousProperty.Value.Type == JsonTypeInvalid || oJsonPreviousProperty.Position == 0)
         return oProperty;
 
-    uint32 nPreviousKeySize = Json_GetSize(oJsonPreviousProperty.Position);
-    uint32 nPreviousValueSize = Json_GetSize(oJsonPreviousProperty.Position + nPreviousKeySize);
+    uint64 nPreviousKeySize = Json_GetSize(oJsonPreviousProperty.Position);
+    uint64 nPreviousValueSize = Json_GetSize(oJsonPreviousProperty.Position + nPreviousKeySize);
     const  byte* pNextPosition = oJsonPreviousProperty.Position + nPreviousKeySize + nPreviousValueSize;
     if (*(pNextPosition) == JsonMarkerSequenceEnd)
         return oProperty;
 
     oProperty.Position = pNextPosition;
-    uint32 nNextKeySize = Json_GetSize(oProperty.Position);
+    uint64 nNextKeySize = Json_GetSize(oProperty.Position);
     oProperty.Name = oProperty.Position + 1;
     oProperty.Value = Json_LoadUnkown(oProperty.Position + nNextKeySize);
     return oProperty;
@@ -647,29 +914,29 @@ JsonProperty Json_GetPropertyByName(JsonObject oJsonObject, char* pName)
     oProperty.Name = oProperty.Position + 1;
     while (strcmp(oProperty.Name, pName) != 0)
     {
-        uint32 nKeySize = Json_GetSize(oProperty.Position);
-        uint32 nValueSize = Json_GetSize(oProperty.Position + nKeySize);
+        uint64 nKeySize = Json_GetSize(oProperty.Position);
+        uint64 nValueSize = Json_GetSize(oProperty.Position + nKeySize);
         oProperty.Position += nKeySize + nValueSize;
         if (*oProperty.Position == JsonMarkerSequenceEnd)//reached end of object
             return oProperty;
         oProperty.Name = oProperty.Position + 1;
     }
 
-    uint32 nKeySize = Json_GetSize(oProperty.Position);
+    uint64 nKeySize = Json_GetSize(oProperty.Position);
     oProperty.Value = Json_LoadUnkown(oProperty.Position + nKeySize);
     return oProperty;
 }
-int Json_GetPropertyCount(JsonObject oJsonObject)
+long long Json_GetPropertyCount(JsonObject oJsonObject)
 {
     if (oJsonObject.Type != JsonTypeObject)
         return -1;
     const byte* pPosition = oJsonObject.Position + 1;
-    int nCount = 0;
+    long long nCount = 0;
     while (*pPosition != JsonMarkerSequenceEnd)
     {
         nCount++;
-        uint32 nKeySize = Json_GetSize(pPosition);
-        uint32 nValueSize = Json_GetSize(pPosition + nKeySize);
+        uint64 nKeySize = Json_GetSize(pPosition);
+        uint64 nValueSize = Json_GetSize(pPosition + nKeySize);
         pPosition += nKeySize + nValueSize;
     }
     return nCount;
@@ -697,7 +964,7 @@ JsonElement Json_NextElement(JsonElement oJsonPreviousElement)
     if (oJsonPreviousElement.Value.Type == JsonTypeInvalid || oJsonPreviousElement.Position == 0)
         return oElement;
 
-    uint32 nPreviousValueSize = Json_GetSize(oJsonPreviousElement.Position);
+    uint64 nPreviousValueSize = Json_GetSize(oJsonPreviousElement.Position);
     const byte* pNextPosition = oJsonPreviousElement.Position + nPreviousValueSize;
     if (*(pNextPosition) == JsonMarkerSequenceEnd)
         return oElement;
@@ -708,7 +975,7 @@ JsonElement Json_NextElement(JsonElement oJsonPreviousElement)
     return oElement;
 }
 
-JsonElement Json_GetElementAtIndex(JsonObject oJsonArray, int nIndex)
+JsonElement Json_GetElementAtIndex(JsonObject oJsonArray, long long nIndex)
 {
     JsonElement oElement;
     oElement.Position = 0;
@@ -721,7 +988,7 @@ JsonElement Json_GetElementAtIndex(JsonObject oJsonArray, int nIndex)
         return oElement;
     while (nIndex > 0)
     {
-        uint32 nValueSize = Json_GetSize(oElement.Position);
+        uint64 nValueSize = Json_GetSize(oElement.Position);
         oElement.Position += nValueSize;
         if (*oElement.Position == JsonMarkerSequenceEnd)//reached end of object
             return oElement;
@@ -732,22 +999,123 @@ JsonElement Json_GetElementAtIndex(JsonObject oJsonArray, int nIndex)
     return oElement;
 }
 
-int Json_GetElementCount(JsonObject oJsonArray)
+long long Json_GetElementCount(JsonObject oJsonArray)
 {
     if (oJsonArray.Type != JsonTypeArray)
         return -1;
     const byte* pPosition = oJsonArray.Position + 1;
-    int nCount = 0;
+    long long nCount = 0;
     while (*pPosition != JsonMarkerSequenceEnd)
     {
         nCount++;
-        uint32 nValueSize = Json_GetSize(pPosition);
+        uint64 nValueSize = Json_GetSize(pPosition);
         pPosition += nValueSize;
     }
     return nCount;
 }
 
+/*************************
+ * parse statistics
+ * the counts are taken from the parsed encoding after the parse, so the parser itself does no extra work,
+ * only the escapes are counted on the text before it is overwritten
+**************************/
+
+//in a run of backslashes every pair is an escaped \\, an odd one left escapes the next char
+long long Json_CountEscapeSequences(const byte* pJson)
+{
+    long long nEscapes = 0;
+    while ((pJson = (const byte*)strchr((const char*)pJson, '\\')))
+    {
+        const byte* pRun = pJson;
+        while (*pJson == '\\')
+            pJson++;
+        nEscapes += (pJson - pRun + 1) / 2;
+    }
+    return nEscapes;
+}
+
+void Json_CountString(const byte* pJson, JsonParseStats* pStats)
+{
+    if (*pJson == JsonMarkerLargeString)
+    {
+        pStats->LargeStrings++;
+        pStats->StringBytes += strlen((const char*)pJson + 1);
+    }
+    else
+    {
+        pStats->SmallStrings++;
+        pStats->StringBytes += (*pJson >> 2) - 2;
+    }
+}
+
+//returns the position after the value
+const byte* Json_CollectStats(const byte* pJson, int nDepth, JsonParseStats* pStats)
+{
+    byte nType = *pJson;
+    if (nType == JsonMarkerNull)
+        pStats->Nulls++;
+    else if (nType == JsonMarkerTrue || nType == JsonMarkerFalse)
+        pStats->Bools++;
+    else if ((nType & 0x3) == JsonMarkerSmallString || nType == JsonMarkerLargeString)
+    {
+        pStats->Strings++;
+        Json_CountString(pJson, pStats);
+    }
+    else if ((nType & 0x3) == JsonMarkerSmallObject || (nType & 0x3) == JsonMarkerSmallArray || nType == JsonMarkerLargeObject || nType == JsonMarkerLargeArray)
+    {
+        int bIsObject = (nType & 0x3) == JsonMarkerSmallObject || nType == JsonMarkerLargeObject;
+        int bIsLarge = (nType & 0x3) == 0;
+        if (bIsObject)
+            *(bIsLarge ? &pStats->LargeObjects : &pStats->SmallObjects) += 1;
+        else
+            *(bIsLarge ? &pStats->LargeArrays : &pStats->SmallArrays) += 1;
+        if (nDepth + 1 > pStats->MaxDepth)
+            pStats->MaxDepth = nDepth + 1;
+        const byte* pChild = pJson + 1;
+        while (*pChild != JsonMarkerSequenceEnd)
+        {
+            if (bIsObject)
+            {
+                pStats->Keys++;
+                Json_CountString(pChild, pStats);
+                pChild += Json_GetSize(pChild);
+            }
+            pChild = Json_CollectStats(pChild, nDepth + 1, pStats);
+        }
+        return pChild + 1;
+    }
+    else
+    {
+        pStats->Numbers++;
+        const byte* pMantissa = pJson;
+        if ((nType & 0b00000111) == JsonMarkerExponent)
+        {
+            pStats->Exponents++;
+            pMantissa++;
+        }
+        if ((*pMantissa & 0b00001111) == JsonMarkerDigit)
+            pStats->Digits++;
+        else if ((*pMantissa >> 5) == 1)
+            pStats->Int8s++;
+        else if ((*pMantissa >> 5) == 2)
+            pStats->Int16s++;
+        else if ((*pMantissa >> 5) == 3)
+            pStats->Int32s++;
+        else
+            pStats->Int64s++;
+    }
+    return pJson + Json_GetSize(pJson);
+}
+
 JsonResult Json_Parse(char* pJson)
+{
+    return Json_ParseWithStats(pJson, 0, 0);
+}
+JsonResult Json_ParseWithOptions(char* pJson, int nOptions)
+{
+    return Json_ParseWithStats(pJson, nOptions, 0);
+}
+JsonResult Json_ParseWithStats(char* pJson, int nOptions, JsonParseStats* pStats)
 {
     JsonResult oResult;
     oResult.InitialSize = 0;
@@ -761,21 +1129,32 @@ JsonResult Json_Parse(char* pJson)
     oCursors.pRead = pJson;
     oCursors.pWrite = pJson;
     oCursors.pError = 0;
+    oCursors.pEnd = (byte*)pJson + strlen(pJson);
+    oCursors.bValidateUtf8 = (nOptions & JsonParseValidateUtf8) != 0;
+    oCursors.pStats = pStats;
+    if (pStats)
+    {
+        memset(pStats, 0, sizeof(JsonParseStats));
+        pStats->Escapes = Json_CountEscapeSequences((byte*)pJson);
+    }
+    JSON_PROFILE_BEGIN(nStart);
     Json_ParseUnkown(&oCursors);
+    JSON_PROFILE_END(&oCursors, ParseCycles, nStart);
     if (oCursors.pError)
     {
         oResult.Error = oCursors.pError;
-        oResult.Index = (int)(oCursors.pRead - (byte*)pJson);
+        oResult.Index = oCursors.pRead - (byte*)pJson;
         return oResult;
     }
     else
     {
-        oResult.InitialSize = (int)(oCursors.pRead - (byte*)pJson);
-        oResult.EndSize = (int)(oCursors.pWrite - (byte*)pJson);
-        while (*(oCursors.pWrite) != 0)
-            *(oCursors.pWrite++) = 0;
+        oResult.InitialSize = oCursors.pRead - (byte*)pJson;
+        oResult.EndSize = oCursors.pWrite - (byte*)pJson;
+        memset(oCursors.pWrite, 0, oCursors.pEnd - oCursors.pWrite);
         oResult.RootObject = Json_LoadUnkown((unsigned char*)pJson);
         oResult.Success = 1;
+        if (pStats)
+            Json_CollectStats((byte*)pJson, 0, pStats);
 
     }
     return  oResult;
@@ -784,3 +1163,60 @@ JsonObject Json_Load(const char* pJson)
 {
     return Json_LoadUnkown((byte*)pJson);
 }
+
+
+/******************************
+* Subtree functions
+*******************************/
+
+long long Json_MeasureSubtree(JsonObject oJsonObject)
+{
+    if (oJsonObject.Type == JsonTypeInvalid || oJsonObject.Position == 0)
+        return -1;
+    return (long long)Json_GetSize(oJsonObject.Position);
+}
+
+JsonObject Json_CopySubtree(JsonObject oJsonObject, char* pBuffer, long long nBufferSize)
+{
+    JsonObject oCopy;
+    oCopy.Position = 0;
+    oCopy.Type = JsonTypeInvalid;
+    long long nSize = Json_MeasureSubtree(oJsonObject);
+    if (nSize < 0 || nSize > nBufferSize)
+        return oCopy;
+    memmove(pBuffer, oJsonObject.Position, nSize);//a subtree is always a contiguous run of markers
+    return Json_LoadUnkown((byte*)pBuffer);
+}
+
+void Json_InitArena(JsonArena* pArena, char* pMemory, long long nSize)
+{
+    pArena->Memory = pMemory;
+    pArena->Size = nSize;
+    pArena->Used = 0;
+}
+
+JsonObject Json_CopySubtreeToArena(JsonArena* pArena, JsonObject oJsonObject)
+{
+    JsonObject oCopy = Json_CopySubtree(oJsonObject, pArena->Memory + pArena->Used, pArena->Size - pArena->Used);
+    if (oCopy.Type != JsonTypeInvalid)
+        pArena->Used += Json_GetSize(oCopy.Position);
+    return oCopy;
+}
+
+int Json_CompactSubtrees(JsonArena* pArena, JsonObject* pObjects, int nCount)
+{
+    long long nTotalSize = 0;
+    for (int i = 0; i < nCount; i++)
+    {
+        long long nSize = Json_MeasureSubtree(pObjects[i]);
+        if (nSize < 0)
+            return 0;
+        nTotalSize += nSize;
+    }
+    if (nTotalSize > pArena->Size - pArena->Used)//check everything fits before touching any object
+        return 0;
+
+    for (int i = 0; i < nCount; i++)
+        pObjects[i] = Json_CopySubtreeToArena(pArena, pObjects[i]);
+    return 1;
+}
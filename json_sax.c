@@ -0,0 +1,364 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+
+#include "json.h"
+
+typedef  signed char        int8;
+typedef  unsigned char      uint8;
+typedef  signed short       int16;
+typedef  unsigned short     uint16;
+typedef  signed int         int32;
+typedef  unsigned int       uint32;
+typedef  signed long long   int64;
+typedef  unsigned long long uint64;
+
+typedef  unsigned char      bool;
+typedef  unsigned char      byte;
+
+//implemented in json_read.c
+const byte* Json_ReadNumber(const byte* pRead, long long* pMantissa, long long* pExponent, char** pError);
+double Json_ScaleMantissa(double nMantissa, int nExponent);
+int Json_ReadEscapedCodePoint(const byte** pRead, char** pError);
+int Json_WriteUtf8(byte* pWrite, int nCodePoint);
+
+/*************************
+ * event parsing
+ * the text is only read, strings are decoded into the scratch area and numbers into a double,
+ * each value is reported to the handler as soon as it is read
+**************************/
+
+typedef struct JsonEventCursors
+{
+    const byte* pRead;
+    char* pError;
+    const JsonEventHandler* pHandler;
+    char* pScratch;
+    int nScratchSize;
+} JsonEventCursors;
+
+void Json_ParseEventValue(JsonEventCursors* oCursors);
+
+const byte* Json_SkipEventWhitespace(const byte* pJson)
+{
+    while (*pJson > 0 && *pJson <= 32)
+        pJson++;
+    return pJson;
+}
+
+//turns the answer of a callback into the action to take, a missing callback just continues
+int Json_EventAction(JsonEventCursors* oCursors, int nAction)
+{
+    if (nAction == JsonEventAbort)
+        oCursors->pError = "parsing aborted by the handler";
+    return nAction;
+}
+
+const byte* Json_SkipEventString(const byte* pRead)
+{
+    pRead++;//skip the first "
+    while (*pRead && *pRead != '"')
+    {
+        if (*pRead == '\\' && *(pRead + 1))
+            pRead++;
+        pRead++;
+    }
+    return *pRead ? pRead + 1 : pRead;
+}
+
+//skips until the scope that is nDepth levels up is closed, nothing inside is decoded or validated
+const byte* Json_SkipEventScope(const byte* pRead, int nDepth)
+{
+    while (*pRead && nDepth > 0)
+    {
+        byte sCurrent = *pRead;
+        if (sCurrent == '"')
+        {
+            pRead = Json_SkipEventString(pRead);
+            continue;
+        }
+        if (sCurrent == '{' || sCurrent == '[')
+            nDepth++;
+        else if (sCurrent == '}' || sCurrent == ']')
+            nDepth--;
+        pRead++;
+    }
+    return pRead;
+}
+
+const byte* Json_SkipEventValue(const byte* pRead)
+{
+    pRead = Json_SkipEventWhitespace(pRead);
+    if (*pRead == '{' || *pRead == '[')
+        return Json_SkipEventScope(pRead + 1, 1);
+    if (*pRead == '"')
+        return Json_SkipEventString(pRead);
+    while (*pRead > 32 && *pRead != ',' && *pRead != '}' && *pRead != ']')
+        pRead++;
+    return pRead;
+}
+
+//decodes the string at the read cursor into the scratch area, returns its length or -1
+int Json_ReadEventString(JsonEventCursors* oCursors)
+{
+    const byte* pRead = oCursors->pRead + 1;//skip the first "
+    byte* pWrite = (byte*)oCursors->pScratch;
+    byte* pLimit = pWrite + oCursors->nScratchSize - 4;//room for the longest utf-8 sequence and the null
+    while (1)
+    {
+        //copy the run of plain chars at once
+        const byte* pRun = pRead;
+        while (*pRead && *pRead != '"' && *pRead != '\\')
+            pRead++;
+        if (pWrite + (pRead - pRun) > pLimit)
+        {
+            oCursors->pError = "string is larger than the scratch area";
+            return -1;
+        }
+        memcpy(pWrite, pRun, pRead - pRun);
+        pWrite += pRead - pRun;
+        if (*pRead == '"')
+            break;
+        if (*pRead == '\0')
+        {
+            oCursors->pError = "unexpected end of stream";
+            return -1;
+        }
+        if (pWrite >= pLimit)
+        {
+            oCursors->pError = "string is larger than the scratch area";
+            return -1;
+        }
+        byte sNext = *(++pRead);
+        pRead++;
+        switch (sNext)
+        {
+            case '"': *pWrite++ = '"'; break;
+            case '\\': *pWrite++ = '\\'; break;
+            case '/': *pWrite++ = '/'; break;
+            case 'b': *pWrite++ = '\b'; break;
+            case 'f': *pWrite++ = '\f'; break;
+            case 'v': *pWrite++ = '\v'; break;
+            case 'n': *pWrite++ = '\n'; break;
+            case 'r': *pWrite++ = '\r'; break;
+            case 't': *pWrite++ = '\t'; break;
+            case 'u':
+            {
+                pRead--;//back at the u
+                int nCodePoint = Json_ReadEscapedCodePoint(&pRead, &oCursors->pError);
+                if (nCodePoint < 0)
+                    return -1;
+                pRead++;
+                pWrite += Json_WriteUtf8(pWrite, nCodePoint);
+                break;
+            }
+            case '\0':
+                oCursors->pError = "unexpected end of stream";
+                return -1;
+            default:
+                oCursors->pError = "invalid escape sequence";
+                return -1;
+        }
+    }
+    *pWrite = '\0';
+    oCursors->pRead = pRead + 1;//skip the last "
+    return (int)(pWrite - (byte*)oCursors->pScratch);
+}
+
+void Json_ParseEventObject(JsonEventCursors* oCursors)
+{
+    const JsonEventHandler* pHandler = oCursors->pHandler;
+    int nAction = pHandler->StartObject ? Json_EventAction(oCursors, pHandler->StartObject(pHandler->User)) : JsonEventContinue;
+    if (nAction == JsonEventAbort)
+        return;
+    if (nAction == JsonEventSkip)
+    {
+        oCursors->pRead = Json_SkipEventScope(oCursors->pRead + 1, 1);
+        return;
+    }
+    oCursors->pRead = Json_SkipEventWhitespace(oCursors->pRead + 1);//skip the first { and spaces before first key
+    int bFirst = 1;
+    while (1)
+    {
+        byte sCurrent = *(oCursors->pRead);
+        if (sCurrent == '}')
+        {
+            if (!bFirst)
+            {
+                oCursors->pError = "trailing commas not suported";
+                return;
+            }
+            oCursors->pRead++;
+            if (pHandler->EndObject)
+                Json_EventAction(oCursors, pHandler->EndObject(pHandler->User));
+            return;
+        }
+        if (sCurrent != '"')
+        {
+            oCursors->pError = sCurrent == '\0' ? "unexpected end of stream" : (sCurrent == ',' ? "unexpected ','" : "expected a key");
+            return;
+        }
+        int nLength = Json_ReadEventString(oCursors);
+        if (nLength < 0)
+            return;
+        nAction = pHandler->Key ? Json_EventAction(oCursors, pHandler->Key(pHandler->User, oCursors->pScratch, nLength)) : JsonEventContinue;
+        if (nAction == JsonEventAbort)
+            return;
+        oCursors->pRead = Json_SkipEventWhitespace(oCursors->pRead);
+        if (*(oCursors->pRead) != ':')
+        {
+            oCursors->pError = "expected ':'";
+            return;
+        }
+        oCursors->pRead++;//skip :
+        if (nAction == JsonEventSkip)//the value of the key is not wanted
+            oCursors->pRead = Json_SkipEventValue(oCursors->pRead);
+        else
+            Json_ParseEventValue(oCursors);
+        if (oCursors->pError)
+            return;
+        oCursors->pRead = Json_SkipEventWhitespace(oCursors->pRead);
+        bFirst = 0;
+        if (*(oCursors->pRead) == ',')
+            oCursors->pRead = Json_SkipEventWhitespace(oCursors->pRead + 1);
+        else if (*(oCursors->pRead) == '}')
+            bFirst = 1;//not a trailing comma, the object just ends
+        else
+        {
+            oCursors->pError = *(oCursors->pRead) == '\0' ? "unexpected end of stream" : "expected ',' or '}'";
+            return;
+        }
+    }
+}
+
+void Json_ParseEventArray(JsonEventCursors* oCursors)
+{
+    const JsonEventHandler* pHandler = oCursors->pHandler;
+    int nAction = pHandler->StartArray ? Json_EventAction(oCursors, pHandler->StartArray(pHandler->User)) : JsonEventContinue;
+    if (nAction == JsonEventAbort)
+        return;
+    if (nAction == JsonEventSkip)
+    {
+        oCursors->pRead = Json_SkipEventScope(oCursors->pRead + 1, 1);
+        return;
+    }
+    oCursors->pRead = Json_SkipEventWhitespace(oCursors->pRead + 1);//skip the first [ and spaces before first value
+    int bFirst = 1;
+    while (1)
+    {
+        byte sCurrent = *(oCursors->pRead);
+        if (sCurrent == ']')
+        {
+            if (!bFirst)
+            {
+                oCursors->pError = "trailing commas not suported";
+                return;
+            }
+            oCursors->pRead++;
+            if (pHandler->EndArray)
+                Json_EventAction(oCursors, pHandler->EndArray(pHandler->User));
+            return;
+        }
+        if (sCurrent == ',')
+        {
+            oCursors->pError = "unexpected ','";
+            return;
+        }
+        Json_ParseEventValue(oCursors);
+        if (oCursors->pError)
+            return;
+        oCursors->pRead = Json_SkipEventWhitespace(oCursors->pRead);
+        bFirst = 0;
+        if (*(oCursors->pRead) == ',')
+            oCursors->pRead = Json_SkipEventWhitespace(oCursors->pRead + 1);
+        else if (*(oCursors->pRead) == ']')
+            bFirst = 1;
+        else
+        {
+            oCursors->pError = *(oCursors->pRead) == '\0' ? "unexpected end of stream" : "expected ',' or ']'";
+            return;
+        }
+    }
+}
+
+void Json_ParseEventValue(JsonEventCursors* oCursors)
+{
+    const JsonEventHandler* pHandler = oCursors->pHandler;
+    oCursors->pRead = Json_SkipEventWhitespace(oCursors->pRead);
+    const byte* pRead = oCursors->pRead;
+    byte sCurrent = *pRead;
+    if (sCurrent == '{')
+        Json_ParseEventObject(oCursors);
+    else if (sCurrent == '[')
+        Json_ParseEventArray(oCursors);
+    else if (sCurrent == '"')
+    {
+        int nLength = Json_ReadEventString(oCursors);
+        if (nLength >= 0 && pHandler->String)
+            Json_EventAction(oCursors, pHandler->String(pHandler->User, oCursors->pScratch, nLength));
+    }
+    else if ((sCurrent >= '0' && sCurrent <= '9') || sCurrent == '-')
+    {
+        long long nMantissa = 0;
+        long long nExponent = 0;
+        oCursors->pRead = Json_ReadNumber(pRead, &nMantissa, &nExponent, &oCursors->pError);
+        if (!oCursors->pError && pHandler->Number)
+            Json_EventAction(oCursors, pHandler->Number(pHandler->User, Json_ScaleMantissa((double)nMantissa, (int)nExponent)));
+    }
+    else if (sCurrent == 'n' && pRead[1] == 'u' && pRead[2] == 'l' && pRead[3] == 'l')
+    {
+        oCursors->pRead += 4;
+        if (pHandler->Null)
+            Json_EventAction(oCursors, pHandler->Null(pHandler->User));
+    }
+    else if (sCurrent == 'f' && pRead[1] == 'a' && pRead[2] == 'l' && pRead[3] == 's' && pRead[4] == 'e')
+    {
+        oCursors->pRead += 5;
+        if (pHandler->Bool)
+            Json_EventAction(oCursors, pHandler->Bool(pHandler->User, 0));
+    }
+    else if (sCurrent == 't' && pRead[1] == 'r' && pRead[2] == 'u' && pRead[3] == 'e')
+    {
+        oCursors->pRead += 4;
+        if (pHandler->Bool)
+            Json_EventAction(oCursors, pHandler->Bool(pHandler->User, 1));
+    }
+    else if (sCurrent == '\0')
+        oCursors->pError = "Unexpected end of stream";
+    else
+        oCursors->pError = "Unexpected character";
+}
+
+JsonResult Json_ParseEvents(const char* pJson, const JsonEventHandler* pHandler, char* pScratch, int nScratchSize)
+{
+    JsonResult oResult;
+    oResult.InitialSize = 0;
+    oResult.EndSize = 0;
+    oResult.Success = 0;
+    oResult.Index = -1;
+    oResult.Error = 0;
+    oResult.RootObject.Position = 0;
+    oResult.RootObject.Type = JsonTypeInvalid;
+
+    JsonEventCursors oCursors;
+    oCursors.pRead = (const byte*)pJson;
+    oCursors.pError = 0;
+    oCursors.pHandler = pHandler;
+    oCursors.pScratch = pScratch;
+    oCursors.nScratchSize = nScratchSize;
+    if (nScratchSize < 5)
+        oCursors.pError = "scratch area is too small";
+    else
+        Json_ParseEventValue(&oCursors);
+    if (oCursors.pError)
+    {
+        oResult.Error = oCursors.pError;
+        oResult.Index = oCursors.pRead - (const byte*)pJson;
+        return oResult;
+    }
+    oResult.InitialSize = oCursors.pRead - (const byte*)pJson;
+    oResult.Success = 1;
+    return oResult;
+}
@@ -0,0 +1,850 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+
+#include "json.h"
+
+typedef  signed char        int8;
+typedef  unsigned char      uint8;
+typedef  signed short       int16;
+typedef  unsigned short     uint16;
+typedef  signed int         int32;
+typedef  unsigned int       uint32;
+typedef  signed long long   int64;
+typedef  unsigned long long uint64;
+
+typedef  unsigned char      bool;
+typedef  unsigned char      byte;
+
+//same encoding as json_read.c
+typedef enum
+{
+    JsonMarkerSmallString = 0b00000001,//6bits reserved
+    JsonMarkerSmallObject = 0b00000010,//6bits reserved
+    JsonMarkerSmallArray = 0b00000011,//6bits reserved
+    JsonMarkerExponent = 0b00000100,//5bits reserved
+    JsonMarkerDigit = 0b00001000,//4bits reserved
+    JsonMarkerInt = 0b00010000,//3bits reserved
+    JsonMarkerLargeString = 0b10000000,
+    JsonMarkerLargeObject = 0b10100000,
+    JsonMarkerLargeArray = 0b11000000,
+    JsonMarkerSequenceEnd = 0b11100000,
+    JsonMarkerNull = 0b00100000,
+    JsonMarkerTrue = 0b01000000,
+    JsonMarkerFalse = 0b01100000,
+} JsonMarker;
+
+//implemented in json_read.c
+uint64 Json_GetSize(const byte* pJson);
+JsonObject Json_LoadUnkown(const byte* pJson);
+int Json_SizeOfMantissa(long long nMantissa);
+byte* Json_WriteNumberMarkers(byte* pWrite, long long nMantissa, long long nExponent, int bWriteExponent, int nMantissaSize);
+double Json_ScaleMantissa(double nMantissa, int nExponent);
+int Json_DecomposeNumber(double nValue, long long* pMantissa, long long* pExponent);
+
+#define JSON_TRANSCODE_MAX_DEPTH 1024
+
+/*************************
+ * MessagePack and CBOR
+ * both ways are a single walk, the markers are read in order and the other side is written in order,
+ * nothing is allocated and no tree is built
+**************************/
+
+typedef enum
+{
+    JsonFormatMessagePack = 0,
+    JsonFormatCbor = 1,
+} JsonBinaryFormat;
+
+typedef struct JsonTranscodeCursors
+{
+    const byte* pRead;
+    const byte* pReadEnd;
+    byte* pWrite;
+    byte* pWriteEnd;
+    char* pError;
+    int nFormat;
+    int nDepth;
+} JsonTranscodeCursors;
+
+//both formats are big endian
+byte* Json_PutBigEndian(byte* pWrite, uint64 nValue, int nBytes)
+{
+    for (int i = nBytes - 1; i >= 0; i--)
+    {
+        pWrite[i] = (byte)nValue;
+        nValue >>= 8;
+    }
+    return pWrite + nBytes;
+}
+uint64 Json_GetBigEndian(const byte* pRead, int nBytes)
+{
+    uint64 nValue = 0;
+    for (int i = 0; i < nBytes; i++)
+        nValue = (nValue << 8) | pRead[i];
+    return nValue;
+}
+
+//returns where nSize bytes can be written, or 0 with the error set
+byte* Json_TranscodeReserve(JsonTranscodeCursors* oCursors, uint64 nSize)
+{
+    if ((uint64)(oCursors->pWriteEnd - oCursors->pWrite) < nSize)
+    {
+        oCursors->pError = "destination is too small";
+        return 0;
+    }
+    byte* pWrite = oCursors->pWrite;
+    oCursors->pWrite += nSize;
+    return pWrite;
+}
+
+/*************************
+ * writing, from the markers
+**************************/
+
+//CBOR heads are a major type in the 3 high bits and an argument, small arguments live in the head itself
+void Json_PutCborHead(JsonTranscodeCursors* oCursors, int nMajor, uint64 nArgument)
+{
+    int nBytes = nArgument < 24 ? 0 : nArgument <= 0xFF ? 1 : nArgument <= 0xFFFF ? 2 : nArgument <= 0xFFFFFFFFULL ? 4 : 8;
+    byte* pWrite = Json_TranscodeReserve(oCursors, 1 + nBytes);
+    if (!pWrite)
+        return;
+    if (nBytes == 0)
+        *pWrite = (byte)((nMajor << 5) | nArgument);
+    else
+    {
+        *pWrite = (byte)((nMajor << 5) | (nBytes == 1 ? 24 : nBytes == 2 ? 25 : nBytes == 4 ? 26 : 27));
+        Json_PutBigEndian(pWrite + 1, nArgument, nBytes);
+    }
+}
+
+//MessagePack picks a header by size, a fixed one first then 8, 16 and 32 bits lengths,
+//the 32 bits header always follows the 16 bits one and arrays and maps have no 8 bits header
+void Json_PutMessagePackHead(JsonTranscodeCursors* oCursors, byte nFixed, int nFixedLimit, byte nHeader8, byte nHeader16, uint64 nLength)
+{
+    int nBytes = nLength < (uint64)nFixedLimit ? 0 : (nHeader8 && nLength <= 0xFF) ? 1 : nLength <= 0xFFFF ? 2 : 4;
+    byte* pWrite = Json_TranscodeReserve(oCursors, 1 + nBytes);
+    if (!pWrite)
+        return;
+    if (nBytes == 0)
+        *pWrite = (byte)(nFixed | nLength);
+    else
+    {
+        *pWrite = nBytes == 1 ? nHeader8 : nBytes == 2 ? nHeader16 : (byte)(nHeader16 + 1);
+        Json_PutBigEndian(pWrite + 1, nLength, nBytes);
+    }
+}
+
+void Json_PutInteger(JsonTranscodeCursors* oCursors, long long nValue)
+{
+    if (oCursors->nFormat == JsonFormatCbor)
+    {
+        if (nValue >= 0)
+            Json_PutCborHead(oCursors, 0, (uint64)nValue);
+        else
+            Json_PutCborHead(oCursors, 1, (uint64)(-1 - nValue));
+        return;
+    }
+    if (nValue >= -32 && nValue <= 127)//positive and negative fixint
+    {
+        byte* pWrite = Json_TranscodeReserve(oCursors, 1);
+        if (pWrite)
+            *pWrite = (byte)(int8)nValue;
+        return;
+    }
+    int nBytes;
+    byte nHeader;
+    if (nValue > 0)
+    {
+        nBytes = nValue <= 0xFF ? 1 : nValue <= 0xFFFF ? 2 : nValue <= 0xFFFFFFFFLL ? 4 : 8;
+        nHeader = nBytes == 1 ? 0xCC : nBytes == 2 ? 0xCD : nBytes == 4 ? 0xCE : 0xCF;
+    }
+    else
+    {
+        nBytes = nValue >= -128 ? 1 : nValue >= -32768 ? 2 : nValue >= -2147483648LL ? 4 : 8;
+        nHeader = nBytes == 1 ? 0xD0 : nBytes == 2 ? 0xD1 : nBytes == 4 ? 0xD2 : 0xD3;
+    }
+    byte* pWrite = Json_TranscodeReserve(oCursors, 1 + nBytes);
+    if (!pWrite)
+        return;
+    *pWrite = nHeader;
+    Json_PutBigEndian(pWrite + 1, (uint64)nValue, nBytes);
+}
+
+void Json_PutDouble(JsonTranscodeCursors* oCursors, double nValue)
+{
+    byte* pWrite = Json_TranscodeReserve(oCursors, 9);
+    if (!pWrite)
+        return;
+    uint64 nBits;
+    memcpy(&nBits, &nValue, 8);
+    *pWrite = oCursors->nFormat == JsonFormatCbor ? 0xFB : 0xCB;
+    Json_PutBigEndian(pWrite + 1, nBits, 8);
+}
+
+void Json_PutString(JsonTranscodeCursors* oCursors, const char* sValue, uint64 nLength)
+{
+    if (oCursors->nFormat == JsonFormatCbor)
+        Json_PutCborHead(oCursors, 3, nLength);
+    else
+        Json_PutMessagePackHead(oCursors, 0xA0, 32, 0xD9, 0xDA, nLength);
+    byte* pWrite = oCursors->pError ? 0 : Json_TranscodeReserve(oCursors, nLength);
+    if (pWrite)
+        memcpy(pWrite, sValue, nLength);
+}
+
+//exact header for a known count, the count of a map is its number of pairs
+void Json_PutContainerHead(JsonTranscodeCursors* oCursors, int bIsObject, uint64 nCount)
+{
+    if (oCursors->nFormat == JsonFormatCbor)
+        Json_PutCborHead(oCursors, bIsObject ? 5 : 4, nCount);
+    else if (bIsObject)
+        Json_PutMessagePackHead(oCursors, 0x80, 16, 0, 0xDE, nCount);
+    else
+        Json_PutMessagePackHead(oCursors, 0x90, 16, 0, 0xDC, nCount);
+}
+
+const byte* Json_PutValue(JsonTranscodeCursors* oCursors, const byte* pJson);
+
+//small containers are at most 63 bytes so their children are counted ahead to write the shortest header,
+//large ones get a 32 bits count that is filled once the children are written, this keeps the walk single pass
+const byte* Json_PutContainer(JsonTranscodeCursors* oCursors, const byte* pJson, int bIsObject, int bIsSmall)
+{
+    uint64 nCount = 0;
+    byte* pCount = 0;
+    if (bIsSmall)
+    {
+        for (const byte* pChild = pJson + 1; *pChild != JsonMarkerSequenceEnd; pChild += Json_GetSize(pChild))
+            nCount++;
+        Json_PutContainerHead(oCursors, bIsObject, bIsObject ? nCount / 2 : nCount);
+    }
+    else
+    {
+        pCount = Json_TranscodeReserve(oCursors, 5);
+        if (pCount)
+        {
+            if (oCursors->nFormat == JsonFormatCbor)
+                *pCount = (byte)(((bIsObject ? 5 : 4) << 5) | 26);
+            else
+                *pCount = bIsObject ? 0xDF : 0xDD;
+        }
+    }
+    const byte* pChild = pJson + 1;
+    while (!oCursors->pError && *pChild != JsonMarkerSequenceEnd)
+    {
+        pChild = Json_PutValue(oCursors, pChild);
+        nCount++;
+    }
+    if (!oCursors->pError && pCount)
+    {
+        if (bIsObject)
+            nCount /= 2;
+        if (nCount > 0xFFFFFFFFULL)
+            oCursors->pError = "too many children for a 32 bits count";
+        else
+            Json_PutBigEndian(pCount + 1, nCount, 4);
+    }
+    return pChild + 1;
+}
+
+//writes the value at pJson and returns the marker that follows it
+const byte* Json_PutValue(JsonTranscodeCursors* oCursors, const byte* pJson)
+{
+    byte nType = *pJson;
+    switch (nType & 0b00000011)
+    {
+        case JsonMarkerSmallString:
+            Json_PutString(oCursors, (const char*)pJson + 1, (nType >> 2) - 2);
+            return pJson + (nType >> 2);
+        case JsonMarkerSmallObject:
+        case JsonMarkerSmallArray:
+            return Json_PutContainer(oCursors, pJson, (nType & 0b00000011) == JsonMarkerSmallObject, 1);
+    }
+    switch (nType)
+    {
+        case JsonMarkerNull:
+        case JsonMarkerTrue:
+        case JsonMarkerFalse:
+        {
+            byte* pWrite = Json_TranscodeReserve(oCursors, 1);
+            if (pWrite && oCursors->nFormat == JsonFormatCbor)
+                *pWrite = nType == JsonMarkerNull ? 0xF6 : nType == JsonMarkerTrue ? 0xF5 : 0xF4;
+            else if (pWrite)
+                *pWrite = nType == JsonMarkerNull ? 0xC0 : nType == JsonMarkerTrue ? 0xC3 : 0xC2;
+            return pJson + 1;
+        }
+        case JsonMarkerLargeString:
+        {
+            size_t nLength = strlen((const char*)pJson + 1);
+            Json_PutString(oCursors, (const char*)pJson + 1, nLength);
+            return pJson + nLength + 2;
+        }
+        case JsonMarkerLargeObject:
+        case JsonMarkerLargeArray:
+            return Json_PutContainer(oCursors, pJson, nType == JsonMarkerLargeObject, 0);
+    }
+
+    //numbers, an optional exponent then the mantissa
+    int nExponent = 0;
+    const byte* pMantissa = pJson;
+    if ((nType & 0b00000111) == JsonMarkerExponent)
+    {
+        unsigned nEncoded = nType >> 3;
+        unsigned nMask = 0b00010000;
+        nExponent = (int)((nEncoded ^ nMask) - nMask);
+        pMantissa++;
+    }
+    long long nMantissa;
+    const byte* pNext;
+    if ((*pMantissa & 0b00001111) == JsonMarkerDigit)
+    {
+        nMantissa = *pMantissa >> 4;
+        pNext = pMantissa + 1;
+    }
+    else
+    {
+        int nSize = *pMantissa >> 5;
+        if (nSize == 1)
+        {
+            int8 nValue;
+            memcpy(&nValue, pMantissa + 1, 1);
+            nMantissa = nValue;
+            pNext = pMantissa + 2;
+        }
+        else if (nSize == 2)
+        {
+            int16 nValue;
+            memcpy(&nValue, pMantissa + 1, 2);
+            nMantissa = nValue;
+            pNext = pMantissa + 3;
+        }
+        else if (nSize == 3)
+        {
+            int32 nValue;
+            memcpy(&nValue, pMantissa + 1, 4);
+            nMantissa = nValue;
+            pNext = pMantissa + 5;
+        }
+        else
+        {
+            int64 nValue;
+            memcpy(&nValue, pMantissa + 1, 8);
+            nMantissa = nValue;
+            pNext = pMantissa + 9;
+        }
+    }
+    //a positive exponent is an integer written with trailing zeros, it stays an integer when it fits
+    while (nExponent > 0 && nMantissa > -922337203685477580LL && nMantissa < 922337203685477580LL)
+    {
+        nMantissa *= 10;
+        nExponent--;
+    }
+    if (nExponent == 0)
+        Json_PutInteger(oCursors, nMantissa);
+    else
+        Json_PutDouble(oCursors, Json_ScaleMantissa((double)nMantissa, nExponent));
+    return pNext;
+}
+
+long long Json_ToBinary(JsonObject oJson, char* pDest, long long nCapacity, int nFormat)
+{
+    if (oJson.Type == JsonTypeInvalid || !oJson.Position)
+        return -1;
+    JsonTranscodeCursors oCursors;
+    oCursors.pRead = oJson.Position;
+    oCursors.pReadEnd = 0;
+    oCursors.pWrite = (byte*)pDest;
+    oCursors.pWriteEnd = (byte*)pDest + nCapacity;
+    oCursors.pError = 0;
+    oCursors.nFormat = nFormat;
+    oCursors.nDepth = 0;
+    Json_PutValue(&oCursors, oJson.Position);
+    if (oCursors.pError)
+        return -1;
+    return (long long)(oCursors.pWrite - (byte*)pDest);
+}
+
+long long Json_ToMessagePack(JsonObject oJson, char* pDest, long long nCapacity)
+{
+    return Json_ToBinary(oJson, pDest, nCapacity, JsonFormatMessagePack);
+}
+
+long long Json_ToCbor(JsonObject oJson, char* pDest, long long nCapacity)
+{
+    return Json_ToBinary(oJson, pDest, nCapacity, JsonFormatCbor);
+}
+
+/*************************
+ * reading, into the markers
+**************************/
+
+//returns the nBytes at the read cursor and moves past them, or 0 with the error set
+const byte* Json_TranscodeTake(JsonTranscodeCursors* oCursors, uint64 nBytes)
+{
+    if ((uint64)(oCursors->pReadEnd - oCursors->pRead) < nBytes)
+    {
+        oCursors->pError = "unexpected end of stream";
+        return 0;
+    }
+    const byte* pRead = oCursors->pRead;
+    oCursors->pRead += nBytes;
+    return pRead;
+}
+
+void Json_TakeDouble(JsonTranscodeCursors* oCursors, double nValue)
+{
+    long long nMantissa = 0;
+    long long nExponent = 0;
+    if (!Json_DecomposeNumber(nValue, &nMantissa, &nExponent))
+    {
+        oCursors->pError = "Number can't be encoded";
+        return;
+    }
+    int nMantissaSize = Json_SizeOfMantissa(nMantissa);
+    if (nMantissaSize == 0)
+    {
+        oCursors->pError = "numeric value out of range";
+        return;
+    }
+    byte* pWrite = Json_TranscodeReserve(oCursors, (nExponent != 0) + nMantissaSize);
+    if (pWrite)
+        Json_WriteNumberMarkers(pWrite, nMantissa, nExponent, nExponent != 0, nMantissaSize);
+}
+
+void Json_TakeInteger(JsonTranscodeCursors* oCursors, long long nValue)
+{
+    int nMantissaSize = Json_SizeOfMantissa(nValue);
+    if (nMantissaSize == 0)//the extremes of int64 only fit with an exponent
+    {
+        Json_TakeDouble(oCursors, (double)nValue);
+        return;
+    }
+    byte* pWrite = Json_TranscodeReserve(oCursors, nMantissaSize);
+    if (pWrite)
+        Json_WriteNumberMarkers(pWrite, nValue, 0, 0, nMantissaSize);
+}
+
+void Json_TakeUnsigned(JsonTranscodeCursors* oCursors, uint64 nValue)
+{
+    if (nValue > 9223372036854775807ULL)
+        Json_TakeDouble(oCursors, (double)nValue);
+    else
+        Json_TakeInteger(oCursors, (long long)nValue);
+}
+
+//the text is copied with its terminating null, so a null inside it would cut it short
+void Json_TakeString(JsonTranscodeCursors* oCursors, uint64 nLength)
+{
+    const byte* pText = Json_TranscodeTake(oCursors, nLength);
+    if (!pText)
+        return;
+    if (memchr(pText, 0, nLength))
+    {
+        oCursors->pRead = pText;
+        oCursors->pError = "strings with a null char can't be stored";
+        return;
+    }
+    byte* pWrite = Json_TranscodeReserve(oCursors, nLength + 2);
+    if (!pWrite)
+        return;
+    if (nLength + 2 <= 63)
+        *pWrite = (byte)(((nLength + 2) << 2) | JsonMarkerSmallString);
+    else
+        *pWrite = JsonMarkerLargeString;
+    memcpy(pWrite + 1, pText, nLength);
+    pWrite[nLength + 1] = 0;
+}
+
+//containers are written large and shrunk to a small marker once their size is known, like Json_BuildEnd does
+byte* Json_TakeContainerStart(JsonTranscodeCursors* oCursors, int bIsObject)
+{
+    if (++oCursors->nDepth > JSON_TRANSCODE_MAX_DEPTH)
+    {
+        oCursors->pError = "too many nested scopes";
+        return 0;
+    }
+    byte* pMarker = Json_TranscodeReserve(oCursors, 1);
+    if (pMarker)
+        *pMarker = bIsObject ? JsonMarkerLargeObject : JsonMarkerLargeArray;
+    return pMarker;
+}
+void Json_TakeContainerEnd(JsonTranscodeCursors* oCursors, byte* pMarker)
+{
+    byte* pWrite = Json_TranscodeReserve(oCursors, 1);
+    if (!pWrite)
+        return;
+    *pWrite = JsonMarkerSequenceEnd;
+    uint64 nLen = pWrite + 1 - pMarker;
+    if (nLen <= 63)
+        *pMarker = (byte)((nLen << 2) | (*pMarker == JsonMarkerLargeObject ? JsonMarkerSmallObject : JsonMarkerSmallArray));
+    oCursors->nDepth--;
+}
+
+void Json_TakeMessagePackValue(JsonTranscodeCursors* oCursors, int bIsKey);
+
+void Json_TakeMessagePackContainer(JsonTranscodeCursors* oCursors, int bIsObject, uint64 nCount)
+{
+    byte* pMarker = Json_TakeContainerStart(oCursors, bIsObject);
+    for (uint64 i = 0; i < nCount && !oCursors->pError; i++)
+    {
+        if (bIsObject)
+            Json_TakeMessagePackValue(oCursors, 1);
+        if (!oCursors->pError)
+            Json_TakeMessagePackValue(oCursors, 0);
+    }
+    if (!oCursors->pError)
+        Json_TakeContainerEnd(oCursors, pMarker);
+}
+
+void Json_TakeMessagePackValue(JsonTranscodeCursors* oCursors, int bIsKey)
+{
+    const byte* pStart = oCursors->pRead;
+    const byte* pHead = Json_TranscodeTake(oCursors, 1);
+    if (!pHead)
+        return;
+    byte nHead = *pHead;
+    int bIsString = (nHead >= 0xA0 && nHead <= 0xBF) || (nHead >= 0xD9 && nHead <= 0xDB);
+    if (bIsKey && !bIsString)
+    {
+        oCursors->pRead = pStart;
+        oCursors->pError = "object keys must be strings";
+        return;
+    }
+    if (nHead <= 0x7F)
+        Json_TakeInteger(oCursors, nHead);
+    else if (nHead >= 0xE0)
+        Json_TakeInteger(oCursors, (int8)nHead);
+    else if (nHead <= 0x8F)
+        Json_TakeMessagePackContainer(oCursors, 1, nHead & 0x0F);
+    else if (nHead <= 0x9F)
+        Json_TakeMessagePackContainer(oCursors, 0, nHead & 0x0F);
+    else if (nHead <= 0xBF)
+        Json_TakeString(oCursors, nHead & 0x1F);
+    else if (nHead == 0xC0 || nHead == 0xC2 || nHead == 0xC3)
+    {
+        byte* pWrite = Json_TranscodeReserve(oCursors, 1);
+        if (pWrite)
+            *pWrite = nHead == 0xC0 ? JsonMarkerNull : nHead == 0xC3 ? JsonMarkerTrue : JsonMarkerFalse;
+    }
+    else if (nHead == 0xCA || nHead == 0xCB)
+    {
+        const byte* pRead = Json_TranscodeTake(oCursors, nHead == 0xCA ? 4 : 8);
+        if (!pRead)
+            return;
+        double nValue;
+        if (nHead == 0xCA)
+        {
+            uint32 nBits = (uint32)Json_GetBigEndian(pRead, 4);
+            float nSingle;
+            memcpy(&nSingle, &nBits, 4);
+            nValue = nSingle;
+        }
+        else
+        {
+            uint64 nBits = Json_GetBigEndian(pRead, 8);
+            memcpy(&nValue, &nBits, 8);
+        }
+        Json_TakeDouble(oCursors, nValue);
+    }
+    else if (nHead >= 0xCC && nHead <= 0xD3)
+    {
+        //uint 8/16/32/64 then int 8/16/32/64
+        int nBytes = 1 << ((nHead - 0xCC) & 3);
+        const byte* pRead = Json_TranscodeTake(oCursors, nBytes);
+        if (!pRead)
+            return;
+        uint64 nValue = Json_GetBigEndian(pRead, nBytes);
+        if (nHead <= 0xCF)
+            Json_TakeUnsigned(oCursors, nValue);
+        else if (nBytes == 8)
+            Json_TakeInteger(oCursors, (long long)nValue);
+        else
+        {
+            //sign extend from the top bit of the read width
+            uint64 nSign = 1ULL << (nBytes * 8 - 1);
+            Json_TakeInteger(oCursors, (long long)((nValue ^ nSign) - nSign));
+        }
+    }
+    else if (nHead >= 0xD9 && nHead <= 0xDB)
+    {
+        int nBytes = 1 << (nHead - 0xD9);
+        const byte* pRead = Json_TranscodeTake(oCursors, nBytes);
+        if (pRead)
+            Json_TakeString(oCursors, Json_GetBigEndian(pRead, nBytes));
+    }
+    else if (nHead >= 0xDC && nHead <= 0xDF)
+    {
+        //array 16/32 then map 16/32
+        int nBytes = (nHead & 1) ? 4 : 2;
+        const byte* pRead = Json_TranscodeTake(oCursors, nBytes);
+        if (pRead)
+            Json_TakeMessagePackContainer(oCursors, nHead >= 0xDE, Json_GetBigEndian(pRead, nBytes));
+    }
+    else
+    {
+        //bin, ext and the never used 0xC1 have no json equivalent
+        oCursors->pRead = pStart;
+        oCursors->pError = "value has no json equivalent";
+    }
+}
+
+void Json_TakeCborValue(JsonTranscodeCursors* oCursors, int bIsKey);
+
+//reads the argument that follows a head, 31 is an indefinite length and is returned as -1
+int Json_TakeCborArgument(JsonTranscodeCursors* oCursors, byte nHead, uint64* pArgument)
+{
+    byte nInfo = nHead & 0x1F;
+    if (nInfo < 24)
+    {
+        *pArgument = nInfo;
+        return 1;
+    }
+    if (nInfo == 31)
+    {
+        *pArgument = (uint64)-1;
+        return 1;
+    }
+    if (nInfo > 27)
+    {
+        oCursors->pRead--;
+        oCursors->pError = "malformed cbor head";
+        return 0;
+    }
+    int nBytes = 1 << (nInfo - 24);
+    const byte* pRead = Json_TranscodeTake(oCursors, nBytes);
+    if (!pRead)
+        return 0;
+    *pArgument = Json_GetBigEndian(pRead, nBytes);
+    return 1;
+}
+
+int Json_IsCborBreak(JsonTranscodeCursors* oCursors)
+{
+    if (oCursors->pRead < oCursors->pReadEnd && *oCursors->pRead == 0xFF)
+    {
+        oCursors->pRead++;
+        return 1;
+    }
+    return 0;
+}
+
+//indefinite strings are chunks of definite strings, they are written back to back then checked and marked like a single one
+void Json_TakeCborChunkedString(JsonTranscodeCursors* oCursors)
+{
+    byte* pMarker = Json_TranscodeReserve(oCursors, 1);
+    if (!pMarker)
+        return;
+    while (!Json_IsCborBreak(oCursors))
+    {
+        const byte* pChunk = Json_TranscodeTake(oCursors, 1);
+        uint64 nLength = 0;
+        if (!pChunk)
+            return;
+        if ((*pChunk >> 5) != 3 || (*pChunk & 0x1F) == 31)
+        {
+            oCursors->pRead = pChunk;
+            oCursors->pError = "chunks of a text string must be definite text strings";
+            return;
+        }
+        if (!Json_TakeCborArgument(oCursors, *pChunk, &nLength))
+            return;
+        const byte* pText = Json_TranscodeTake(oCursors, nLength);
+        if (!pText)
+            return;
+        if (memchr(pText, 0, nLength))
+        {
+            oCursors->pRead = pText;
+            oCursors->pError = "strings with a null char can't be stored";
+            return;
+        }
+        byte* pWrite = Json_TranscodeReserve(oCursors, nLength);
+        if (!pWrite)
+            return;
+        memcpy(pWrite, pText, nLength);
+    }
+    byte* pWrite = Json_TranscodeReserve(oCursors, 1);
+    if (!pWrite)
+        return;
+    *pWrite = 0;
+    uint64 nLen = pWrite + 1 - pMarker;
+    *pMarker = nLen <= 63 ? (byte)((nLen << 2) | JsonMarkerSmallString) : JsonMarkerLargeString;
+}
+
+void Json_TakeCborContainer(JsonTranscodeCursors* oCursors, int bIsObject, uint64 nCount)
+{
+    byte* pMarker = Json_TakeContainerStart(oCursors, bIsObject);
+    int bIsIndefinite = nCount == (uint64)-1;
+    for (uint64 i = 0; !oCursors->pError; i++)
+    {
+        if (bIsIndefinite ? Json_IsCborBreak(oCursors) : i == nCount)
+            break;
+        if (bIsObject)
+            Json_TakeCborValue(oCursors, 1);
+        if (!oCursors->pError)
+            Json_TakeCborValue(oCursors, 0);
+    }
+    if (!oCursors->pError)
+        Json_TakeContainerEnd(oCursors, pMarker);
+}
+
+//IEEE half precision, the layout of the smallest floats of CBOR
+double Json_HalfToDouble(uint64 nBits)
+{
+    int nExponent = (int)((nBits >> 10) & 0x1F);
+    double nFraction = (double)(nBits & 0x3FF);
+    double nValue;
+    if (nExponent == 0)
+        nValue = ldexp(nFraction, -24);
+    else if (nExponent == 31)
+        nValue = nFraction == 0 ? INFINITY : NAN;
+    else
+        nValue = ldexp(nFraction + 1024, nExponent - 25);
+    return (nBits & 0x8000) ? -nValue : nValue;
+}
+
+void Json_TakeCborValue(JsonTranscodeCursors* oCursors, int bIsKey)
+{
+    const byte* pStart = oCursors->pRead;
+    const byte* pHead = Json_TranscodeTake(oCursors, 1);
+    if (!pHead)
+        return;
+    byte nHead = *pHead;
+    int nMajor = nHead >> 5;
+    //tags only give a meaning to the value that follows, the value itself is kept
+    while (nMajor == 6)
+    {
+        uint64 nTag;
+        if (!Json_TakeCborArgument(oCursors, nHead, &nTag))
+            return;
+        pStart = oCursors->pRead;
+        if (!(pHead = Json_TranscodeTake(oCursors, 1)))
+            return;
+        nHead = *pHead;
+        nMajor = nHead >> 5;
+    }
+    if (bIsKey && nMajor != 3)
+    {
+        oCursors->pRead = pStart;
+        oCursors->pError = "object keys must be strings";
+        return;
+    }
+    if (nMajor == 7)
+    {
+        byte nInfo = nHead & 0x1F;
+        if (nInfo >= 20 && nInfo <= 23)//false, true, null and undefined
+        {
+            byte* pWrite = Json_TranscodeReserve(oCursors, 1);
+            if (pWrite)
+                *pWrite = nInfo == 20 ? JsonMarkerFalse : nInfo == 21 ? JsonMarkerTrue : JsonMarkerNull;
+        }
+        else if (nInfo >= 25 && nInfo <= 27)
+        {
+            int nBytes = 1 << (nInfo - 24);
+            const byte* pRead = Json_TranscodeTake(oCursors, nBytes);
+            if (!pRead)
+                return;
+            uint64 nBits = Json_GetBigEndian(pRead, nBytes);
+            double nValue;
+            if (nBytes == 2)
+                nValue = Json_HalfToDouble(nBits);
+            else if (nBytes == 4)
+            {
+                uint32 nSingleBits = (uint32)nBits;
+                float nSingle;
+                memcpy(&nSingle, &nSingleBits, 4);
+                nValue = nSingle;
+            }
+            else
+                memcpy(&nValue, &nBits, 8);
+            Json_TakeDouble(oCursors, nValue);
+        }
+        else
+        {
+            oCursors->pRead = pStart;
+            oCursors->pError = "value has no json equivalent";
+        }
+        return;
+    }
+    uint64 nArgument;
+    if (!Json_TakeCborArgument(oCursors, nHead, &nArgument))
+        return;
+    int bIsIndefinite = nArgument == (uint64)-1 && (nHead & 0x1F) == 31;
+    if (nMajor == 0 || nMajor == 1)
+    {
+        if (bIsIndefinite)
+        {
+            oCursors->pRead = pStart;
+            oCursors->pError = "malformed cbor head";
+        }
+        else if (nMajor == 0)
+            Json_TakeUnsigned(oCursors, nArgument);
+        else if (nArgument <= 9223372036854775807ULL)
+            Json_TakeInteger(oCursors, -1 - (long long)nArgument);
+        else
+            Json_TakeDouble(oCursors, -1.0 - (double)nArgument);
+    }
+    else if (nMajor == 3)
+    {
+        if (bIsIndefinite)
+            Json_TakeCborChunkedString(oCursors);
+        else
+            Json_TakeString(oCursors, nArgument);
+    }
+    else if (nMajor == 4 || nMajor == 5)
+        Json_TakeCborContainer(oCursors, nMajor == 5, bIsIndefinite ? (uint64)-1 : nArgument);
+    else
+    {
+        //byte strings have no json equivalent
+        oCursors->pRead = pStart;
+        oCursors->pError = "value has no json equivalent";
+    }
+}
+
+JsonResult Json_FromBinary(const char* pData, long long nSize, char* pDest, long long nCapacity, int nFormat)
+{
+    JsonResult oResult;
+    oResult.InitialSize = 0;
+    oResult.EndSize = 0;
+    oResult.Success = 0;
+    oResult.Index = -1;
+    oResult.Error = 0;
+    oResult.RootObject.Position = 0;
+    oResult.RootObject.Type = JsonTypeInvalid;
+
+    JsonTranscodeCursors oCursors;
+    oCursors.pRead = (const byte*)pData;
+    oCursors.pReadEnd = (const byte*)pData + nSize;
+    oCursors.pWrite = (byte*)pDest;
+    oCursors.pWriteEnd = (byte*)pDest + nCapacity;
+    oCursors.pError = 0;
+    oCursors.nFormat = nFormat;
+    oCursors.nDepth = 0;
+    if (nFormat == JsonFormatCbor)
+        Json_TakeCborValue(&oCursors, 0);
+    else
+        Json_TakeMessagePackValue(&oCursors, 0);
+    if (oCursors.pError)
+    {
+        oResult.Error = oCursors.pError;
+        oResult.Index = oCursors.pRead - (const byte*)pData;
+        return oResult;
+    }
+    //the input may hold more values after this one, InitialSize tells where the next one starts
+    oResult.InitialSize = oCursors.pRead - (const byte*)pData;
+    oResult.EndSize = oCursors.pWrite - (byte*)pDest;
+    oResult.RootObject = Json_LoadUnkown((const byte*)pDest);
+    oResult.Success = 1;
+    return oResult;
+}
+
+JsonResult Json_FromMessagePack(const char* pData, long long nSize, char* pDest, long long nCapacity)
+{
+    return Json_FromBinary(pData, nSize, pDest, nCapacity, JsonFormatMessagePack);
+}
+
+JsonResult Json_FromCbor(const char* pData, long long nSize, char* pDest, long long nCapacity)
+{
+    return Json_FromBinary(pData, nSize, pDest, nCapacity, JsonFormatCbor);
+}
@@ -3,125 +3,218 @@
 #include <string.h>
 #include <assert.h>
 #include <math.h>
+#include <stdint.h>
+#ifdef _WIN32
+#include <io.h>
+#define write _write
+#else
+#include <unistd.h>
+#endif
 
 #include "json.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define JSON_SIMD_SSE2 1
+#else
+#define JSON_SIMD_SSE2 0
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+static int json_ctz(unsigned nValue) { unsigned long nIndex; _BitScanForward(&nIndex, nValue); return (int)nIndex; }
+#define json_popcount(x) ((int)__popcnt(x))
+#else
+#define json_ctz(x) __builtin_ctz(x)
+#define json_popcount(x) __builtin_popcount(x)
+#endif
+
 typedef  signed char        int8;
 typedef  unsigned char      uint8;
 typedef  signed short       int16;
 typedef  unsigned short     uint16;
-typedef  signed long        int32;
-typedef  unsigned long      uint32;
+typedef  signed int         int32;
+typedef  unsigned int       uint32;
 typedef  signed long long   int64;
 typedef  unsigned long long uint64;
 
 typedef  unsigned char      bool;
 typedef  unsigned char      byte;
 
+//same encoding as json_read.c, parsed values are written by walking their markers
+typedef enum
+{
+    JsonMarkerSequenceEnd = 0b11100000,
+} JsonMarker;
+
+//implemented in json_read.c
+uint64 Json_GetSize(const byte* pJson);
+JsonObject Json_LoadUnkown(const byte* pJson);
+
+#define JSON_APPEND_MAX_DEPTH 128
+#define JSON_MAX_BUFFER_SIZE 0x7FFFFFFF//the sizes in the header are ints, a buffer never grows past this
+
 typedef struct JsonHeader
 {
     int AllocatedSize;
     int StringSize;
     byte* InsertionPoint;
     char* Error;
+    int AppendOnly;//only the innermost closing char is kept in the buffer, so nothing needs to be moved
+    int Depth;
+    char Scopes[JSON_APPEND_MAX_DEPTH];//closing chars of the outer scopes, while in append only mode
+    JsonAllocator Allocator;//a null Realloc means the buffer has a fixed size
+    JsonWriteCallback Sink;//when set, the finished text is flushed to it instead of growing the buffer
+    void* SinkUser;
+#ifdef JSON_BUFFER_STATS
+    JsonBufferStats Stats;
+#endif
 } JsonHeader;
 
-int Json_SizeOfString(const char* pString)
+//with JSON_BUFFER_STATS every buffer counts its calls, growths and moves, without it these macros are empty
+#ifdef JSON_BUFFER_STATS
+#define JSON_COUNT(pHeader, Field, nValue) ((pHeader)->Stats.Field += (nValue))
+#else
+#define JSON_COUNT(pHeader, Field, nValue)
+#endif
+
+//implemented in json_number.c, a number never takes more than 25 chars
+#define JSON_NUMBER_MAX_SIZE 32
+int Json_FormatNumber(char* pDest, double nValue);
+int Json_FormatInt64(char* pDest, long long nValue);
+
+/*************************
+ * string escaping
+ * quotes, backslashes, slashes and control chars are escaped, everything else is copied as is
+ * the runs of clean chars are found 16 bytes at a time and copied with memcpy
+**************************/
+
+#define JSON_ESCAPE_EXACT_THRESHOLD 1024//strings longer than this get their escapes counted instead of reserving the worst case
+
+int Json_NeedsEscape(byte sChar)
 {
-    char pUnescaped[] = { '"','\\','/','\b','\f','\n','\r','\t','\v' };
-    int nSize = 0;
-    char sChar = '\0';
-    while (sChar = *pString++)
-    {
-        nSize++;
-        for (int i = 0; i < 9;i++)
-            if (sChar == pUnescaped[i])
-            {
-                nSize++;
-                break;
-            }
-    }
-    return nSize;
+    return sChar < 0x20 || sChar == '"' || sChar == '\\' || sChar == '/';
 }
-void Json_WriteString(char* pDest, const char* pSource)
+
+#if JSON_SIMD_SSE2
+//bit i of the result is set if pSource[i] must be escaped
+int Json_EscapeMask16(const byte* pSource)
 {
-    char pUnescaped[] = { '"','\\','/','\b','\f','\n','\r','\t','\v' };
-    char pEscaped[] = { '"', '\\','/','b', 'f', 'n', 'r', 't', 'v' };
+    __m128i vChars = _mm_loadu_si128((const __m128i*)pSource);
+    __m128i vControl = _mm_cmpeq_epi8(_mm_min_epu8(vChars, _mm_set1_epi8(0x1F)), vChars);//unsigned <= 0x1F
+    __m128i vQuote = _mm_cmpeq_epi8(vChars, _mm_set1_epi8('"'));
+    __m128i vBackslash = _mm_cmpeq_epi8(vChars, _mm_set1_epi8('\\'));
+    __m128i vSlash = _mm_cmpeq_epi8(vChars, _mm_set1_epi8('/'));
+    return _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(vControl, vQuote), _mm_or_si128(vBackslash, vSlash)));
+}
+#endif
 
-    char sChar = '\0';
+//number of chars before the first one that must be escaped
+int Json_CleanRunLength(const byte* pSource, int nLength)
+{
     int i = 0;
-    while (sChar = *pSource++)
+#if JSON_SIMD_SSE2
+    for (; i + 16 <= nLength; i += 16)
     {
-        for (i = 0; i < 9;i++)
-            if (sChar == pUnescaped[i])
-            {
-                *pDest++ = '\\';
-                *pDest++ = pEscaped[i];
-                break;
-            }
-        if (i == 9)
-            *pDest++ = sChar;
+        int nMask = Json_EscapeMask16(pSource + i);
+        if (nMask)
+            return i + json_ctz(nMask);
     }
+#endif
+    while (i < nLength && !Json_NeedsEscape(pSource[i]))
+        i++;
+    return i;
 }
-int Json_SizeOfNumber(double nValue)
-{
-    int bNegative = nValue < 0;
-    if (bNegative)
-        nValue = -nValue;
-    //count decimal
-    uint32 nDecimalDigits = 0;
-    double nEpsilon = 2.2204460492503131e-016;//DBL_EPSILON
-    double nExponent = 1.0;
-    while (fabs(nValue * nExponent - trunc(nValue * nExponent)) > nEpsilon)
-    {
-        ++nDecimalDigits;
-
-        nEpsilon *= 10;
-        nExponent *= 10;
-    }
-    //count it
-    uint32 nIntegerDigits = (uint32)fmax(1, floor(log10(nValue)) + 1);
 
+int Json_CountEscapes(const byte* pSource, int nLength)
+{
+    int nCount = 0;
+    int i = 0;
+#if JSON_SIMD_SSE2
+    for (; i + 16 <= nLength; i += 16)
+        nCount += json_popcount(Json_EscapeMask16(pSource + i));
+#endif
+    for (; i < nLength; i++)
+        nCount += Json_NeedsEscape(pSource[i]);
+    return nCount;
+}
 
-    return (bNegative ? 1 : 0) + nIntegerDigits + (nDecimalDigits > 0 ? 1 : 0) + nDecimalDigits;// ,-<intsize>.<decimal>
+//room to reserve for the escaped string once its escapes are counted, in 64 bits as a long string can escape past an int
+long long Json_CountedSizeOfString(const char* pString, int nLength)
+{
+    return nLength + 5LL * Json_CountEscapes((const byte*)pString, nLength);
 }
-void Json_WriteNumber(char* pDest, double nValue)
+
+//room to reserve for the escaped string, short strings take the worst case (\u00XX for every char) to avoid scanning twice
+//a fixed size buffer can't grow, so there the escapes are always counted to not fail for lack of reserved space
+long long Json_SizeBoundOfString(JsonHeader* pHeader, const char* pString, int nLength)
 {
-    int bNegative = nValue < 0;
-    if (bNegative)
-        nValue = -nValue;
-    uint32 nDecimalDigits = 0;
-    double nEpsilon = 2.2204460492503131e-016;//DBL_EPSILON
-    double nExponent = 1.0;
-    while (fabs(nValue * nExponent - trunc(nValue * nExponent)) > nEpsilon)
-    {
-        ++nDecimalDigits;
+    if (nLength <= JSON_ESCAPE_EXACT_THRESHOLD && pHeader->Allocator.Realloc)
+        return nLength * 6;
+    return Json_CountedSizeOfString(pString, nLength);
+}
 
-        nEpsilon *= 10;
-        nExponent *= 10;
-    }
-    //decimal part
-    uint64 nDigits = nValue * pow(10, nDecimalDigits);//make int
-    if (nDecimalDigits > 0)
+//writes the escaped string and returns the number of chars written
+int Json_EscapeString(char* pDest, const char* pSource, int nLength)
+{
+    static const char pHex[] = "0123456789abcdef";
+    const byte* pRead = (const byte*)pSource;
+    const byte* pEnd = pRead + nLength;
+    char* pWrite = pDest;
+    while (pRead < pEnd)
     {
-        for (int i = 0; i < nDecimalDigits;i++)
+        int nRun = Json_CleanRunLength(pRead, (int)(pEnd - pRead));
+        memcpy(pWrite, pRead, nRun);
+        pWrite += nRun;
+        pRead += nRun;
+        if (pRead == pEnd)
+            break;
+        byte sChar = *pRead++;
+        *pWrite++ = '\\';
+        switch (sChar)
         {
-            byte nDigit = nDigits % 10;
-            *--pDest = '0' + nDigit;
-            nDigits /= 10;
+            case '"': *pWrite++ = '"'; break;
+            case '\\': *pWrite++ = '\\'; break;
+            case '/': *pWrite++ = '/'; break;
+            case '\b': *pWrite++ = 'b'; break;
+            case '\f': *pWrite++ = 'f'; break;
+            case '\n': *pWrite++ = 'n'; break;
+            case '\r': *pWrite++ = 'r'; break;
+            case '\t': *pWrite++ = 't'; break;
+            default://other control chars have no short form
+                *pWrite++ = 'u';
+                *pWrite++ = '0';
+                *pWrite++ = '0';
+                *pWrite++ = pHex[sChar >> 4];
+                *pWrite++ = pHex[sChar & 0xF];
+                break;
         }
-        *--pDest = '.';
     }
-    //integer part (write at least a single 0)
-    do
-    {
-        byte nDigit = nDigits % 10;
-        *--pDest = '0' + nDigit;
-        nDigits /= 10;
-    } while (nDigits > 0);
+    return (int)(pWrite - pDest);
+}
 
-    if (bNegative)
-        *--pDest = '-';
+//gives back the part of a gap that was reserved for escapes but not used, it must be called after the gap is added to StringSize
+void Json_CloseGap(JsonHeader* pHeader, byte* pUsedEnd, byte* pGapEnd)
+{
+    int nUnused = (int)(pGapEnd - pUsedEnd);
+    if (nUnused <= 0)
+        return;
+    byte* pStringEnd = ((byte*)pHeader) + sizeof(JsonHeader) + 1 + pHeader->StringSize + 1;//include terminating null
+    memmove(pUsedEnd, pGapEnd, pStringEnd - pGapEnd);
+    JSON_COUNT(pHeader, BytesMoved, pStringEnd - pGapEnd);
+    pHeader->StringSize -= nUnused;
+}
+
+//called after a scope is opened, in append only mode the closing char of the outer scope is moved to the stack
+//so the text after the insertion point never has more than 2 bytes ( the innermost closing char and the null )
+void Json_PushScope(JsonHeader* pHeader)
+{
+    byte* pOuter = pHeader->InsertionPoint + 1;
+    if (!pHeader->AppendOnly || *pOuter == '\0' || pHeader->Depth == JSON_APPEND_MAX_DEPTH)
+        return;//too deep scopes just keep their closing char in the buffer
+    pHeader->Scopes[pHeader->Depth++] = *pOuter;
+    *pOuter = '\0';
+    pHeader->StringSize -= 1;
 }
 
 char* Json_ValidateScope(JsonHeader* pHeader, int* bFirst, int bHasName)
@@ -165,44 +258,209 @@ char* Json_ValidateScope(JsonHeader* pHeader, int* bFirst, int bHasName)
 #define packheader(pHeader) ((char*)pHeader + sizeof(JsonHeader) + 1) 
 #define unpackheader(pBuffer) ((JsonHeader*)((char*)pBuffer - (sizeof(JsonHeader) + 1)))
 
-char* Json_CreateBuffer()
+void* Json_DefaultAlloc(void* pUser, size_t nSize)
+{
+    (void)pUser;
+    return malloc(nSize);
+}
+void* Json_DefaultRealloc(void* pUser, void* pMemory, size_t nSize)
+{
+    (void)pUser;
+    return realloc(pMemory, nSize);
+}
+void Json_DefaultFree(void* pUser, void* pMemory)
+{
+    (void)pUser;
+    free(pMemory);
+}
+
+char* Json_InitBuffer(JsonHeader* pHeader, int nAllocatedSize, const JsonAllocator* pAllocator)
 {
     int nHeaderSize = sizeof(JsonHeader) + 2;
-    JsonHeader* pHeader = malloc(nHeaderSize);
     memset(pHeader, 0, nHeaderSize);
-    pHeader->AllocatedSize = nHeaderSize;
+    pHeader->AllocatedSize = nAllocatedSize;
     pHeader->StringSize = 0;
     pHeader->InsertionPoint = ((byte*)pHeader) + nHeaderSize - 1;
+    pHeader->Allocator = *pAllocator;
+    JSON_COUNT(pHeader, PeakCapacity, nAllocatedSize);
     return packheader(pHeader);
 }
 
+char* Json_CreateBufferWith(const JsonAllocator* pAllocator)
+{
+    int nHeaderSize = sizeof(JsonHeader) + 2;
+    JsonHeader* pHeader = pAllocator->Alloc(pAllocator->User, nHeaderSize);
+    if (!pHeader)
+        return 0;
+    return Json_InitBuffer(pHeader, nHeaderSize, pAllocator);
+}
+
+char* Json_CreateBuffer()
+{
+    JsonAllocator oAllocator = { Json_DefaultAlloc, Json_DefaultRealloc, Json_DefaultFree, 0 };
+    return Json_CreateBufferWith(&oAllocator);
+}
+
+char* Json_CreateBufferIn(void* pMemory, size_t nCapacity)
+{
+    if (nCapacity < sizeof(JsonHeader) + 2 || (uintptr_t)pMemory % sizeof(void*))//the header holds pointers
+        return 0;
+    if (nCapacity > JSON_MAX_BUFFER_SIZE)
+        nCapacity = JSON_MAX_BUFFER_SIZE;//the sizes in the header are ints, the rest of the memory is left unused
+    JsonAllocator oAllocator = { 0, 0, 0, 0 };//the memory belongs to the caller, it is never grown or freed
+    return Json_InitBuffer((JsonHeader*)pMemory, (int)nCapacity, &oAllocator);
+}
+
+void Json_ResetBuffer(char* pBuffer)
+{
+    JsonHeader* pHeader = unpackheader(pBuffer);
+    pHeader->StringSize = 0;
+    pHeader->InsertionPoint = (byte*)pBuffer;
+    pHeader->Error = 0;
+    pHeader->Depth = 0;
+    *(pHeader->InsertionPoint) = '\0';
+}
+
+char* Json_CreateStream(JsonWriteCallback fWrite, void* pUser, int nBlockSize)
+{
+    int nAllocatedSize = sizeof(JsonHeader) + 2 + nBlockSize;
+    JsonAllocator oAllocator = { Json_DefaultAlloc, Json_DefaultRealloc, Json_DefaultFree, 0 };
+    JsonHeader* pHeader = oAllocator.Alloc(oAllocator.User, nAllocatedSize);
+    if (!pHeader)
+        return 0;
+    char* pBuffer = Json_InitBuffer(pHeader, nAllocatedSize, &oAllocator);
+    pHeader->AppendOnly = 1;//closing chars must not be flushed before their scope is exited
+    pHeader->Sink = fWrite;
+    pHeader->SinkUser = pUser;
+    return pBuffer;
+}
+
+int Json_WriteToFile(void* pUser, const char* pData, size_t nSize)
+{
+    return fwrite(pData, 1, nSize, (FILE*)pUser) == nSize;
+}
+char* Json_CreateFileStream(FILE* hFile, int nBlockSize)
+{
+    return Json_CreateStream(Json_WriteToFile, hFile, nBlockSize);
+}
+
+int Json_WriteToFd(void* pUser, const char* pData, size_t nSize)
+{
+    int nFd = (int)(intptr_t)pUser;
+    while (nSize > 0)
+    {
+        int nWritten = (int)write(nFd, pData, nSize);
+        if (nWritten <= 0)
+            return 0;
+        pData += nWritten;
+        nSize -= nWritten;
+    }
+    return 1;
+}
+char* Json_CreateFdStream(int nFd, int nBlockSize)
+{
+    return Json_CreateStream(Json_WriteToFd, (void*)(intptr_t)nFd, nBlockSize);
+}
+
+int Json_CloseStream(char** pBuffer)
+{
+    if (!Json_Finalize(pBuffer))
+        return 0;
+    JsonHeader* pHeader = unpackheader(*pBuffer);
+    if (pHeader->StringSize > 0 && !pHeader->Sink(pHeader->SinkUser, *pBuffer, pHeader->StringSize))
+    {
+        pHeader->Error = "Failed to write to the stream";
+        return 0;
+    }
+    Json_ResetBuffer(*pBuffer);//ready for the next document
+    return 1;
+}
+
+char* Json_CreateAppendBuffer()
+{
+    char* pBuffer = Json_CreateBuffer();
+    unpackheader(pBuffer)->AppendOnly = 1;
+    return pBuffer;
+}
+
 void Json_ReleaseBuffer(char* pBuffer)
 {
-    int nHeaderSize = sizeof(JsonHeader) + 1;
-    pBuffer -= sizeof(JsonHeader) + 1;
-    free(pBuffer);
+    JsonHeader* pHeader = unpackheader(pBuffer);
+    if (pHeader->Allocator.Free)
+        pHeader->Allocator.Free(pHeader->Allocator.User, pHeader);
 }
-JsonHeader* Json_CreateGap(JsonHeader* pHeader, int nSize)
+//sends all the text before the insertion point to the sink, except the last char that is needed to validate the scope
+int Json_FlushBlock(JsonHeader* pHeader)
+{
+    byte* pStringStart = ((byte*)pHeader) + sizeof(JsonHeader) + 1;
+    int nFinished = (int)(pHeader->InsertionPoint - pStringStart) - 1;
+    if (nFinished <= 0)
+        return 1;
+    if (!pHeader->Sink(pHeader->SinkUser, (const char*)pStringStart, nFinished))
+    {
+        pHeader->Error = "Failed to write to the stream";
+        return 0;
+    }
+    memmove(pStringStart, pStringStart + nFinished, pHeader->StringSize - nFinished + 1);//include terminating null
+    JSON_COUNT(pHeader, BytesMoved, pHeader->StringSize - nFinished + 1);
+    JSON_COUNT(pHeader, Flushes, 1);
+    pHeader->InsertionPoint -= nFinished;
+    pHeader->StringSize -= nFinished;
+    return 1;
+}
+
+JsonHeader* Json_CreateGap(JsonHeader* pHeader, long long nSize)
 {
     if (nSize <= 0)//no space requested
         return pHeader;
+    JSON_COUNT(pHeader, Gaps, 1);
     int nSizeOfHeader = sizeof(JsonHeader) + 2;//the header is and string is implicitly null terminated
     int nStringAllocated = pHeader->AllocatedSize - nSizeOfHeader;
     int nStringAvailable = nStringAllocated - pHeader->StringSize;
+    if (nStringAvailable < nSize && pHeader->Sink)//the staging block is full, flush it before growing
+    {
+        if (!Json_FlushBlock(pHeader))
+            return pHeader;
+        nStringAvailable = nStringAllocated - pHeader->StringSize;
+    }
     if (nStringAvailable < nSize)//need to reallocate
     {
-        //get a powerof 2 size
-        int nMinTotalSize = nSizeOfHeader + pHeader->StringSize + nSize;
-        int nIdealSize = 32;//minimum start size because we already have  26 at the start
-        while (nIdealSize < nMinTotalSize)
-            if (nIdealSize >= 4096)
-                nIdealSize += 4096;
-            else
-                nIdealSize *= 2;
+        //get a powerof 2 size, computed in 64 bits so the doubling cannot overflow past the int sizes of the header
+        long long nMinTotalSize = nSizeOfHeader + (long long)pHeader->StringSize + nSize;
+        long long nIdealSize = 32;
+        while (nIdealSize < nMinTotalSize && nIdealSize < JSON_MAX_BUFFER_SIZE)//grow geometrically so appends are amortized O(1)
+            nIdealSize *= 2;
+        if (nIdealSize > JSON_MAX_BUFFER_SIZE)
+            nIdealSize = JSON_MAX_BUFFER_SIZE;
+        if (!pHeader->Allocator.Realloc)//caller owned buffer
+        {
+            pHeader->Error = "Out of space in the buffer";
+            return pHeader;
+        }
+        if (nMinTotalSize > nIdealSize)//the header sizes are ints, the text cannot grow past them
+        {
+            pHeader->Error = "Out of memory";
+            return pHeader;
+        }
         //update info
         int nInsertionOffset = pHeader->InsertionPoint - (byte*)pHeader;
-        pHeader = realloc(pHeader, nIdealSize);
-        pHeader->AllocatedSize = nIdealSize;
+#ifdef JSON_BUFFER_STATS
+        int nPreviousSize = pHeader->AllocatedSize;//the realloc may free the old header
+#endif
+        JsonHeader* pGrown = pHeader->Allocator.Realloc(pHeader->Allocator.User, pHeader, (size_t)nIdealSize);
+        if (!pGrown)
+        {
+            pHeader->Error = "Out of memory";
+            return pHeader;
+        }
+        pHeader = pGrown;
+        pHeader->AllocatedSize = (int)nIdealSize;
+        JSON_COUNT(pHeader, Reallocs, 1);
+        JSON_COUNT(pHeader, ReallocBytes, nPreviousSize);
+#ifdef JSON_BUFFER_STATS
+        if (nIdealSize > pHeader->Stats.PeakCapacity)
+            pHeader->Stats.PeakCapacity = nIdealSize;
+#endif
         pHeader->InsertionPoint = ((byte*)pHeader) + nInsertionOffset;
 
 #ifdef DEBUG
@@ -213,6 +471,7 @@ JsonHeader* Json_CreateGap(JsonHeader* pHeader, int nSize)
     byte* pStringEnd = pStringStart + pHeader->StringSize + 1; //include terminating null
     int nInsertionSuffix = pStringEnd - pHeader->InsertionPoint;
     memmove(pHeader->InsertionPoint + nSize, pHeader->InsertionPoint, nInsertionSuffix);
+    JSON_COUNT(pHeader, BytesMoved, nInsertionSuffix);
 #ifdef DEBUG
     memset(pHeader->InsertionPoint, '-', nSize);
 #endif
@@ -222,18 +481,22 @@ JsonHeader* Json_CreateGap(JsonHeader* pHeader, int nSize)
 int Json_AddObject(char** pBuffer)
 {
     JsonHeader* pHeader = unpackheader(*pBuffer);
+    JSON_COUNT(pHeader, Calls[JsonAddKindScope], 1);
     int bFirst = 0;
     if (pHeader->Error = Json_ValidateScope(pHeader, &bFirst, 0))
         return 0;
 
     int nGapSize = 2 + (bFirst ? 0 : 1);
     pHeader = Json_CreateGap(pHeader, nGapSize);
+    if (pHeader->Error)
+        return 0;
     if (!bFirst)
         *(pHeader->InsertionPoint)++ = ',';
     *(pHeader->InsertionPoint)++ = '{';
     *(pHeader->InsertionPoint) = '}';
 
     pHeader->StringSize += nGapSize;
+    Json_PushScope(pHeader);
     *pBuffer = packheader(pHeader);
     return 1;
 }
@@ -241,18 +504,22 @@ int Json_AddObject(char** pBuffer)
 int Json_AddArray(char** pBuffer)
 {
     JsonHeader* pHeader = unpackheader(*pBuffer);
+    JSON_COUNT(pHeader, Calls[JsonAddKindScope], 1);
     int bFirst = 0;
     if (pHeader->Error = Json_ValidateScope(pHeader, &bFirst, 0))
         return 0;
 
     int nGapSize = 2 + (bFirst ? 0 : 1);
     pHeader = Json_CreateGap(pHeader, nGapSize);
+    if (pHeader->Error)
+        return 0;
     if (!bFirst)
         *(pHeader->InsertionPoint)++ = ',';
     *(pHeader->InsertionPoint)++ = '[';
     *(pHeader->InsertionPoint) = ']';
 
     pHeader->StringSize += nGapSize;
+    Json_PushScope(pHeader);
     *pBuffer = packheader(pHeader);
     return 1;
 }
@@ -266,6 +533,29 @@ int Json_ExitScope(char** pBuffer)
         return 0;
     }
     pHeader->InsertionPoint++;
+    if (pHeader->AppendOnly && *pHeader->InsertionPoint == '\0' && pHeader->Depth > 0)
+    {
+        //restore the closing char of the outer scope, the buffer may be exactly full so the byte is reserved first
+        //an error left by an earlier rejected add is kept for the caller, only the one of the gap stops the scope from closing
+        char* sPreviousError = pHeader->Error;
+        pHeader->Error = 0;
+        pHeader = Json_CreateGap(pHeader, 1);
+        *pBuffer = packheader(pHeader);
+        if (pHeader->Error)
+            return 0;
+        pHeader->Error = sPreviousError;
+        *(pHeader->InsertionPoint) = pHeader->Scopes[--pHeader->Depth];//the gap is followed by the moved terminating null
+        pHeader->StringSize += 1;
+    }
+    return 1;
+}
+
+int Json_Finalize(char** pBuffer)
+{
+    //exiting a scope may grow the buffer, so the header is unpacked again after each one
+    while (*unpackheader(*pBuffer)->InsertionPoint != '\0')
+        if (!Json_ExitScope(pBuffer))
+            return 0;
     return 1;
 }
 
@@ -275,15 +565,30 @@ const char* Json_GetError(char* pBuffer)
     return pHeader->Error;
 }
 
+int Json_GetBufferStats(char* pBuffer, JsonBufferStats* pStats)
+{
+#ifdef JSON_BUFFER_STATS
+    *pStats = unpackheader(pBuffer)->Stats;
+    return 1;
+#else
+    (void)pBuffer;
+    memset(pStats, 0, sizeof(JsonBufferStats));
+    return 0;
+#endif
+}
+
 int Json_AddNull(char** pBuffer)
 {
     JsonHeader* pHeader = unpackheader(*pBuffer);
+    JSON_COUNT(pHeader, Calls[JsonAddKindNull], 1);
     int bFirst = 0;
     if (pHeader->Error = Json_ValidateScope(pHeader, &bFirst, 0))
         return 0;
 
     int nGapSize = 4 + (bFirst ? 0 : 1);
     pHeader = Json_CreateGap(pHeader, nGapSize);
+    if (pHeader->Error)
+        return 0;
     if (!bFirst)
         *(pHeader->InsertionPoint)++ = ',';
     memcpy(pHeader->InsertionPoint, "null", 4);
@@ -297,6 +602,7 @@ int Json_AddNull(char** pBuffer)
 int Json_AddBool(char** pBuffer, int bValue)
 {
     JsonHeader* pHeader = unpackheader(*pBuffer);
+    JSON_COUNT(pHeader, Calls[JsonAddKindBool], 1);
     int bFirst = 0;
     if (pHeader->Error = Json_ValidateScope(pHeader, &bFirst, 0))
         return 0;
@@ -305,6 +611,8 @@ int Json_AddBool(char** pBuffer, int bValue)
     int nGapSize = (bFirst ? 0 : 1) + nValueSize;
 
     pHeader = Json_CreateGap(pHeader, nGapSize);
+    if (pHeader->Error)
+        return 0;
     if (!bFirst)
         *(pHeader->InsertionPoint)++ = ',';
     memcpy(pHeader->InsertionPoint, bValue ? "true" : "false", nValueSize);
@@ -319,62 +627,92 @@ int Json_AddBool(char** pBuffer, int bValue)
 int Json_AddString(char** pBuffer, const char* sValue)
 {
     JsonHeader* pHeader = unpackheader(*pBuffer);
+    JSON_COUNT(pHeader, Calls[JsonAddKindString], 1);
     int bFirst = 0;
     if (pHeader->Error = Json_ValidateScope(pHeader, &bFirst, 0))
         return 0;
 
-    int nValueSize = Json_SizeOfString(sValue);
-    int nGapSize = (bFirst ? 0 : 1) + nValueSize + 2;// ,"<sname>"
+    int nValueLength = (int)strlen(sValue);
+    long long nGapSize = (bFirst ? 0 : 1) + Json_SizeBoundOfString(pHeader, sValue, nValueLength) + 2;// ,"<svalue>"
     pHeader = Json_CreateGap(pHeader, nGapSize);
+    if (pHeader->Error)
+        return 0;
+    byte* pGapEnd = pHeader->InsertionPoint + nGapSize;
     if (!bFirst)
         *(pHeader->InsertionPoint)++ = ',';
     *(pHeader->InsertionPoint)++ = '"';
-    Json_WriteString(pHeader->InsertionPoint, sValue);
-    pHeader->InsertionPoint += nValueSize;
+    pHeader->InsertionPoint += Json_EscapeString(pHeader->InsertionPoint, sValue, nValueLength);
     *(pHeader->InsertionPoint)++ = '"';
     pHeader->StringSize += nGapSize;
+    Json_CloseGap(pHeader, pHeader->InsertionPoint, pGapEnd);
 
     *pBuffer = packheader(pHeader);
     return 1;
 }
 
-int Json_AddNumber(char** pBuffer, double nValue)
+//the text is spliced in as is, with a single memcpy
+//numbers are formatted once on the stack and added with it, so the gap has the exact size and nothing is measured twice
+int Json_AddRawAs(char** pBuffer, const char* pText, int nTextSize, JsonAddKind nKind)
 {
     JsonHeader* pHeader = unpackheader(*pBuffer);
+    JSON_COUNT(pHeader, Calls[nKind], 1);
+    (void)nKind;//only counted with JSON_BUFFER_STATS
     int bFirst = 0;
     if (pHeader->Error = Json_ValidateScope(pHeader, &bFirst, 0))
         return 0;
 
-    int nValueSize = Json_SizeOfNumber(nValue);
-    int nGapSize = (bFirst ? 0 : 1) + nValueSize;
+    int nGapSize = (bFirst ? 0 : 1) + nTextSize;
     pHeader = Json_CreateGap(pHeader, nGapSize);
+    if (pHeader->Error)
+        return 0;
     if (!bFirst)
-        *(pHeader->InsertionPoint) = ',';
-    pHeader->InsertionPoint += nGapSize;
-    Json_WriteNumber(pHeader->InsertionPoint, nValue);
+        *(pHeader->InsertionPoint)++ = ',';
+    memcpy(pHeader->InsertionPoint, pText, nTextSize);
+    pHeader->InsertionPoint += nTextSize;
     pHeader->StringSize += nGapSize;
     *pBuffer = packheader(pHeader);
     return 1;
 }
 
+int Json_AddRaw(char** pBuffer, const char* pText, int nTextSize)
+{
+    return Json_AddRawAs(pBuffer, pText, nTextSize, JsonAddKindRaw);
+}
+
+int Json_AddNumber(char** pBuffer, double nValue)
+{
+    char pText[JSON_NUMBER_MAX_SIZE];
+    return Json_AddRawAs(pBuffer, pText, Json_FormatNumber(pText, nValue), JsonAddKindNumber);
+}
+
+int Json_AddInt64(char** pBuffer, long long nValue)
+{
+    char pText[JSON_NUMBER_MAX_SIZE];
+    return Json_AddRawAs(pBuffer, pText, Json_FormatInt64(pText, nValue), JsonAddKindNumber);
+}
+
 int Json_AddPropertyNull(char** pBuffer, const char* sName)
 {
     JsonHeader* pHeader = unpackheader(*pBuffer);
+    JSON_COUNT(pHeader, Calls[JsonAddKindNull], 1);
     int bFirst = 0;
     if (pHeader->Error = Json_ValidateScope(pHeader, &bFirst, 1))
         return 0;
 
-    int nNameSize = Json_SizeOfString(sName);
-    int nGapSize = (bFirst ? 0 : 1) + nNameSize + 7;// ,"<sname>":null
+    int nNameLength = (int)strlen(sName);
+    long long nGapSize = (bFirst ? 0 : 1) + Json_SizeBoundOfString(pHeader, sName, nNameLength) + 7;// ,"<sname>":null
     pHeader = Json_CreateGap(pHeader, nGapSize);
+    if (pHeader->Error)
+        return 0;
+    byte* pGapEnd = pHeader->InsertionPoint + nGapSize;
     if (!bFirst)
         *(pHeader->InsertionPoint)++ = ',';
     *(pHeader->InsertionPoint)++ = '"';
-    Json_WriteString(pHeader->InsertionPoint, sName);
-    pHeader->InsertionPoint += nNameSize;
+    pHeader->InsertionPoint += Json_EscapeString(pHeader->InsertionPoint, sName, nNameLength);
     memcpy(pHeader->InsertionPoint, "\":null", 6);
     pHeader->InsertionPoint += 6;
     pHeader->StringSize += nGapSize;
+    Json_CloseGap(pHeader, pHeader->InsertionPoint, pGapEnd);
 
     *pBuffer = packheader(pHeader);
     return 1;
@@ -383,24 +721,28 @@ int Json_AddPropertyNull(char** pBuffer, const char* sName)
 int Json_AddPropertyBool(char** pBuffer, const char* sName, int bValue)
 {
     JsonHeader* pHeader = unpackheader(*pBuffer);
+    JSON_COUNT(pHeader, Calls[JsonAddKindBool], 1);
     int bFirst = 0;
     if (pHeader->Error = Json_ValidateScope(pHeader, &bFirst, 1))
         return 0;
 
-    int nNameSize = Json_SizeOfString(sName);
+    int nNameLength = (int)strlen(sName);
     int nValueSize = bValue ? 4 : 5;
-    int nGapSize = (bFirst ? 0 : 1) + nNameSize + 3 + nValueSize;// ,"<sname>":<value>
+    long long nGapSize = (bFirst ? 0 : 1) + Json_SizeBoundOfString(pHeader, sName, nNameLength) + 3 + nValueSize;// ,"<sname>":<value>
     pHeader = Json_CreateGap(pHeader, nGapSize);
+    if (pHeader->Error)
+        return 0;
+    byte* pGapEnd = pHeader->InsertionPoint + nGapSize;
     if (!bFirst)
         *(pHeader->InsertionPoint)++ = ',';
     *(pHeader->InsertionPoint)++ = '"';
-    Json_WriteString(pHeader->InsertionPoint, sName);
-    pHeader->InsertionPoint += nNameSize;
+    pHeader->InsertionPoint += Json_EscapeString(pHeader->InsertionPoint, sName, nNameLength);
     *(pHeader->InsertionPoint)++ = '"';
     *(pHeader->InsertionPoint)++ = ':';
     memcpy(pHeader->InsertionPoint, bValue ? "true" : "false", nValueSize);
     pHeader->InsertionPoint += nValueSize;
     pHeader->StringSize += nGapSize;
+    Json_CloseGap(pHeader, pHeader->InsertionPoint, pGapEnd);
 
     *pBuffer = packheader(pHeader);
     return 1;
@@ -409,97 +751,657 @@ int Json_AddPropertyBool(char** pBuffer, const char* sName, int bValue)
 int Json_AddPropertyString(char** pBuffer, const char* sName, const char* sValue)
 {
     JsonHeader* pHeader = unpackheader(*pBuffer);
+    JSON_COUNT(pHeader, Calls[JsonAddKindString], 1);
     int bFirst = 0;
     if (pHeader->Error = Json_ValidateScope(pHeader, &bFirst, 1))
         return 0;
 
-    int nNameSize = Json_SizeOfString(sName);
-    int nValueSize = Json_SizeOfString(sValue);
-    int nGapSize = (bFirst ? 0 : 1) + nNameSize + 5 + nValueSize;// ,"<sname>":"<svalue>"
+    int nNameLength = (int)strlen(sName);
+    int nValueLength = (int)strlen(sValue);
+    long long nGapSize = (bFirst ? 0 : 1) + Json_SizeBoundOfString(pHeader, sName, nNameLength) + 5 + Json_SizeBoundOfString(pHeader, sValue, nValueLength);// ,"<sname>":"<svalue>"
     pHeader = Json_CreateGap(pHeader, nGapSize);
+    if (pHeader->Error)
+        return 0;
+    byte* pGapEnd = pHeader->InsertionPoint + nGapSize;
     if (!bFirst)
         *(pHeader->InsertionPoint)++ = ',';
     *(pHeader->InsertionPoint)++ = '"';
-    Json_WriteString(pHeader->InsertionPoint, sName);
-    pHeader->InsertionPoint += nNameSize;
+    pHeader->InsertionPoint += Json_EscapeString(pHeader->InsertionPoint, sName, nNameLength);
     *(pHeader->InsertionPoint)++ = '"';
     *(pHeader->InsertionPoint)++ = ':';
     *(pHeader->InsertionPoint)++ = '"';
-    Json_WriteString(pHeader->InsertionPoint, sValue);
-    pHeader->InsertionPoint += nValueSize;
+    pHeader->InsertionPoint += Json_EscapeString(pHeader->InsertionPoint, sValue, nValueLength);
     *(pHeader->InsertionPoint)++ = '"';
     pHeader->StringSize += nGapSize;
+    Json_CloseGap(pHeader, pHeader->InsertionPoint, pGapEnd);
 
     *pBuffer = packheader(pHeader);
     return 1;
 }
-int Json_AddPropertyNumber(char** pBuffer, const char* sName, double nValue)
+
+int Json_AddPropertyRawAs(char** pBuffer, const char* sName, const char* pText, int nTextSize, JsonAddKind nKind)
 {
     JsonHeader* pHeader = unpackheader(*pBuffer);
+    JSON_COUNT(pHeader, Calls[nKind], 1);
+    (void)nKind;//only counted with JSON_BUFFER_STATS
     int bFirst = 0;
     if (pHeader->Error = Json_ValidateScope(pHeader, &bFirst, 1))
         return 0;
 
-    int nNameSize = Json_SizeOfString(sName);
-    int nValueSize = Json_SizeOfNumber(nValue);
-    int nGapSize = (bFirst ? 0 : 1) + nNameSize + 3 + nValueSize;// ,"<sname>":<svalue>
+    int nNameLength = (int)strlen(sName);
+    long long nGapSize = (bFirst ? 0 : 1) + Json_SizeBoundOfString(pHeader, sName, nNameLength) + 3 + nTextSize;// ,"<sname>":<svalue>
     pHeader = Json_CreateGap(pHeader, nGapSize);
+    if (pHeader->Error)
+        return 0;
+    byte* pGapEnd = pHeader->InsertionPoint + nGapSize;
     if (!bFirst)
         *(pHeader->InsertionPoint)++ = ',';
     *(pHeader->InsertionPoint)++ = '"';
-    Json_WriteString(pHeader->InsertionPoint, sName);
-    pHeader->InsertionPoint += nNameSize;
+    pHeader->InsertionPoint += Json_EscapeString(pHeader->InsertionPoint, sName, nNameLength);
     *(pHeader->InsertionPoint)++ = '"';
     *(pHeader->InsertionPoint)++ = ':';
-
-    pHeader->InsertionPoint += nValueSize;
-    Json_WriteNumber(pHeader->InsertionPoint, nValue);
-
+    memcpy(pHeader->InsertionPoint, pText, nTextSize);
+    pHeader->InsertionPoint += nTextSize;
     pHeader->StringSize += nGapSize;
+    Json_CloseGap(pHeader, pHeader->InsertionPoint, pGapEnd);
 
     *pBuffer = packheader(pHeader);
     return 1;
 }
 
+int Json_AddPropertyRaw(char** pBuffer, const char* sName, const char* pText, int nTextSize)
+{
+    return Json_AddPropertyRawAs(pBuffer, sName, pText, nTextSize, JsonAddKindRaw);
+}
+
+int Json_AddPropertyNumber(char** pBuffer, const char* sName, double nValue)
+{
+    char pText[JSON_NUMBER_MAX_SIZE];
+    return Json_AddPropertyRawAs(pBuffer, sName, pText, Json_FormatNumber(pText, nValue), JsonAddKindNumber);
+}
+
+int Json_AddPropertyInt64(char** pBuffer, const char* sName, long long nValue)
+{
+    char pText[JSON_NUMBER_MAX_SIZE];
+    return Json_AddPropertyRawAs(pBuffer, sName, pText, Json_FormatInt64(pText, nValue), JsonAddKindNumber);
+}
+
 int Json_AddPropertyArray(char** pBuffer, const char* sName)
 {
     JsonHeader* pHeader = unpackheader(*pBuffer);
+    JSON_COUNT(pHeader, Calls[JsonAddKindScope], 1);
     int bFirst = 0;
     if (pHeader->Error = Json_ValidateScope(pHeader, &bFirst, 1))
         return 0;
 
-    int nNameSize = Json_SizeOfString(sName);
-    int nGapSize = (bFirst ? 0 : 1) + nNameSize + 5;// ,"<sname>":[]
+    int nNameLength = (int)strlen(sName);
+    long long nGapSize = (bFirst ? 0 : 1) + Json_SizeBoundOfString(pHeader, sName, nNameLength) + 5;// ,"<sname>":[]
     pHeader = Json_CreateGap(pHeader, nGapSize);
+    if (pHeader->Error)
+        return 0;
+    byte* pGapEnd = pHeader->InsertionPoint + nGapSize;
     if (!bFirst)
         *(pHeader->InsertionPoint)++ = ',';
     *(pHeader->InsertionPoint)++ = '"';
-    Json_WriteString(pHeader->InsertionPoint, sName);
-    pHeader->InsertionPoint += nNameSize;
+    pHeader->InsertionPoint += Json_EscapeString(pHeader->InsertionPoint, sName, nNameLength);
     memcpy(pHeader->InsertionPoint, "\":[]", 4);
     pHeader->InsertionPoint += 3;
     pHeader->StringSize += nGapSize;
+    Json_CloseGap(pHeader, pHeader->InsertionPoint + 1, pGapEnd);//the closing char stays at the insertion point
+    Json_PushScope(pHeader);
     *pBuffer = packheader(pHeader);
     return 1;
 }
 int Json_AddPropertyObject(char** pBuffer, const char* sName)
 {
     JsonHeader* pHeader = unpackheader(*pBuffer);
+    JSON_COUNT(pHeader, Calls[JsonAddKindScope], 1);
     int bFirst = 0;
     if (pHeader->Error = Json_ValidateScope(pHeader, &bFirst, 1))
         return 0;
 
-    int nNameSize = Json_SizeOfString(sName);
-    int nGapSize = (bFirst ? 0 : 1) + nNameSize + 5;// ,"<sname>":[]
+    int nNameLength = (int)strlen(sName);
+    long long nGapSize = (bFirst ? 0 : 1) + Json_SizeBoundOfString(pHeader, sName, nNameLength) + 5;// ,"<sname>":{}
     pHeader = Json_CreateGap(pHeader, nGapSize);
+    if (pHeader->Error)
+        return 0;
+    byte* pGapEnd = pHeader->InsertionPoint + nGapSize;
     if (!bFirst)
         *(pHeader->InsertionPoint)++ = ',';
     *(pHeader->InsertionPoint)++ = '"';
-    Json_WriteString(pHeader->InsertionPoint, sName);
-    pHeader->InsertionPoint += nNameSize;
+    pHeader->InsertionPoint += Json_EscapeString(pHeader->InsertionPoint, sName, nNameLength);
     memcpy(pHeader->InsertionPoint, "\":{}", 4);
     pHeader->InsertionPoint += 3;
     pHeader->StringSize += nGapSize;
+    Json_CloseGap(pHeader, pHeader->InsertionPoint + 1, pGapEnd);//the closing char stays at the insertion point
+    Json_PushScope(pHeader);
+    *pBuffer = packheader(pHeader);
+    return 1;
+}
+
+/*************************
+ * bulk arrays
+ * the whole array is validated once and the elements are formatted straight into gaps of a few KB
+ * the gaps are bounded so a stream still flushes in blocks whatever the size of the array
+**************************/
+
+#define JSON_BULK_CHUNK_SIZE 4096//bytes reserved at a time
+#define JSON_BULK_CHUNK_COUNT 256//most elements written in one gap
+
+typedef enum
+{
+    JsonBulkNumber = 0,
+    JsonBulkInt64 = 1,
+    JsonBulkString = 2,
+} JsonBulkType;
+
+//writes the elements inside the array just opened at the insertion point
+int Json_WriteBulkElements(char** pBuffer, JsonBulkType nType, const void* pValues, int nCount)
+{
+    JsonHeader* pHeader = unpackheader(*pBuffer);
+    int pLengths[JSON_BULK_CHUNK_COUNT];
+    int i = 0;
+    while (i < nCount)
+    {
+        //gather as many elements as fit the chunk, at least one so long strings still get through
+        int nChunkStart = i;
+        int nChunkEnd = i;
+        long long nGapSize = 0;
+        while (nChunkEnd < nCount && nChunkEnd - nChunkStart < JSON_BULK_CHUNK_COUNT && (nGapSize < JSON_BULK_CHUNK_SIZE || nChunkEnd == nChunkStart))
+        {
+            if (nType == JsonBulkString)
+            {
+                const char* sValue = ((const char**)pValues)[nChunkEnd];
+                int nLength = (int)strlen(sValue);
+                pLengths[nChunkEnd - nChunkStart] = nLength;
+                nGapSize += 3 + Json_SizeBoundOfString(pHeader, sValue, nLength);// ,"<svalue>"
+            }
+            else
+                nGapSize += 1 + JSON_NUMBER_MAX_SIZE;
+            nChunkEnd++;
+        }
+        pHeader = Json_CreateGap(pHeader, nGapSize);
+        *pBuffer = packheader(pHeader);//the gap may have moved the buffer, even when it failed after growing for the previous chunks
+        if (pHeader->Error)
+        {
+            //the elements already written are kept, the array is closed so the text stays valid
+            //the scope is closed without the error, which is given back to the caller afterwards
+            char* sError = pHeader->Error;
+            pHeader->Error = 0;
+            Json_ExitScope(pBuffer);
+            unpackheader(*pBuffer)->Error = sError;
+            return 0;
+        }
+        byte* pGapEnd = pHeader->InsertionPoint + nGapSize;
+        char* pWrite = (char*)pHeader->InsertionPoint;
+        int bFirst = *(pHeader->InsertionPoint - 1) == '[';
+        for (; i < nChunkEnd; i++)
+        {
+            if (!bFirst)
+                *pWrite++ = ',';
+            bFirst = 0;
+            switch (nType)
+            {
+                case JsonBulkNumber:
+                    pWrite += Json_FormatNumber(pWrite, ((const double*)pValues)[i]);
+                    break;
+                case JsonBulkInt64:
+                    pWrite += Json_FormatInt64(pWrite, ((const long long*)pValues)[i]);
+                    break;
+                case JsonBulkString:
+                    *pWrite++ = '"';
+                    pWrite += Json_EscapeString(pWrite, ((const char**)pValues)[i], pLengths[i - nChunkStart]);
+                    *pWrite++ = '"';
+                    break;
+            }
+        }
+        pHeader->InsertionPoint = (byte*)pWrite;
+        pHeader->StringSize += nGapSize;
+        Json_CloseGap(pHeader, pHeader->InsertionPoint, pGapEnd);
+    }
+    *pBuffer = packheader(pHeader);
+    return 1;
+}
+
+int Json_AddBulkArray(char** pBuffer, const char* sName, JsonBulkType nType, const void* pValues, int nCount)
+{
+    JSON_COUNT(unpackheader(*pBuffer), Calls[JsonAddKindBulk], 1);
+    if (!(sName ? Json_AddPropertyArray(pBuffer, sName) : Json_AddArray(pBuffer)))
+        return 0;
+    if (!Json_WriteBulkElements(pBuffer, nType, pValues, nCount))
+        return 0;
+    return Json_ExitScope(pBuffer);
+}
+
+int Json_AddNumberArray(char** pBuffer, const double* pValues, int nCount)
+{
+    return Json_AddBulkArray(pBuffer, 0, JsonBulkNumber, pValues, nCount);
+}
+
+int Json_AddInt64Array(char** pBuffer, const long long* pValues, int nCount)
+{
+    return Json_AddBulkArray(pBuffer, 0, JsonBulkInt64, pValues, nCount);
+}
+
+int Json_AddStringArray(char** pBuffer, const char* const* pValues, int nCount)
+{
+    return Json_AddBulkArray(pBuffer, 0, JsonBulkString, pValues, nCount);
+}
+
+int Json_AddPropertyNumberArray(char** pBuffer, const char* sName, const double* pValues, int nCount)
+{
+    return Json_AddBulkArray(pBuffer, sName, JsonBulkNumber, pValues, nCount);
+}
+
+int Json_AddPropertyInt64Array(char** pBuffer, const char* sName, const long long* pValues, int nCount)
+{
+    return Json_AddBulkArray(pBuffer, sName, JsonBulkInt64, pValues, nCount);
+}
+
+int Json_AddPropertyStringArray(char** pBuffer, const char* sName, const char* const* pValues, int nCount)
+{
+    return Json_AddBulkArray(pBuffer, sName, JsonBulkString, pValues, nCount);
+}
+
+/*************************
+ * parsed values
+ * a parsed subtree is written in one pass over its markers, the children of a container are not walked again by the iterators
+ * a buffer measures the value once and writes it into a single gap, a stream gets it in gaps of a few KB like the bulk arrays
+ * so it flushes in blocks whatever the size of the value
+**************************/
+
+//upper bound of the text of a scalar, with bCounted the escapes are counted and the number is formatted
+long long Json_SizeBoundOfScalar(JsonHeader* pHeader, JsonObject oJson, int bCounted)
+{
+    char pNumber[JSON_NUMBER_MAX_SIZE];
+    switch (oJson.Type)
+    {
+        case JsonTypeNull:
+            return 4;
+        case JsonTypeBool:
+            return 5;
+        case JsonTypeNumber:
+            return bCounted ? Json_FormatNumber(pNumber, oJson.DoubleValue) : JSON_NUMBER_MAX_SIZE;
+        case JsonTypeString:
+            if (bCounted)
+                return 2 + Json_CountedSizeOfString(oJson.StringValue, (int)strlen(oJson.StringValue));
+            return 2 + Json_SizeBoundOfString(pHeader, oJson.StringValue, (int)strlen(oJson.StringValue));
+        default:
+            return 0;
+    }
+}
+
+//adds the upper bound of the text of the value at the marker to pSize and returns the marker after it
+//summed in 64 bits as the bound of a large value can be several times its text
+const byte* Json_SizeBoundOfMarkers(JsonHeader* pHeader, const byte* pJson, int bCounted, long long* pSize)
+{
+    JsonObject oJson = Json_LoadUnkown(pJson);
+    if (oJson.Type != JsonTypeArray && oJson.Type != JsonTypeObject)
+    {
+        *pSize += Json_SizeBoundOfScalar(pHeader, oJson, bCounted);
+        return pJson + Json_GetSize(pJson);
+    }
+    *pSize += 2;
+    const byte* pChild = pJson + 1;
+    while (*pChild != JsonMarkerSequenceEnd)
+    {
+        *pSize += 1;// ,<value>
+        if (oJson.Type == JsonTypeObject)
+        {
+            const char* sName = (const char*)pChild + 1;
+            int nNameLength = (int)strlen(sName);
+            *pSize += 3 + (bCounted ? Json_CountedSizeOfString(sName, nNameLength) : Json_SizeBoundOfString(pHeader, sName, nNameLength));// "<sname>":
+            pChild += Json_GetSize(pChild);
+        }
+        pChild = Json_SizeBoundOfMarkers(pHeader, pChild, bCounted, pSize);
+    }
+    return pChild + 1;
+}
+
+//upper bound of the text of a value, parsed or a scalar that only has its loaded fields
+long long Json_SizeBoundOfValue(JsonHeader* pHeader, JsonObject oJson, int bCounted)
+{
+    if (oJson.Type != JsonTypeArray && oJson.Type != JsonTypeObject)
+        return Json_SizeBoundOfScalar(pHeader, oJson, bCounted);
+    long long nSize = 0;
+    Json_SizeBoundOfMarkers(pHeader, oJson.Position, bCounted, &nSize);
+    return nSize;
+}
+
+//the quick bound reserves up to 6 times a short string and 32 chars a number, when that is more than a buffer can hold
+//the value is measured again counting its escapes and formatting its numbers, so only a text that is really too large fails
+long long Json_SizeBoundOfValueToWrite(JsonHeader* pHeader, JsonObject oJson, int* pCounted)
+{
+    *pCounted = 0;
+    long long nSize = Json_SizeBoundOfValue(pHeader, oJson, 0);
+    if (pHeader->StringSize + nSize > JSON_MAX_BUFFER_SIZE - (long long)sizeof(JsonHeader))
+    {
+        *pCounted = 1;
+        nSize = Json_SizeBoundOfValue(pHeader, oJson, 1);
+    }
+    return nSize;
+}
+
+//the gap being filled with the text of a parsed value
+typedef struct JsonValueWriter
+{
+    JsonHeader* Header;
+    byte* Write;
+    byte* GapEnd;
+    int Counted;//the values are reserved with the size they were measured with, so the gap of a buffer is never exceeded
+} JsonValueWriter;
+
+//gives back what was not written of the current gap
+void Json_CloseValueGap(JsonValueWriter* pWriter)
+{
+    JsonHeader* pHeader = pWriter->Header;
+    pHeader->StringSize += pWriter->GapEnd - pHeader->InsertionPoint;
+    pHeader->InsertionPoint = pWriter->Write;
+    Json_CloseGap(pHeader, pWriter->Write, pWriter->GapEnd);
+    pWriter->GapEnd = pWriter->Write;
+}
+
+//makes sure nSize bytes can be written, when the current gap is too small it is closed and a new one is created,
+//of at least a chunk for a stream so the gaps are not created for every value
+int Json_ReserveValueText(JsonValueWriter* pWriter, long long nSize)
+{
+    if (pWriter->GapEnd - pWriter->Write >= nSize)
+        return 1;
+    Json_CloseValueGap(pWriter);
+    long long nGapSize = pWriter->Header->Sink && nSize < JSON_BULK_CHUNK_SIZE ? JSON_BULK_CHUNK_SIZE : nSize;
+    JsonHeader* pHeader = Json_CreateGap(pWriter->Header, nGapSize);
+    pWriter->Header = pHeader;
+    pWriter->Write = pHeader->InsertionPoint;
+    pWriter->GapEnd = pHeader->Error ? pHeader->InsertionPoint : pHeader->InsertionPoint + nGapSize;
+    return pHeader->Error == 0;
+}
+
+//writes a scalar, parsed or not, as only its loaded fields are used
+int Json_WriteScalar(JsonValueWriter* pWriter, JsonObject oJson)
+{
+    if (!Json_ReserveValueText(pWriter, Json_SizeBoundOfScalar(pWriter->Header, oJson, pWriter->Counted)))
+        return 0;
+    char* pWrite = (char*)pWriter->Write;
+    switch (oJson.Type)
+    {
+        case JsonTypeNull:
+            memcpy(pWrite, "null", 4);
+            pWrite += 4;
+            break;
+        case JsonTypeBool:
+            memcpy(pWrite, oJson.BoolValue ? "true" : "false", oJson.BoolValue ? 4 : 5);
+            pWrite += oJson.BoolValue ? 4 : 5;
+            break;
+        case JsonTypeNumber:
+            pWrite += Json_FormatNumber(pWrite, oJson.DoubleValue);
+            break;
+        case JsonTypeString:
+            *pWrite++ = '"';
+            pWrite += Json_EscapeString(pWrite, oJson.StringValue, (int)strlen(oJson.StringValue));
+            *pWrite++ = '"';
+            break;
+        default:
+            break;
+    }
+    pWriter->Write = (byte*)pWrite;
+    return 1;
+}
+
+//writes the text of the value at the marker and returns the marker after it, or 0 when there was no room for it
+const byte* Json_WriteMarkers(JsonValueWriter* pWriter, const byte* pJson)
+{
+    JsonObject oJson = Json_LoadUnkown(pJson);
+    if (oJson.Type != JsonTypeArray && oJson.Type != JsonTypeObject)
+        return Json_WriteScalar(pWriter, oJson) ? pJson + Json_GetSize(pJson) : 0;
+    if (!Json_ReserveValueText(pWriter, 1))
+        return 0;
+    *(pWriter->Write)++ = oJson.Type == JsonTypeArray ? '[' : '{';
+    const byte* pChild = pJson + 1;
+    while (*pChild != JsonMarkerSequenceEnd)
+    {
+        int bFirst = pChild == pJson + 1;
+        if (oJson.Type == JsonTypeObject)
+        {
+            const char* sName = (const char*)pChild + 1;
+            int nNameLength = (int)strlen(sName);
+            long long nNameSize = pWriter->Counted ? Json_CountedSizeOfString(sName, nNameLength) : Json_SizeBoundOfString(pWriter->Header, sName, nNameLength);
+            if (!Json_ReserveValueText(pWriter, 4 + nNameSize))// ,"<sname>":
+                return 0;
+            if (!bFirst)
+                *(pWriter->Write)++ = ',';
+            *(pWriter->Write)++ = '"';
+            pWriter->Write += Json_EscapeString((char*)pWriter->Write, sName, nNameLength);
+            *(pWriter->Write)++ = '"';
+            *(pWriter->Write)++ = ':';
+            pChild += Json_GetSize(pChild);
+        }
+        else if (!bFirst)
+        {
+            if (!Json_ReserveValueText(pWriter, 1))
+                return 0;
+            *(pWriter->Write)++ = ',';
+        }
+        pChild = Json_WriteMarkers(pWriter, pChild);
+        if (!pChild)
+            return 0;
+    }
+    if (!Json_ReserveValueText(pWriter, 1))
+        return 0;
+    *(pWriter->Write)++ = oJson.Type == JsonTypeArray ? ']' : '}';
+    return pChild + 1;
+}
+
+//a stream that fails in the middle of a value keeps the part already written and reports the error
+int Json_AddParsedValue(char** pBuffer, const char* sName, JsonObject oValue)
+{
+    JsonHeader* pHeader = unpackheader(*pBuffer);
+    JSON_COUNT(pHeader, Calls[JsonAddKindValue], 1);
+    int bFirst = 0;
+    if (pHeader->Error = Json_ValidateScope(pHeader, &bFirst, sName != 0))
+        return 0;
+    if (oValue.Type == JsonTypeInvalid)
+    {
+        pHeader->Error = "Invalid value";
+        return 0;
+    }
+
+    int nNameLength = sName ? (int)strlen(sName) : 0;
+    long long nPrefixSize = (bFirst ? 0 : 1) + (sName ? Json_SizeBoundOfString(pHeader, sName, nNameLength) + 3 : 0);// ,"<sname>":
+    JsonValueWriter oWriter = { pHeader, pHeader->InsertionPoint, pHeader->InsertionPoint, 0 };
+    //a buffer holds the whole text, so it is reserved at once and nothing is written when it does not fit
+    long long nValueSize = pHeader->Sink ? 0 : Json_SizeBoundOfValueToWrite(pHeader, oValue, &oWriter.Counted);
+    if (!Json_ReserveValueText(&oWriter, nPrefixSize + nValueSize))
+    {
+        *pBuffer = packheader(oWriter.Header);
+        return 0;
+    }
+    if (!bFirst)
+        *(oWriter.Write)++ = ',';
+    if (sName)
+    {
+        *(oWriter.Write)++ = '"';
+        oWriter.Write += Json_EscapeString((char*)oWriter.Write, sName, nNameLength);
+        *(oWriter.Write)++ = '"';
+        *(oWriter.Write)++ = ':';
+    }
+    int bWritten = oValue.Type == JsonTypeArray || oValue.Type == JsonTypeObject ? Json_WriteMarkers(&oWriter, oValue.Position) != 0 : Json_WriteScalar(&oWriter, oValue);
+    Json_CloseValueGap(&oWriter);
+    *pBuffer = packheader(oWriter.Header);
+    return bWritten;
+}
+
+int Json_AddValue(char** pBuffer, JsonObject oValue)
+{
+    return Json_AddParsedValue(pBuffer, 0, oValue);
+}
+
+int Json_AddPropertyValue(char** pBuffer, const char* sName, JsonObject oValue)
+{
+    return Json_AddParsedValue(pBuffer, sName, oValue);
+}
+
+/*************************
+ * fragments
+ * a fragment is a buffer whose root is an open array (or object), so the elements (or members) written to it
+ * can be spliced into the current scope of another buffer, this lets independent parts be written on different threads
+**************************/
+
+char* Json_CreateFragment(int bMembers)
+{
+    char* pFragment = Json_CreateAppendBuffer();
+    if (!(bMembers ? Json_AddObject(&pFragment) : Json_AddArray(&pFragment)))
+    {
+        Json_ReleaseBuffer(pFragment);
+        return 0;
+    }
+    return pFragment;
+}
+
+//the content of a fragment is the text between its opening char and the insertion point
+int Json_FragmentContent(char* pFragment, int bMembers, const char** pContent)
+{
+    JsonHeader* pHeader = unpackheader(pFragment);
+    if (pHeader->Error)
+        return -1;
+    if (pFragment[0] != (bMembers ? '{' : '[') || *pHeader->InsertionPoint != (bMembers ? '}' : ']') || pHeader->Depth != 0)
+    {
+        pHeader->Error = "Fragment has scopes still open";
+        return -1;
+    }
+    *pContent = pFragment + 1;
+    return (int)((char*)pHeader->InsertionPoint - (pFragment + 1));
+}
+
+int Json_AppendFragments(char** pBuffer, char** pFragments, int nCount, int bMembers)
+{
+    JsonHeader* pHeader = unpackheader(*pBuffer);
+    JSON_COUNT(pHeader, Calls[JsonAddKindFragments], 1);
+    int bFirst = 0;
+    if (pHeader->Error = Json_ValidateScope(pHeader, &bFirst, bMembers))
+        return 0;
+
+    long long nGapSize = 0;
+    int bEmpty = bFirst;
+    for (int i = 0; i < nCount; i++)
+    {
+        const char* pContent = 0;
+        int nSize = Json_FragmentContent(pFragments[i], bMembers, &pContent);
+        if (nSize < 0)
+        {
+            pHeader->Error = unpackheader(pFragments[i])->Error;
+            return 0;
+        }
+        if (nSize == 0)
+            continue;
+        nGapSize += nSize + (bEmpty ? 0 : 1);
+        bEmpty = 0;
+    }
+    pHeader = Json_CreateGap(pHeader, nGapSize);
+    if (pHeader->Error)
+        return 0;
+    for (int i = 0; i < nCount; i++)
+    {
+        const char* pContent = 0;
+        int nSize = Json_FragmentContent(pFragments[i], bMembers, &pContent);
+        if (nSize == 0)
+            continue;
+        if (!bFirst)
+            *(pHeader->InsertionPoint)++ = ',';
+        bFirst = 0;
+        memcpy(pHeader->InsertionPoint, pContent, nSize);
+        pHeader->InsertionPoint += nSize;
+    }
+    pHeader->StringSize += nGapSize;
+
+    *pBuffer = packheader(pHeader);
+    return 1;
+}
+
+void Json_SetError(char* pBuffer, char* sError)
+{
+    unpackheader(pBuffer)->Error = sError;
+}
+
+/*************************
+ * struct serializers
+ * used by the functions generated with JSON_DEFINE_SERIALIZER, the keys come already escaped with their comma
+**************************/
+
+int Json_AddStruct(char** pBuffer, const char* sName, const void* pValue, const JsonFieldDescriptor* pFields, int nFields, int nFixedSize)
+{
+    JsonHeader* pHeader = unpackheader(*pBuffer);
+    JSON_COUNT(pHeader, Calls[JsonAddKindStruct], 1);
+    int bFirst = 0;
+    if (pHeader->Error = Json_ValidateScope(pHeader, &bFirst, sName != 0))
+        return 0;
+
+    const byte* pStruct = (const byte*)pValue;
+    int nNameLength = sName ? (int)strlen(sName) : 0;
+    long long nGapSize = (bFirst ? 0 : 1) + nFixedSize + (sName ? Json_SizeBoundOfString(pHeader, sName, nNameLength) + 3 : 0);// ,"<sname>":{<fields>}
+    for (int i = 0; i < nFields; i++)
+    {
+        if (pFields[i].Type != JsonFieldString)
+            continue;
+        const char* sValue = *(const char**)(pStruct + pFields[i].Offset);
+        if (sValue)
+            nGapSize += 2 + Json_SizeBoundOfString(pHeader, sValue, (int)strlen(sValue));
+    }
+    pHeader = Json_CreateGap(pHeader, nGapSize);
+    if (pHeader->Error)
+        return 0;
+    byte* pGapEnd = pHeader->InsertionPoint + nGapSize;
+    char* pWrite = (char*)pHeader->InsertionPoint;
+    if (!bFirst)
+        *pWrite++ = ',';
+    if (sName)
+    {
+        *pWrite++ = '"';
+        pWrite += Json_EscapeString(pWrite, sName, nNameLength);
+        *pWrite++ = '"';
+        *pWrite++ = ':';
+    }
+    *pWrite++ = '{';
+    for (int i = 0; i < nFields; i++)
+    {
+        const byte* pField = pStruct + pFields[i].Offset;
+        memcpy(pWrite, pFields[i].Key + (i == 0), pFields[i].KeySize - (i == 0));//the first key has no comma
+        pWrite += pFields[i].KeySize - (i == 0);
+        switch (pFields[i].Type)
+        {
+            case JsonFieldInt:
+                pWrite += Json_FormatInt64(pWrite, *(const int*)pField);
+                break;
+            case JsonFieldInt64:
+                pWrite += Json_FormatInt64(pWrite, *(const long long*)pField);
+                break;
+            case JsonFieldNumber:
+                pWrite += Json_FormatNumber(pWrite, *(const double*)pField);
+                break;
+            case JsonFieldBool:
+                memcpy(pWrite, *(const int*)pField ? "true" : "false", *(const int*)pField ? 4 : 5);
+                pWrite += *(const int*)pField ? 4 : 5;
+                break;
+            case JsonFieldString:
+            {
+                const char* sValue = *(const char**)pField;
+                if (!sValue)
+                {
+                    memcpy(pWrite, "null", 4);
+                    pWrite += 4;
+                    break;
+                }
+                *pWrite++ = '"';
+                pWrite += Json_EscapeString(pWrite, sValue, (int)strlen(sValue));
+                *pWrite++ = '"';
+                break;
+            }
+        }
+    }
+    *pWrite++ = '}';
+    pHeader->InsertionPoint = (byte*)pWrite;
+    pHeader->StringSize += nGapSize;
+    Json_CloseGap(pHeader, pHeader->InsertionPoint, pGapEnd);
+
     *pBuffer = packheader(pHeader);
     return 1;
-}
\ No newline at end of file
+}
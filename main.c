@@ -11,6 +11,25 @@
 void write_object(char** pBuffer, JsonObject oJson);
 void write_property(char** pBuffer, JsonProperty oProperty);
 
+typedef struct TestRecord
+{
+    long long Id;
+    const char* Name;
+    double Score;
+    int Active;
+    int Rank;
+    const char* Note;
+} TestRecord;
+
+#define TEST_RECORD_FIELDS(FIELD) \
+    FIELD(TestRecord, Id, Int64) \
+    FIELD(TestRecord, Name, String) \
+    FIELD(TestRecord, Score, Number) \
+    FIELD(TestRecord, Active, Bool) \
+    FIELD(TestRecord, Rank, Int) \
+    FIELD(TestRecord, Note, String)
+JSON_DEFINE_SERIALIZER(TestRecord, TEST_RECORD_FIELDS)
+
 double parse_decimal(const char* pChars)
 {
     bool bIsNegative = 0;
@@ -67,7 +86,7 @@ double parse_decimal(const char* pChars)
 
 int main()
 {
-    if (run_directory())
+    if (run_directory() && test_large() && test_large_write())
         printf("Tests run successfully.");
 }
 
@@ -114,11 +133,119 @@ bool run_file(const char* filename)
         return false;
     if (!test_iterators(filename))
         return false;
+    if (!test_unicode(filename))
+        return false;
+    if (!test_stats(filename))
+        return false;
     if (!test_write(filename))
         return false;
+    if (!test_subtree(filename))
+        return false;
+    if (!test_mutation(filename))
+        return false;
+    if (!test_editing(filename))
+        return false;
+    if (!test_compare(filename))
+        return false;
+    if (!test_build(filename))
+        return false;
+    if (!test_events(filename))
+        return false;
+    if (!test_transcode(filename))
+        return false;
     return true;
 }
 
+/// @brief generates an array of 1KB records of about nSize bytes, or returns 0 when it can't be allocated
+char* generate_large(long long nSize, long long* pLength, long long* pRecords)
+{
+    char* pText = (char*)malloc(nSize + 1);
+    if (!pText)
+    {
+        printf("Could not allocate the large document");
+        return 0;
+    }
+    char pRecord[1024];
+    int nRecordSize = sprintf(pRecord, "{\"id\":7,\"name\":\"");
+    memset(pRecord + nRecordSize, 'a', sizeof(pRecord) - nRecordSize - 3);
+    memcpy(pRecord + sizeof(pRecord) - 3, "\"},", 3);
+    long long nRecords = (nSize - 1) / sizeof(pRecord);
+    pText[0] = '[';
+    for (long long i = 0; i < nRecords; i++)
+        memcpy(pText + 1 + i * sizeof(pRecord), pRecord, sizeof(pRecord));
+    long long nLength = 1 + nRecords * sizeof(pRecord);
+    pText[nLength - 1] = ']';
+    pText[nLength] = '\0';
+    *pLength = nLength;
+    *pRecords = nRecords;
+    return pText;
+}
+
+/// @brief parses a generated array of records in place, JSON_LARGE_TEST_MB sets its size and should be over 2048 to pass the 31 bits offsets
+bool test_large()
+{
+    const char* sSize = getenv("JSON_LARGE_TEST_MB");
+    if (!sSize)
+        return true;
+    long long nLength = 0;
+    long long nRecords = 0;
+    char* pText = generate_large(atoll(sSize) * 1024 * 1024, &nLength, &nRecords);
+    if (!pText)
+        return false;
+
+    JsonResult oResult = Json_Parse(pText);
+    bool bResult = oResult.Success && oResult.InitialSize == nLength && Json_MeasureSubtree(oResult.RootObject) == oResult.EndSize;
+    bResult = bResult && Json_GetElementCount(oResult.RootObject) == nRecords;
+    JsonElement oLast = Json_GetElementAtIndex(oResult.RootObject, nRecords - 1);
+    bResult = bResult && (long long)oLast.Index == nRecords - 1 && Json_GetPropertyByName(oLast.Value, "id").Value.DoubleValue == 7;
+    long long nIterated = 0;
+    for (JsonElement oElement = Json_IterateElements(oResult.RootObject); oElement.Value.Type != JsonTypeInvalid; oElement = Json_NextElement(oElement))
+        nIterated += oElement.Value.Type == JsonTypeObject;
+    bResult = bResult && nIterated == nRecords;
+
+    free(pText);
+    if (bResult == true)
+        printf("Parsed %lli bytes without errors.\n", nLength);
+    return bResult;
+}
+
+/// @brief writes a generated array back the way zson pretty and zson get do, JSON_LARGE_TEST_MB sets its size
+/// below 2048 the root is written and indented, over it the text is more than a buffer can hold and writing it must fail
+/// with an error instead of growing forever, after which the same buffer still writes one record
+bool test_large_write()
+{
+    const char* sSize = getenv("JSON_LARGE_TEST_MB");
+    if (!sSize)
+        return true;
+    long long nLength = 0;
+    long long nRecords = 0;
+    char* pText = generate_large(atoll(sSize) * 1024 * 1024, &nLength, &nRecords);
+    if (!pText)
+        return false;
+
+    JsonResult oResult = Json_Parse(pText);
+    bool bResult = oResult.Success;
+    char* pBuffer = Json_CreateBuffer();
+    int bAdded = Json_AddValue(&pBuffer, oResult.RootObject);
+    if (nLength >= 0x7FFFFFFF)
+        bResult = bResult && !bAdded && Json_GetError(pBuffer) && strcmp(Json_GetError(pBuffer), "Out of memory") == 0;
+    else
+    {
+        long long nPrinted = 0;
+        bResult = bResult && bAdded && (long long)strlen(pBuffer) == nLength;
+        bResult = bResult && Json_FormatTo(pBuffer, 0, count_text, &nPrinted) && nPrinted > nLength;
+    }
+    Json_ResetBuffer(pBuffer);
+    JsonObject oLast = Json_GetElementAtIndex(oResult.RootObject, nRecords - 1).Value;
+    bResult = bResult && Json_AddValue(&pBuffer, oLast) && strlen(pBuffer) == 1024 - 1 && strncmp(pBuffer, "{\"id\":7,\"name\":\"aaa", 19) == 0;
+
+    Json_ReleaseBuffer(pBuffer);
+    free(pText);
+    if (bResult == true)
+        printf(nLength >= 0x7FFFFFFF ? "Stopped at the buffer limit writing %lli bytes.\n" : "Wrote %lli bytes without errors.\n", nLength);
+    return bResult;
+}
+
 /// @brief runs the parser on the file
 /// @param filename 
 bool test_parse(const char* filename)
@@ -127,20 +254,177 @@ bool test_parse(const char* filename)
     JsonResult oResult = Json_Parse(pContent);
     // dump_object(oResult.RootObject, 0);
     // exit(0);
+    //zeros inside the decimals are pushed to the mantissa once
+    const char* pNumbers[][2] = { { "1.055", "1055e-3" }, { "561233.0224609375", "5612330224609375e-10" }, { "-0.00102030", "-10203e-7" } };
+    char pNumber[32];
+    for (int i = 0; i < (int)(sizeof(pNumbers) / sizeof(pNumbers[0])); i++)
+    {
+        strcpy(pNumber, pNumbers[i][0]);
+        JsonResult oNumber = Json_Parse(pNumber);
+        if (!oNumber.Success || oNumber.RootObject.DoubleValue != strtod(pNumbers[i][1], 0))
+        {
+            printf("parsing failed : %s does not read back\n", pNumbers[i][0]);
+            free(pContent);
+            return false;
+        }
+    }
+    //containers cut by the end of the text are errors
+    const char* pTruncated[] = { "[", "{", "[1,", "{\"a\":1", "[[1]", "{\"a\":[" };
+    for (int i = 0; i < (int)(sizeof(pTruncated) / sizeof(pTruncated[0])); i++)
+    {
+        strcpy(pNumber, pTruncated[i]);
+        if (Json_Parse(pNumber).Success)
+        {
+            printf("parsing failed : %s is accepted\n", pTruncated[i]);
+            free(pContent);
+            return false;
+        }
+    }
     if (!oResult.Success)
     {
-        printf("parsing failed : %s at %i\n", oResult.Error, oResult.Index);
+        printf("parsing failed : %s at %lli\n", oResult.Error, oResult.Index);
         free(pContent);
         return false;
     }
     else
     {
-        printf("parsing successful : %i > %i = %f%%\n", oResult.InitialSize, oResult.EndSize, ((float)oResult.EndSize / (float)oResult.InitialSize));
+        printf("parsing successful : %lli > %lli = %f%%\n", oResult.InitialSize, oResult.EndSize, ((float)oResult.EndSize / (float)oResult.InitialSize));
         free(pContent);
         return true;
     }
 }
 
+/// @brief checks escapes are decoded as utf-8 and the optional validation of raw chars
+/// @param filename 
+bool test_unicode(const char* filename)
+{
+    char* pContent = read_content(filename);
+    char* pValidated = read_content(filename);
+    JsonResult oResult = Json_Parse(pContent);
+    JsonResult oValidated = Json_ParseWithOptions(pValidated, JsonParseValidateUtf8);
+    bool bResult = oValidated.Success && Json_Equals(oResult.RootObject, oValidated.RootObject);
+
+    const char* pCases[][2] = {
+        { "\"\\u00e9\"", "\xC3\xA9" },
+        { "\"\\u20AC\"", "\xE2\x82\xAC" },
+        { "\"\\ud83d\\ude00\"", "\xF0\x9F\x98\x80" },
+        { "\"a\\u0041b\"", "aAb" },
+        { "\"caf\xC3\xA9 and a run longer than a block \\\" then \xF0\x9F\x98\x80 more text after it\"", "caf\xC3\xA9 and a run longer than a block \" then \xF0\x9F\x98\x80 more text after it" },
+    };
+    char pText[256];
+    char pScratch[256];
+    for (int i = 0; i < (int)(sizeof(pCases) / sizeof(pCases[0])); i++)
+    {
+        strcpy(pText, pCases[i][0]);
+        JsonResult oString = Json_ParseWithOptions(pText, JsonParseValidateUtf8);
+        bResult = bResult && oString.Success && strcmp(oString.RootObject.StringValue, pCases[i][1]) == 0;
+        //the event parser decodes to the same chars
+        JsonEventHandler oHandler = { 0 };
+        oHandler.String = event_copy_string;
+        oHandler.User = pText;
+        bResult = bResult && Json_ParseEvents(pCases[i][0], &oHandler, pScratch, sizeof(pScratch)).Success && strcmp(pText, pCases[i][1]) == 0;
+    }
+
+    //lone surrogates are rejected, malformed raw chars only when validating
+    const char* pInvalid[] = { "\"\xC3\x28\"", "\"\xC0\xAF\"", "\"\xED\xA0\x80\"", "\"\xF4\x90\x80\x80\"", "\"abc\xE2\x82\"",
+        "\"a run of plain ascii longer than two blocks \xC3\xA9 then a bad one \xE2\x28\xA1 after\"" };
+    strcpy(pText, "\"\\ud800\"");
+    bResult = bResult && !Json_Parse(pText).Success;
+    strcpy(pText, "\"\\udc00\\u0041\"");
+    bResult = bResult && !Json_Parse(pText).Success;
+    //an escaped null would cut the string where it is measured, both parsers refuse it in small and large strings
+    const char* pNulls[] = { "\"a\\u0000b\"", "[\"a string longer than the sixty three chars of a small one \\u0000 then\"]" };
+    for (int i = 0; i < 2; i++)
+    {
+        strcpy(pText, pNulls[i]);
+        bResult = bResult && !Json_Parse(pText).Success;
+        JsonEventHandler oHandler = { 0 };
+        bResult = bResult && !Json_ParseEvents(pNulls[i], &oHandler, pScratch, sizeof(pScratch)).Success;
+    }
+    for (int i = 0; i < (int)(sizeof(pInvalid) / sizeof(pInvalid[0])); i++)
+    {
+        strcpy(pText, pInvalid[i]);
+        bResult = bResult && Json_Parse(pText).Success;
+        strcpy(pText, pInvalid[i]);
+        bResult = bResult && !Json_ParseWithOptions(pText, JsonParseValidateUtf8).Success;
+    }
+
+    free(pContent);
+    free(pValidated);
+    if (bResult == true)
+        printf("Decoded unicode without errors.\n");
+    return bResult;
+}
+
+int event_copy_string(void* pUser, const char* sValue, int nLength)
+{
+    memcpy(pUser, sValue, nLength + 1);
+    return JsonEventContinue;
+}
+
+/// @brief checks the parse stats against a walk of the parsed file
+/// @param filename 
+bool test_stats(const char* filename)
+{
+    char* pContent = read_content(filename);
+    char* pPlain = read_content(filename);
+    JsonParseStats oStats;
+    JsonResult oResult = Json_ParseWithStats(pContent, 0, &oStats);
+    JsonResult oPlain = Json_Parse(pPlain);
+    long long pCounts[JsonTypeArray + 1] = { 0 };
+    long long nKeys = 0;
+    int nDepth = count_values(oResult.RootObject, pCounts, &nKeys);
+    bool bResult = oResult.Success && oResult.EndSize == oPlain.EndSize && memcmp(pContent, pPlain, (size_t)oResult.EndSize) == 0;
+    bResult = bResult && oStats.Nulls == pCounts[JsonTypeNull] && oStats.Bools == pCounts[JsonTypeBool] && oStats.Numbers == pCounts[JsonTypeNumber]
+        && oStats.Strings == pCounts[JsonTypeString] && oStats.Keys == nKeys && oStats.MaxDepth == nDepth
+        && oStats.SmallObjects + oStats.LargeObjects == pCounts[JsonTypeObject] && oStats.SmallArrays + oStats.LargeArrays == pCounts[JsonTypeArray]
+        && oStats.SmallStrings + oStats.LargeStrings == oStats.Strings + oStats.Keys
+        && oStats.Digits + oStats.Int8s + oStats.Int16s + oStats.Int32s + oStats.Int64s == oStats.Numbers && oStats.Exponents <= oStats.Numbers;
+#ifdef JSON_PARSE_PROFILE
+    bResult = bResult && oStats.ParseCycles > 0 && oStats.ParseCycles >= oStats.StringCycles + oStats.NumberCycles;
+#else
+    bResult = bResult && oStats.ParseCycles == 0 && oStats.StringCycles == 0 && oStats.WhitespaceCycles == 0;
+#endif
+
+    //escapes and decoded bytes of keys and values
+    char pText[] = "{\"k\\\\\":[\"a\\n\\\"b\", \"\\u00e9\", 1, -1000, 100000, 1.5, 5]}";
+    bResult = bResult && Json_ParseWithStats(pText, 0, &oStats).Success && oStats.Escapes == 4 && oStats.StringBytes == 8
+        && oStats.Keys == 1 && oStats.Strings == 2 && oStats.Digits == 2 && oStats.Int16s == 1 && oStats.Int32s == 1 && oStats.Exponents == 1 && oStats.MaxDepth == 2;
+
+    free(pContent);
+    free(pPlain);
+    if (bResult == true)
+        printf("Counted stats without errors.\n");
+    return bResult;
+}
+
+/// @brief counts the values of each type and the keys, returns the depth of the deepest container
+int count_values(JsonObject oJson, long long* pCounts, long long* pKeys)
+{
+    int nDepth = 0;
+    pCounts[oJson.Type]++;
+    if (oJson.Type == JsonTypeObject)
+    {
+        for (JsonProperty oProperty = Json_IterateProperties(oJson); oProperty.Value.Type != JsonTypeInvalid; oProperty = Json_NextProperty(oProperty))
+        {
+            int nChildDepth = count_values(oProperty.Value, pCounts, pKeys);
+            nDepth = nChildDepth > nDepth ? nChildDepth : nDepth;
+            (*pKeys)++;
+        }
+    }
+    else if (oJson.Type == JsonTypeArray)
+    {
+        for (JsonElement oElement = Json_IterateElements(oJson); oElement.Value.Type != JsonTypeInvalid; oElement = Json_NextElement(oElement))
+        {
+            int nChildDepth = count_values(oElement.Value, pCounts, pKeys);
+            nDepth = nChildDepth > nDepth ? nChildDepth : nDepth;
+        }
+    }
+    else
+        return 0;
+    return nDepth + 1;
+}
+
 /// @brief runs the iterators on the parsed on the file
 /// @param filename 
 bool test_iterators(const char* filename)
@@ -211,9 +495,364 @@ bool test_write(const char* filename)
 
     char* pOutput = Json_CreateBuffer();
     write_object(&pOutput, oResult.RootObject);
+    char* pAppendOutput = Json_CreateAppendBuffer();
+    write_object(&pAppendOutput, oResult.RootObject);
+    Json_Finalize(&pAppendOutput);
 
     Json_Compress(pOriginal);
     int nComparison = strcmp(pOriginal, pOutput);
+    if (nComparison == 0 && strcmp(pOriginal, pAppendOutput) != 0)
+    {
+        printf("Append only mode generated a different JSON text\n");
+        printf("%s\n\n%s", pOriginal, pAppendOutput);
+        nComparison = 1;
+    }
+
+    //caller owned memory, written twice to check the reset reuses it
+    long long pMemory[1024];
+    char* pFixedOutput = Json_CreateBufferIn(pMemory, sizeof(pMemory));
+    write_object(&pFixedOutput, oResult.RootObject);
+    Json_ResetBuffer(pFixedOutput);
+    write_object(&pFixedOutput, oResult.RootObject);
+    if (nComparison == 0 && (Json_GetError(pFixedOutput) || strcmp(pOriginal, pFixedOutput) != 0))
+    {
+        printf("Fixed buffer generated a different JSON text\n");
+        nComparison = 1;
+    }
+    //misaligned memory is refused, a capacity past the int sizes is clamped instead of truncated
+    char* pClamped = Json_CreateBufferIn(pMemory, (size_t)0x100000000ULL + 64);//truncated it would leave no room past the header
+    if (pClamped)
+        Json_AddNull(&pClamped);
+    if (nComparison == 0 && (Json_CreateBufferIn((char*)pMemory + 1, sizeof(pMemory) - 1) != 0 || !pClamped || Json_GetError(pClamped) || strcmp(pClamped, "null") != 0))
+    {
+        printf("Fixed buffer accepted misaligned memory or truncated its capacity\n");
+        nComparison = 1;
+    }
+    //stream through a tiny staging block, the sink just collects the text
+    char pStreamed[8192] = "";
+    char* pStream = Json_CreateStream(append_text, pStreamed, 16);
+    write_object(&pStream, oResult.RootObject);
+    if (nComparison == 0 && (!Json_CloseStream(&pStream) || strcmp(pOriginal, pStreamed) != 0))
+    {
+        printf("Stream generated a different JSON text\n");
+        printf("%s\n\n%s", pOriginal, pStreamed);
+        nComparison = 1;
+    }
+    Json_ReleaseBuffer(pStream);
+    //a buffer too small must fail with an error instead of growing
+    char* pSmallOutput = Json_CreateBufferIn(pMemory, 512);
+    write_object(&pSmallOutput, oResult.RootObject);
+    if (nComparison == 0 && (Json_GetError(pSmallOutput) != 0) == (strcmp(pOriginal, pSmallOutput) == 0))
+    {
+        printf("Small fixed buffer did not report the lack of space\n");
+        nComparison = 1;
+    }
+    //closing a scope restores the outer closing char, long strings reserve exactly their size
+    //so with one of these lengths the buffer is exactly full when the inner scope is closed
+    char* pFilling = (char*)malloc(2048 + 1);
+    char* pExpectedFilled = (char*)malloc(2048 + 8);
+    char* pFilledStream = (char*)malloc(2048 + 8);
+    for (int nLength = 1025; nLength <= 2048 && nComparison == 0; nLength++)
+    {
+        memset(pFilling, 'x', nLength);
+        pFilling[nLength] = '\0';
+        sprintf(pExpectedFilled, "[[\"%s\"]]", pFilling);
+        pFilledStream[0] = '\0';
+        char* pFilled = Json_CreateAppendBuffer();
+        char* pFilledStreamBuffer = Json_CreateStream(append_text, pFilledStream, 8);
+        char** pTargets[2] = { &pFilled, &pFilledStreamBuffer };
+        for (int i = 0; i < 2; i++)
+        {
+            Json_AddArray(pTargets[i]);
+            Json_AddArray(pTargets[i]);
+            Json_AddString(pTargets[i], pFilling);
+            Json_ExitScope(pTargets[i]);
+            Json_ExitScope(pTargets[i]);
+        }
+        if (Json_GetError(pFilled) || strcmp(pFilled, pExpectedFilled) != 0 || !Json_CloseStream(&pFilledStreamBuffer) || strcmp(pFilledStream, pExpectedFilled) != 0)
+        {
+            printf("Closing a scope in a full buffer generated a different JSON text\n");
+            nComparison = 1;
+        }
+        Json_ReleaseBuffer(pFilled);
+        Json_ReleaseBuffer(pFilledStreamBuffer);
+    }
+    free(pFilling);
+    free(pExpectedFilled);
+    free(pFilledStream);
+    //a rejected add leaves its error on the buffer, the scopes must still close around the valid text
+    char pRejectedStream[64] = "";
+    char* pRejected = Json_CreateAppendBuffer();
+    char* pRejectedStreamBuffer = Json_CreateStream(append_text, pRejectedStream, 8);
+    char** pRejectedTargets[2] = { &pRejected, &pRejectedStreamBuffer };
+    for (int i = 0; i < 2; i++)
+    {
+        Json_AddObject(pRejectedTargets[i]);
+        Json_AddPropertyArray(pRejectedTargets[i], "a");
+        Json_AddNumber(pRejectedTargets[i], 1);
+        Json_AddPropertyNumber(pRejectedTargets[i], "b", 2);//named inside an array
+    }
+    int bRejectedError = Json_GetError(pRejected) != 0;
+    if (nComparison == 0 && (!bRejectedError || !Json_Finalize(&pRejected) || strcmp(pRejected, "{\"a\":[1]}") != 0
+        || !Json_CloseStream(&pRejectedStreamBuffer) || strcmp(pRejectedStream, "{\"a\":[1]}") != 0))
+    {
+        printf("Scopes did not close after a rejected add\n%s\n%s\n", pRejected, pRejectedStream);
+        nComparison = 1;
+    }
+    Json_ReleaseBuffer(pRejected);
+    Json_ReleaseBuffer(pRejectedStreamBuffer);
+    //control chars without a short form are written as \u00XX, long strings reserve only the escapes they have
+    char* pEscaped = Json_CreateBuffer();
+    Json_AddArray(&pEscaped);
+    Json_AddString(&pEscaped, "a\x01\"\t\x1f/b");
+    char pLong[2049];
+    memset(pLong, 'x', 2048);
+    pLong[2048] = '\0';
+    pLong[100] = '\n';
+    pLong[2047] = '\x7f';
+    Json_AddString(&pEscaped, pLong);
+    Json_ExitScope(&pEscaped);
+    if (nComparison == 0 && (strncmp(pEscaped, "[\"a\\u0001\\\"\\t\\u001f\\/b\",\"", 25) != 0 || strlen(pEscaped) != 25 + 2048 + 1 + 2))
+    {
+        printf("Escaped strings do not match\n%s\n", pEscaped);
+        nComparison = 1;
+    }
+    Json_ReleaseBuffer(pEscaped);
+    //bulk arrays must match the same values added one by one, across several chunks
+    double pNumbers[3000];
+    long long pIntegers[3000];
+    const char* pStrings[600];
+    for (int i = 0; i < 3000; i++)
+    {
+        pNumbers[i] = (i - 1500) * 0.37;
+        pIntegers[i] = (long long)(i - 1500) * 3000000007LL;
+        if (i < 600)
+            pStrings[i] = i % 3 ? "plain" : "needs \"escaping\"\n";
+    }
+    char* pBulk = Json_CreateBuffer();
+    char* pSingle = Json_CreateBuffer();
+    Json_AddObject(&pBulk);
+    Json_AddPropertyNumberArray(&pBulk, "numbers", pNumbers, 3000);
+    Json_AddPropertyInt64Array(&pBulk, "integers", pIntegers, 3000);
+    Json_AddPropertyStringArray(&pBulk, "strings", pStrings, 600);
+    Json_AddPropertyNumberArray(&pBulk, "empty", pNumbers, 0);
+    Json_AddObject(&pSingle);
+    Json_AddPropertyArray(&pSingle, "numbers");
+    for (int i = 0; i < 3000; i++)
+        Json_AddNumber(&pSingle, pNumbers[i]);
+    Json_ExitScope(&pSingle);
+    Json_AddPropertyArray(&pSingle, "integers");
+    for (int i = 0; i < 3000; i++)
+        Json_AddInt64(&pSingle, pIntegers[i]);
+    Json_ExitScope(&pSingle);
+    Json_AddPropertyArray(&pSingle, "strings");
+    for (int i = 0; i < 600; i++)
+        Json_AddString(&pSingle, pStrings[i]);
+    Json_ExitScope(&pSingle);
+    Json_AddPropertyArray(&pSingle, "empty");
+    Json_ExitScope(&pSingle);
+    if (nComparison == 0 && (Json_GetError(pBulk) || strcmp(pBulk, pSingle) != 0))
+    {
+        printf("Bulk arrays do not match the single values\n");
+        nComparison = 1;
+    }
+    Json_ReleaseBuffer(pBulk);
+    Json_ReleaseBuffer(pSingle);
+    //a bulk array that runs out of memory after growing keeps the chunks already written and closes the array
+    size_t nLimit = 16384;
+    JsonAllocator oLimited = { limited_alloc, limited_realloc, limited_free, &nLimit };
+    char* pLimited = Json_CreateBufferWith(&oLimited);
+    Json_AddObject(&pLimited);
+    int bAdded = Json_AddPropertyNumberArray(&pLimited, "numbers", pNumbers, 3000);
+    const char* sLimitedError = Json_GetError(pLimited);
+    Json_ExitScope(&pLimited);
+    char* pLimitedCopy = (char*)malloc(strlen(pLimited) + 1);
+    strcpy(pLimitedCopy, pLimited);
+    JsonResult oLimitedResult = Json_Parse(pLimitedCopy);
+    JsonObject oLimitedNumbers = Json_GetPropertyByName(oLimitedResult.RootObject, "numbers").Value;
+    if (nComparison == 0 && (bAdded || !sLimitedError || strcmp(sLimitedError, "Out of memory") != 0 || !oLimitedResult.Success
+        || oLimitedNumbers.Type != JsonTypeArray || Json_GetElementCount(oLimitedNumbers) <= 0))
+    {
+        printf("Bulk array did not fail cleanly when out of memory\n%s\n", pLimited);
+        nComparison = 1;
+    }
+    free(pLimitedCopy);
+    Json_ReleaseBuffer(pLimited);
+    //same in a stream whose sink refuses a write partway, the array is closed in the append only buffer and the error kept
+    RefusingSink oRefusing = { 2, (char*)calloc(65536, 1) };
+    char* pRefused = Json_CreateStream(refuse_once_text, &oRefusing, 64);
+    Json_AddObject(&pRefused);
+    bAdded = Json_AddPropertyNumberArray(&pRefused, "numbers", pNumbers, 3000);
+    const char* sRefusedError = Json_GetError(pRefused);
+    Json_ExitScope(&pRefused);
+    int bRefusedClosed = Json_CloseStream(&pRefused);
+    JsonResult oRefusedResult = Json_Parse(oRefusing.Text);
+    JsonObject oRefusedNumbers = Json_GetPropertyByName(oRefusedResult.RootObject, "numbers").Value;
+    if (nComparison == 0 && (bAdded || !sRefusedError || strcmp(sRefusedError, "Failed to write to the stream") != 0 || !bRefusedClosed
+        || !oRefusedResult.Success || oRefusedNumbers.Type != JsonTypeArray || Json_GetElementCount(oRefusedNumbers) <= 0 || Json_GetElementCount(oRefusedNumbers) >= 3000))
+    {
+        printf("Bulk array did not fail cleanly when the stream refused a write\n%s\n", oRefusing.Text);
+        nComparison = 1;
+    }
+    free(oRefusing.Text);
+    Json_ReleaseBuffer(pRefused);
+    //the parsed document written in one call, then embedded next to its own text spliced in raw
+    char* pValueOutput = Json_CreateBuffer();
+    Json_AddValue(&pValueOutput, oResult.RootObject);
+    char* pEmbedded = Json_CreateBuffer();
+    Json_AddObject(&pEmbedded);
+    Json_AddPropertyValue(&pEmbedded, "value", oResult.RootObject);
+    Json_AddPropertyRaw(&pEmbedded, "raw", pOriginal, (int)strlen(pOriginal));
+    Json_AddPropertyArray(&pEmbedded, "list");
+    Json_AddRaw(&pEmbedded, pOriginal, (int)strlen(pOriginal));
+    Json_AddValue(&pEmbedded, oResult.RootObject);
+    Json_ExitScope(&pEmbedded);
+    Json_ExitScope(&pEmbedded);
+    char* pExpectedEmbedded = (char*)malloc(strlen(pOriginal) * 4 + 64);
+    sprintf(pExpectedEmbedded, "{\"value\":%s,\"raw\":%s,\"list\":[%s,%s]}", pOriginal, pOriginal, pOriginal, pOriginal);
+    if (nComparison == 0 && (strcmp(pOriginal, pValueOutput) != 0 || strcmp(pExpectedEmbedded, pEmbedded) != 0))
+    {
+        printf("Embedded values do not match the original\n");
+        nComparison = 1;
+    }
+    //the same through a stream, the values are written in chunks so the staging block only grows to a chunk
+    char* pStreamedEmbedded = (char*)calloc(strlen(pExpectedEmbedded) + 1, 1);
+    char* pEmbeddedStream = Json_CreateStream(append_text, pStreamedEmbedded, 16);
+    Json_AddObject(&pEmbeddedStream);
+    Json_AddPropertyValue(&pEmbeddedStream, "value", oResult.RootObject);
+    Json_AddPropertyRaw(&pEmbeddedStream, "raw", pOriginal, (int)strlen(pOriginal));
+    Json_AddPropertyArray(&pEmbeddedStream, "list");
+    Json_AddRaw(&pEmbeddedStream, pOriginal, (int)strlen(pOriginal));
+    Json_AddValue(&pEmbeddedStream, oResult.RootObject);
+    if (nComparison == 0 && (!Json_CloseStream(&pEmbeddedStream) || strcmp(pExpectedEmbedded, pStreamedEmbedded) != 0))
+    {
+        printf("Streamed values do not match the original\n%s\n", pStreamedEmbedded);
+        nComparison = 1;
+    }
+    free(pStreamedEmbedded);
+    Json_ReleaseBuffer(pEmbeddedStream);
+    long long nLargeLength = 0;
+    long long nLargeRecords = 0;
+    char* pLargeText = generate_large(1 << 20, &nLargeLength, &nLargeRecords);
+    JsonObject oLargeValue = Json_Parse(pLargeText).RootObject;
+    long long nLargeStreamed = 0;
+    char* pLargeStream = Json_CreateStream(count_text, &nLargeStreamed, 64);
+    int bLargeAdded = Json_AddValue(&pLargeStream, oLargeValue);
+    JsonBufferStats oLargeStats;
+    int bLargeBounded = !Json_GetBufferStats(pLargeStream, &oLargeStats) || oLargeStats.PeakCapacity < 16384;
+    if (nComparison == 0 && (!bLargeAdded || !Json_CloseStream(&pLargeStream) || nLargeStreamed != nLargeLength || !bLargeBounded))
+    {
+        printf("Large value was not streamed in chunks\n");
+        nComparison = 1;
+    }
+    free(pLargeText);
+    Json_ReleaseBuffer(pLargeStream);
+    free(pExpectedEmbedded);
+    Json_ReleaseBuffer(pValueOutput);
+    Json_ReleaseBuffer(pEmbedded);
+    //the children of the root written on several threads must give the same text
+    char* pParallel = Json_CreateBuffer();
+    if (oResult.RootObject.Type == JsonTypeArray)
+    {
+        int nCount = Json_GetElementCount(oResult.RootObject);
+        JsonObject* pElements = (JsonObject*)malloc(sizeof(JsonObject) * (nCount + 1));
+        for (JsonElement oElement = Json_IterateElements(oResult.RootObject); oElement.Value.Type != JsonTypeInvalid; oElement = Json_NextElement(oElement))
+            pElements[oElement.Index] = oElement.Value;
+        Json_AddArray(&pParallel);
+        Json_WriteParallel(&pParallel, nCount, 0, write_element_record, pElements, 3);
+        Json_ExitScope(&pParallel);
+        free(pElements);
+    }
+    else if (oResult.RootObject.Type == JsonTypeObject)
+    {
+        int nCount = 0;
+        JsonProperty* pProperties = (JsonProperty*)malloc(sizeof(JsonProperty) * (Json_GetPropertyCount(oResult.RootObject) + 1));
+        for (JsonProperty oProperty = Json_IterateProperties(oResult.RootObject); oProperty.Value.Type != JsonTypeInvalid; oProperty = Json_NextProperty(oProperty))
+            pProperties[nCount++] = oProperty;
+        Json_AddObject(&pParallel);
+        Json_WriteParallel(&pParallel, nCount, 1, write_property_record, pProperties, 3);
+        Json_ExitScope(&pParallel);
+        free(pProperties);
+    }
+    else
+        write_object(&pParallel, oResult.RootObject);
+    if (nComparison == 0 && (Json_GetError(pParallel) || strcmp(pOriginal, pParallel) != 0))
+    {
+        printf("Parallel writing generated a different JSON text\n%s\n", pParallel);
+        nComparison = 1;
+    }
+    Json_ReleaseBuffer(pParallel);
+    //structs written with the generated serializer
+    TestRecord pRecords[2] = { { 9007199254740993LL, "first \"one\"", 0.5, 1, -3, 0 }, { -1, "", 1e21, 0, 2147483647, "x" } };
+    char* pStructs = Json_CreateBuffer();
+    Json_AddObject(&pStructs);
+    Json_AddPropertyTestRecord(&pStructs, "head", &pRecords[0]);
+    Json_AddPropertyArray(&pStructs, "all");
+    Json_AddTestRecord(&pStructs, &pRecords[0]);
+    Json_AddTestRecord(&pStructs, &pRecords[1]);
+    Json_ExitScope(&pStructs);
+    Json_ExitScope(&pStructs);
+    const char* sExpectedRecord = "{\"Id\":9007199254740993,\"Name\":\"first \\\"one\\\"\",\"Score\":0.5,\"Active\":true,\"Rank\":-3,\"Note\":null}";
+    char sExpectedStructs[512];
+    sprintf(sExpectedStructs, "{\"head\":%s,\"all\":[%s,%s]}", sExpectedRecord, sExpectedRecord,
+        "{\"Id\":-1,\"Name\":\"\",\"Score\":1e21,\"Active\":false,\"Rank\":2147483647,\"Note\":\"x\"}");
+    if (nComparison == 0 && strcmp(sExpectedStructs, pStructs) != 0)
+    {
+        printf("Struct serializer generated a different JSON text\n%s\n%s\n", sExpectedStructs, pStructs);
+        nComparison = 1;
+    }
+    Json_ReleaseBuffer(pStructs);
+    //indented text compresses back to the original, and a style without spaces gives the compact text
+    char* pIndented = Json_Indent(pOriginal);
+    char* pPrinted = (char*)malloc(strlen(pIndented) + 1);
+    pPrinted[0] = '\0';
+    Json_FormatTo(pOriginal, 0, append_text, pPrinted);
+    int bIndentMatches = strcmp(pIndented, pPrinted) == 0;
+    Json_Compress(pPrinted);
+    JsonFormatStyle oCompact = { 0, ' ', ":", "" };
+    char* pCompact = (char*)malloc(strlen(pOriginal) + 1);
+    long long nCompactSize = Json_FormatInto(pOriginal, &oCompact, pCompact, (long long)strlen(pOriginal) + 1);
+    if (nComparison == 0 && (!bIndentMatches || strcmp(pOriginal, pPrinted) != 0 || nCompactSize != (long long)strlen(pOriginal)
+        || strcmp(pOriginal, pCompact) != 0 || Json_FormatInto(pOriginal, 0, pCompact, (long long)strlen(pOriginal)) != -1))
+    {
+        printf("Formatted text does not match the original\n%s\n", pIndented);
+        nComparison = 1;
+    }
+    //minifying from a const source leaves it untouched
+    char* pMinified = (char*)malloc(strlen(pIndented) + 1);
+    int nIndentedSize = (int)strlen(pIndented);
+    if (nComparison == 0 && (Json_CompressInto(pIndented, pMinified) != (long long)strlen(pOriginal) || strcmp(pOriginal, pMinified) != 0 || (int)strlen(pIndented) != nIndentedSize))
+    {
+        printf("Minified text does not match the original\n%s\n", pMinified);
+        nComparison = 1;
+    }
+    //buffer accounting is compiled in or out with the library
+    JsonBufferStats oStats;
+    char* pCounted = Json_CreateBuffer();
+    Json_AddArray(&pCounted);
+    for (int i = 0; i < 100; i++)
+        Json_AddInt64(&pCounted, i);
+    Json_AddString(&pCounted, "last");
+    Json_ExitScope(&pCounted);
+    int bCounted = Json_GetBufferStats(pCounted, &oStats);
+#ifdef JSON_BUFFER_STATS
+    bCounted = bCounted && oStats.Calls[JsonAddKindScope] == 1 && oStats.Calls[JsonAddKindNumber] == 100 && oStats.Calls[JsonAddKindRaw] == 0 && oStats.Calls[JsonAddKindString] == 1
+        && oStats.Gaps >= 102 && oStats.Reallocs > 0 && oStats.BytesMoved > 0 && oStats.PeakCapacity >= (long long)strlen(pCounted);
+    JsonBufferStats oOutputStats;
+    bCounted = bCounted && Json_GetBufferStats(pOutput, &oOutputStats) && oOutputStats.PeakCapacity >= (long long)strlen(pOutput);
+#else
+    bCounted = !bCounted && oStats.Reallocs == 0 && oStats.Calls[JsonAddKindScope] == 0;
+#endif
+    Json_ReleaseBuffer(pCounted);
+    if (nComparison == 0 && !bCounted)
+    {
+        printf("Buffer stats are wrong\n");
+        nComparison = 1;
+    }
+    free(pMinified);
+    free(pIndented);
+    free(pPrinted);
+    free(pCompact);
     if (nComparison == 0)
     {
         printf("JSON Generated without errors\n");
@@ -226,9 +865,591 @@ bool test_write(const char* filename)
     free(pContent);
     free(pOriginal);
     Json_ReleaseBuffer(pOutput);
+    Json_ReleaseBuffer(pAppendOutput);
     return nComparison == 0;
 }
 
+/// @brief copies the parsed subtrees into arenas and checks they still produce the same text
+/// @param filename 
+bool test_subtree(const char* filename)
+{
+    char* pContent = read_content(filename);
+    JsonResult oResult = Json_Parse(pContent);
+
+    char* pExpected = Json_CreateBuffer();
+    write_object(&pExpected, oResult.RootObject);
+
+    //copy the whole document into an arena of the exact size
+    long long nRootSize = Json_MeasureSubtree(oResult.RootObject);
+    char* pRootMemory = (char*)malloc(nRootSize);
+    JsonArena oRootArena;
+    Json_InitArena(&oRootArena, pRootMemory, nRootSize);
+    JsonObject oRootCopy = Json_CopySubtreeToArena(&oRootArena, oResult.RootObject);
+
+    //repack every direct child into a second arena
+    JsonObject pChildren[64];
+    int nChildren = 0;
+    if (oResult.RootObject.Type == JsonTypeArray)
+        for (JsonElement oElement = Json_IterateElements(oResult.RootObject); oElement.Value.Type != JsonTypeInvalid && nChildren < 64; oElement = Json_NextElement(oElement))
+            pChildren[nChildren++] = oElement.Value;
+    else if (oResult.RootObject.Type == JsonTypeObject)
+        for (JsonProperty oProperty = Json_IterateProperties(oResult.RootObject); oProperty.Value.Type != JsonTypeInvalid && nChildren < 64; oProperty = Json_NextProperty(oProperty))
+            pChildren[nChildren++] = oProperty.Value;
+    char* pExpectedChildren = Json_CreateBuffer();
+    Json_AddArray(&pExpectedChildren);
+    for (int i = 0; i < nChildren; i++)
+        write_object(&pExpectedChildren, pChildren[i]);
+    Json_ExitScope(&pExpectedChildren);
+
+    char* pChildMemory = (char*)malloc(nRootSize);
+    JsonArena oChildArena;
+    Json_InitArena(&oChildArena, pChildMemory, nRootSize);
+    bool bCompacted = Json_CompactSubtrees(&oChildArena, pChildren, nChildren);
+
+    memset(pContent, 0, strlen(pContent));//the copies must not depend on the original buffer
+    free(pContent);
+
+    char* pOutput = Json_CreateBuffer();
+    write_object(&pOutput, oRootCopy);
+    char* pOutputChildren = Json_CreateBuffer();
+    Json_AddArray(&pOutputChildren);
+    for (int i = 0; i < nChildren; i++)
+        write_object(&pOutputChildren, pChildren[i]);
+    Json_ExitScope(&pOutputChildren);
+
+    bool bResult = oRootArena.Used == nRootSize && bCompacted
+        && strcmp(pExpected, pOutput) == 0 && strcmp(pExpectedChildren, pOutputChildren) == 0;
+    if (bResult)
+        printf("Subtrees copied without errors\n");
+    else
+        printf("Copied subtrees do not match original\n");
+
+    free(pRootMemory);
+    free(pChildMemory);
+    Json_ReleaseBuffer(pExpected);
+    Json_ReleaseBuffer(pExpectedChildren);
+    Json_ReleaseBuffer(pOutput);
+    Json_ReleaseBuffer(pOutputChildren);
+    return bResult;
+}
+
+/// @brief rewrites every scalar of the parsed file in place and iterates it again
+/// @param filename 
+bool test_mutation(const char* filename)
+{
+    char* pContent = read_content(filename);
+    JsonResult oResult = Json_Parse(pContent);
+    bool bResult = mutate_object(oResult.RootObject) && iterate_object(Json_Load(pContent));
+    free(pContent);
+    if (bResult == true)
+        printf("Mutated without errors.\n");
+    return bResult;
+}
+
+bool mutate_object(JsonObject oJson)
+{
+    switch (oJson.Type)
+    {
+        case JsonTypeArray:
+            for (JsonElement oElement = Json_IterateElements(oJson); oElement.Value.Type != JsonTypeInvalid; oElement = Json_NextElement(oElement))
+                if (!mutate_object(oElement.Value))
+                    return false;
+            break;
+        case JsonTypeObject:
+            for (JsonProperty oProperty = Json_IterateProperties(oJson); oProperty.Value.Type != JsonTypeInvalid; oProperty = Json_NextProperty(oProperty))
+                if (!mutate_object(oProperty.Value))
+                    return false;
+            break;
+        case JsonTypeBool:
+            if (!Json_SetBool(&oJson, !oJson.BoolValue) || !Json_SetNull(&oJson) || oJson.Type != JsonTypeNull)
+                return false;
+            break;
+        case JsonTypeNull:
+            if (!Json_SetBool(&oJson, 1) || oJson.BoolValue != 1)
+                return false;
+            break;
+        case JsonTypeNumber:
+        {
+            double nValue = oJson.DoubleValue;
+            if (!Json_SetNumber(&oJson, nValue) || oJson.DoubleValue != nValue)//the same value always fits
+                return false;
+            if (!Json_SetNumber(&oJson, 7) || oJson.DoubleValue != 7)//any number slot holds a digit
+                return false;
+            break;
+        }
+        case JsonTypeString:
+        {
+            int bFits = Json_MeasureSubtree(oJson) <= 63;//large strings only take values of the same length
+            if (Json_SetString(&oJson, "") != bFits)
+                return false;
+            if (bFits && strcmp(oJson.StringValue, "") != 0)
+                return false;
+            break;
+        }
+        default:
+            return false;
+    }
+    return true;
+}
+
+/// @brief removes, inserts and moves values of the parsed file, one by one and in a batch
+/// @param filename 
+bool test_editing(const char* filename)
+{
+    char* pContent = read_content(filename);
+    JsonResult oResult = Json_Parse(pContent);
+    long long nCapacity = oResult.EndSize * 4 + 256;
+    char* pBuffer = (char*)malloc(nCapacity);
+    JsonObject oRoot = Json_CopySubtree(oResult.RootObject, pBuffer, nCapacity);
+    JsonEditor oEditor;
+    Json_InitEditor(&oEditor, pBuffer, nCapacity);
+    char pValue[256];
+    bool bResult = true;
+
+    if (oRoot.Type == JsonTypeArray)
+    {
+        //grow the array past the small marker limit and shrink it back
+        int nCount = Json_GetElementCount(oRoot);
+        JsonObject oFirst = Json_CopySubtree(Json_GetElementAtIndex(oRoot, 0).Value, pValue, sizeof(pValue));
+        for (int i = 0; i < 24 && bResult; i++)
+            bResult = Json_AppendElement(&oEditor, Json_Load(pBuffer), oFirst) && check_sizes(Json_Load(pBuffer)) >= 0;
+        bResult = bResult && Json_GetElementCount(Json_Load(pBuffer)) == nCount + 24;
+        for (int i = 0; i < 24 && bResult; i++)
+            bResult = Json_RemoveElement(&oEditor, Json_Load(pBuffer), 0) && check_sizes(Json_Load(pBuffer)) >= 0;
+        bResult = bResult && Json_GetElementCount(Json_Load(pBuffer)) == nCount;
+
+        //move the first element to the end of the last one (if it is an array)
+        JsonObject oLast = Json_GetElementAtIndex(Json_Load(pBuffer), nCount - 1).Value;
+        if (bResult && oLast.Type == JsonTypeArray)
+            bResult = Json_MoveElement(&oEditor, Json_Load(pBuffer), 0, oLast) && check_sizes(Json_Load(pBuffer)) >= 0
+                && Json_GetElementCount(Json_Load(pBuffer)) == nCount - 1;
+
+        //remove every other element and append two in a single pass
+        JsonEdit pEdits[64];
+        JsonEditBatch oBatch;
+        Json_InitBatch(&oBatch, pEdits, 64);
+        oRoot = Json_Load(pBuffer);
+        nCount = Json_GetElementCount(oRoot);
+        for (int i = 0; i < nCount; i += 2)
+            Json_BatchRemoveElement(&oBatch, oRoot, i);
+        Json_BatchAppendElement(&oBatch, oRoot, oFirst);
+        Json_BatchAppendElement(&oBatch, oRoot, oFirst);
+        bResult = bResult && Json_CommitBatch(&oEditor, &oBatch) && check_sizes(Json_Load(pBuffer)) >= 0
+            && Json_GetElementCount(Json_Load(pBuffer)) == nCount / 2 + 2;
+    }
+    else if (oRoot.Type == JsonTypeObject)
+    {
+        //take the first property out and put it back at the end
+        int nCount = Json_GetPropertyCount(oRoot);
+        JsonProperty oFirst = Json_IterateProperties(oRoot);
+        char sName[64];
+        strcpy(sName, oFirst.Name);
+        JsonObject oValue = Json_CopySubtree(oFirst.Value, pValue, sizeof(pValue));
+        bResult = Json_RemoveProperty(&oEditor, oRoot, sName) && check_sizes(Json_Load(pBuffer)) >= 0
+            && Json_GetPropertyCount(Json_Load(pBuffer)) == nCount - 1
+            && Json_GetPropertyByName(Json_Load(pBuffer), sName).Value.Type == JsonTypeInvalid;
+        bResult = bResult && Json_InsertProperty(&oEditor, Json_Load(pBuffer), sName, oValue) && check_sizes(Json_Load(pBuffer)) >= 0
+            && Json_GetPropertyCount(Json_Load(pBuffer)) == nCount
+            && Json_GetPropertyByName(Json_Load(pBuffer), sName).Value.Type == oValue.Type;
+
+        //move it into the first object property found
+        for (JsonProperty oProperty = Json_IterateProperties(Json_Load(pBuffer)); bResult && oProperty.Value.Type != JsonTypeInvalid; oProperty = Json_NextProperty(oProperty))
+            if (oProperty.Value.Type == JsonTypeObject)
+            {
+                int nChildCount = Json_GetPropertyCount(oProperty.Value);
+                bResult = Json_MoveProperty(&oEditor, Json_Load(pBuffer), sName, oProperty.Value) && check_sizes(Json_Load(pBuffer)) >= 0
+                    && Json_GetPropertyCount(Json_Load(pBuffer)) == nCount - 1
+                    && Json_GetPropertyCount(Json_GetPropertyByName(Json_Load(pBuffer), (char*)oProperty.Name).Value) == nChildCount + 1;
+                nCount--;
+                break;
+            }
+
+        //remove everything and add a single property in a single pass
+        JsonEdit pEdits[64];
+        JsonEditBatch oBatch;
+        Json_InitBatch(&oBatch, pEdits, 64);
+        oRoot = Json_Load(pBuffer);
+        for (JsonProperty oProperty = Json_IterateProperties(oRoot); oProperty.Value.Type != JsonTypeInvalid; oProperty = Json_NextProperty(oProperty))
+            Json_BatchRemoveProperty(&oBatch, oRoot, oProperty.Name);
+        Json_BatchInsertProperty(&oBatch, oRoot, sName, oValue);
+        bResult = bResult && Json_CommitBatch(&oEditor, &oBatch) && check_sizes(Json_Load(pBuffer)) >= 0
+            && Json_GetPropertyCount(Json_Load(pBuffer)) == 1;
+    }
+    bResult = bResult && oEditor.Size == Json_MeasureSubtree(Json_Load(pBuffer)) && iterate_object(Json_Load(pBuffer));
+
+    free(pContent);
+    free(pBuffer);
+    if (bResult == true)
+        printf("Edited without errors.\n");
+    else
+        printf("Editing failed : %s\n", oEditor.Error ? oEditor.Error : "unexpected result");
+    return bResult;
+}
+
+/// @brief compares the parsed file with a reordered and a modified copy of itself
+/// @param filename 
+bool test_compare(const char* filename)
+{
+    char* pContent = read_content(filename);
+    JsonResult oResult = Json_Parse(pContent);
+    long long nCapacity = oResult.EndSize + 64;
+    char* pCopy = (char*)malloc(nCapacity);
+    Json_CopySubtree(oResult.RootObject, pCopy, nCapacity);
+    JsonEditor oEditor;
+    Json_InitEditor(&oEditor, pCopy, nCapacity);
+
+    bool bResult = Json_Equals(oResult.RootObject, Json_Load(pCopy)) && Json_Hash(oResult.RootObject) == Json_Hash(Json_Load(pCopy));
+    if (oResult.RootObject.Type == JsonTypeObject)
+    {
+        //the same properties in a different order
+        Json_MoveProperty(&oEditor, Json_Load(pCopy), Json_IterateProperties(oResult.RootObject).Name, Json_Load(pCopy));
+        bResult = bResult && Json_Equals(oResult.RootObject, Json_Load(pCopy)) && Json_Hash(oResult.RootObject) == Json_Hash(Json_Load(pCopy));
+        Json_RemoveProperty(&oEditor, Json_Load(pCopy), Json_IterateProperties(oResult.RootObject).Name);
+    }
+    else if (oResult.RootObject.Type == JsonTypeArray)
+    {
+        //the same elements in a different order
+        Json_MoveElement(&oEditor, Json_Load(pCopy), 0, Json_Load(pCopy));
+        bResult = bResult && !Json_Equals(oResult.RootObject, Json_Load(pCopy)) && Json_Hash(oResult.RootObject) != Json_Hash(Json_Load(pCopy));
+        Json_MoveElement(&oEditor, Json_Load(pCopy), 0, Json_Load(pCopy));
+    }
+    bResult = bResult && !Json_Equals(oResult.RootObject, Json_Load(pCopy)) && Json_Hash(oResult.RootObject) != Json_Hash(Json_Load(pCopy));
+    //all the keys in reverse order, then one value changed, then one name changed
+    char pName[32];
+    char* pForward = Json_CreateBuffer();
+    char* pBackward = Json_CreateBuffer();
+    Json_AddObject(&pForward);
+    Json_AddObject(&pBackward);
+    for (int i = 0; i < 300; i++)
+    {
+        sprintf(pName, "key %i", i);
+        Json_AddPropertyInt64(&pForward, pName, i);
+        sprintf(pName, "key %i", 299 - i);
+        Json_AddPropertyInt64(&pBackward, pName, i == 150 ? -1 : 299 - i);
+    }
+    Json_ExitScope(&pForward);
+    Json_ExitScope(&pBackward);
+    JsonObject oForward = Json_Parse(pForward).RootObject;
+    bResult = bResult && !Json_Equals(oForward, Json_Parse(pBackward).RootObject);
+    Json_ResetBuffer(pBackward);
+    Json_AddObject(&pBackward);
+    for (int i = 0; i < 300; i++)
+    {
+        sprintf(pName, "key %i", 299 - i);
+        Json_AddPropertyInt64(&pBackward, pName, 299 - i);
+    }
+    Json_ExitScope(&pBackward);
+    char* pRenamed = (char*)malloc(strlen(pBackward) + 1);
+    strcpy(pRenamed, pBackward);
+    pRenamed[strstr(pRenamed, "key 7\"") - pRenamed + 4] = 'x';
+    JsonObject oBackward = Json_Parse(pBackward).RootObject;
+    bResult = bResult && Json_Equals(oForward, oBackward) && Json_Equals(oBackward, oForward) && Json_Hash(oForward) == Json_Hash(oBackward);
+    bResult = bResult && !Json_Equals(oForward, Json_Parse(pRenamed).RootObject);
+    free(pRenamed);
+    Json_ReleaseBuffer(pForward);
+    Json_ReleaseBuffer(pBackward);
+
+    free(pContent);
+    free(pCopy);
+    if (bResult == true)
+        printf("Compared without errors.\n");
+    return bResult;
+}
+
+/// @brief rebuilds the parsed file with the direct builder and checks it reads back the same
+/// @param filename 
+bool test_build(const char* filename)
+{
+    char* pContent = read_content(filename);
+    JsonResult oResult = Json_Parse(pContent);
+    long long nSize = oResult.EndSize * 2 + 64;//numbers may take a wider encoding than the parser picked
+    char* pMemory = (char*)malloc(nSize);
+    JsonArena oArena;
+    Json_InitArena(&oArena, pMemory, nSize);
+    JsonBuilder oBuilder;
+    Json_InitBuilder(&oBuilder, &oArena);
+    build_object(&oBuilder, oResult.RootObject);
+    JsonObject oBuilt = Json_BuildFinish(&oBuilder);
+
+    char* pExpected = Json_CreateBuffer();
+    write_object(&pExpected, oResult.RootObject);
+    char* pOutput = Json_CreateBuffer();
+    write_object(&pOutput, oBuilt);
+    bool bResult = oBuilt.Type != JsonTypeInvalid && Json_Equals(oResult.RootObject, oBuilt) && check_sizes(oBuilt) >= 0
+        && Json_MeasureSubtree(oBuilt) == oArena.Used && strcmp(pExpected, pOutput) == 0;
+
+    //misuse is reported instead of producing a broken encoding
+    Json_InitArena(&oArena, pMemory, nSize);
+    Json_InitBuilder(&oBuilder, &oArena);
+    Json_BuildObject(&oBuilder);
+    bResult = bResult && !Json_BuildNull(&oBuilder) && oBuilder.Error != 0;
+    Json_InitBuilder(&oBuilder, &oArena);
+    Json_BuildArray(&oBuilder);
+    bResult = bResult && Json_BuildFinish(&oBuilder).Type == JsonTypeInvalid;
+    Json_InitArena(&oArena, pMemory, 4);
+    Json_InitBuilder(&oBuilder, &oArena);
+    bResult = bResult && !Json_BuildString(&oBuilder, "too long for the arena");
+
+    free(pContent);
+    free(pMemory);
+    Json_ReleaseBuffer(pExpected);
+    Json_ReleaseBuffer(pOutput);
+    if (bResult == true)
+        printf("Built without errors.\n");
+    return bResult;
+}
+
+/// @brief copies a parsed value into a builder, the same walk write_object does for the text writer
+int build_object(JsonBuilder* pBuilder, JsonObject oJson)
+{
+    switch (oJson.Type)
+    {
+        case JsonTypeArray:
+            Json_BuildArray(pBuilder);
+            for (JsonElement oElement = Json_IterateElements(oJson); oElement.Value.Type != JsonTypeInvalid; oElement = Json_NextElement(oElement))
+                build_object(pBuilder, oElement.Value);
+            return Json_BuildEnd(pBuilder);
+        case JsonTypeObject:
+            Json_BuildObject(pBuilder);
+            for (JsonProperty oProperty = Json_IterateProperties(oJson); oProperty.Value.Type != JsonTypeInvalid; oProperty = Json_NextProperty(oProperty))
+            {
+                Json_BuildKey(pBuilder, oProperty.Name);
+                build_object(pBuilder, oProperty.Value);
+            }
+            return Json_BuildEnd(pBuilder);
+        case JsonTypeBool:
+            return Json_BuildBool(pBuilder, oJson.BoolValue);
+        case JsonTypeNull:
+            return Json_BuildNull(pBuilder);
+        case JsonTypeNumber:
+            return Json_BuildNumber(pBuilder, oJson.DoubleValue);
+        case JsonTypeString:
+            return Json_BuildString(pBuilder, oJson.StringValue);
+        default:
+            return 0;
+    }
+}
+
+/// @brief replays the events of the file into a builder, and checks skipping, aborting and that the text is untouched
+/// @param filename 
+bool test_events(const char* filename)
+{
+    char* pContent = read_content(filename);
+    char* pSource = strdup(pContent);
+    JsonResult oResult = Json_Parse(pContent);
+    long long nSize = oResult.EndSize * 2 + 64;
+    char* pMemory = (char*)malloc(nSize);
+    char pScratch[4096];
+    JsonArena oArena;
+    Json_InitArena(&oArena, pMemory, nSize);
+    JsonBuilder oBuilder;
+    Json_InitBuilder(&oBuilder, &oArena);
+
+    JsonEventHandler oHandler = { event_start_object, event_end, event_start_array, event_end, event_key, event_string, event_number, event_bool, event_null, &oBuilder };
+    JsonResult oEvents = Json_ParseEvents(pSource, &oHandler, pScratch, sizeof(pScratch));
+    JsonObject oBuilt = Json_BuildFinish(&oBuilder);
+    bool bResult = oEvents.Success && oBuilt.Type != JsonTypeInvalid && Json_Equals(oResult.RootObject, oBuilt);
+
+    //the source is only read
+    char* pOriginal = read_content(filename);
+    bResult = bResult && strcmp(pSource, pOriginal) == 0;
+
+    //skipping every container below the root leaves only the scalars of the root
+    int nCounts[2] = { 0, 0 };
+    JsonEventHandler oSkip = { event_skip_nested, 0, event_skip_nested, 0, 0, event_count_string, event_count_number, event_count_bool, event_count, nCounts };
+    oEvents = Json_ParseEvents(pSource, &oSkip, pScratch, sizeof(pScratch));
+    int nScalars = 0;
+    if (oResult.RootObject.Type == JsonTypeObject)
+    {
+        for (JsonProperty oProperty = Json_IterateProperties(oResult.RootObject); oProperty.Value.Type != JsonTypeInvalid; oProperty = Json_NextProperty(oProperty))
+            nScalars += oProperty.Value.Type != JsonTypeObject && oProperty.Value.Type != JsonTypeArray;
+    }
+    else if (oResult.RootObject.Type == JsonTypeArray)
+    {
+        for (JsonElement oElement = Json_IterateElements(oResult.RootObject); oElement.Value.Type != JsonTypeInvalid; oElement = Json_NextElement(oElement))
+            nScalars += oElement.Value.Type != JsonTypeObject && oElement.Value.Type != JsonTypeArray;
+    }
+    bResult = bResult && oEvents.Success && nCounts[1] == nScalars;
+
+    //aborting stops at the first container
+    nCounts[0] = nCounts[1] = 0;
+    JsonEventHandler oAbort = { event_abort, 0, event_abort, 0, 0, 0, 0, 0, 0, nCounts };
+    oEvents = Json_ParseEvents(pSource, &oAbort, pScratch, sizeof(pScratch));
+    bResult = bResult && !oEvents.Success && oEvents.Error != 0 && nCounts[1] == 1;
+
+    //strings that don't fit the scratch area and broken text are errors
+    JsonEventHandler oEmpty = { 0 };
+    bResult = bResult && !Json_ParseEvents("[\"longer than the scratch\"]", &oEmpty, pScratch, 8).Success;
+    bResult = bResult && !Json_ParseEvents("{\"a\":1,}", &oEmpty, pScratch, sizeof(pScratch)).Success;
+    bResult = bResult && !Json_ParseEvents("[1 2]", &oEmpty, pScratch, sizeof(pScratch)).Success;
+    bResult = bResult && Json_ParseEvents("{\"a\":[{}],\"b\":\"\\\"\"}", &oEmpty, pScratch, sizeof(pScratch)).Success;
+
+    free(pContent);
+    free(pSource);
+    free(pOriginal);
+    free(pMemory);
+    if (bResult == true)
+        printf("Replayed events without errors.\n");
+    return bResult;
+}
+
+/// @brief converts the parsed file to MessagePack and CBOR and back, then checks a few encodings byte by byte
+/// @param filename 
+bool test_transcode(const char* filename)
+{
+    char* pContent = read_content(filename);
+    JsonResult oResult = Json_Parse(pContent);
+    long long nCapacity = oResult.EndSize * 5 + 64;//a 2 bytes decimal becomes a 9 bytes double
+    char* pBinary = (char*)malloc(nCapacity);
+    char* pBack = (char*)malloc(nCapacity * 4);
+    bool bResult = true;
+    for (int bCbor = 0; bCbor < 2 && bResult; bCbor++)
+    {
+        long long nSize = bCbor ? Json_ToCbor(oResult.RootObject, pBinary, nCapacity) : Json_ToMessagePack(oResult.RootObject, pBinary, nCapacity);
+        JsonResult oBack = bCbor ? Json_FromCbor(pBinary, nSize, pBack, nSize * 4) : Json_FromMessagePack(pBinary, nSize, pBack, nSize * 4);
+        bResult = nSize > 0 && oBack.Success && oBack.InitialSize == nSize && Json_Equals(oResult.RootObject, oBack.RootObject)
+            && check_sizes(oBack.RootObject) >= 0 && Json_MeasureSubtree(oBack.RootObject) == oBack.EndSize;
+        //a short destination or a cut input is reported
+        long long nShort = bCbor ? Json_ToCbor(oResult.RootObject, pBinary, nSize - 1) : Json_ToMessagePack(oResult.RootObject, pBinary, nSize - 1);
+        JsonResult oCut = bCbor ? Json_FromCbor(pBinary, nSize - 1, pBack, nSize * 4) : Json_FromMessagePack(pBinary, nSize - 1, pBack, nSize * 4);
+        bResult = bResult && nShort == -1 && !oCut.Success && oCut.Error != 0;
+    }
+
+    //{"a":[1,-1,300,1.5,true,null,"x"]} as the specifications write it
+    char pText[] = "{\"a\":[1,-1,300,1.5,true,null,\"x\"]}";
+    const unsigned char pMessagePack[] = { 0x81, 0xA1, 'a', 0x97, 0x01, 0xFF, 0xCD, 0x01, 0x2C, 0xCB, 0x3F, 0xF8, 0, 0, 0, 0, 0, 0, 0xC3, 0xC0, 0xA1, 'x' };
+    const unsigned char pCbor[] = { 0xA1, 0x61, 'a', 0x87, 0x01, 0x20, 0x19, 0x01, 0x2C, 0xFB, 0x3F, 0xF8, 0, 0, 0, 0, 0, 0, 0xF5, 0xF6, 0x61, 'x' };
+    JsonObject oSample = Json_Parse(pText).RootObject;
+    long long nSize = Json_ToMessagePack(oSample, pBinary, nCapacity);
+    bResult = bResult && nSize == sizeof(pMessagePack) && memcmp(pBinary, pMessagePack, nSize) == 0;
+    nSize = Json_ToCbor(oSample, pBinary, nCapacity);
+    bResult = bResult && nSize == sizeof(pCbor) && memcmp(pBinary, pCbor, nSize) == 0;
+
+    //CBOR half floats, tags, indefinite lengths and chunked text read like their plain forms
+    const unsigned char pLoose[] = { 0xBF, 0x7F, 0x61, 'a', 0xFF, 0x9F, 0x01, 0xF9, 0x3E, 0x00, 0xC1, 0x1A, 0, 0, 0, 0x2A, 0xF7, 0xFF, 0xFF };
+    char pLooseText[] = "{\"a\":[1,1.5,42,null]}";
+    JsonResult oLoose = Json_FromCbor((const char*)pLoose, sizeof(pLoose), pBack, nCapacity * 4);
+    bResult = bResult && oLoose.Success && oLoose.InitialSize == sizeof(pLoose) && Json_Equals(oLoose.RootObject, Json_Parse(pLooseText).RootObject);
+
+    //values without a json equivalent and non string keys are errors at their offset
+    const unsigned char pBin[] = { 0x92, 0x01, 0xC4, 0x00 };
+    const unsigned char pIntKey[] = { 0x81, 0x01, 0x01 };
+    const unsigned char pNullChar[] = { 0x62, 'a', 0 };
+    JsonResult oError = Json_FromMessagePack((const char*)pBin, sizeof(pBin), pBack, nCapacity * 4);
+    bResult = bResult && !oError.Success && oError.Index == 2;
+    oError = Json_FromMessagePack((const char*)pIntKey, sizeof(pIntKey), pBack, nCapacity * 4);
+    bResult = bResult && !oError.Success && oError.Index == 1;
+    oError = Json_FromCbor((const char*)pNullChar, sizeof(pNullChar), pBack, nCapacity * 4);
+    bResult = bResult && !oError.Success && oError.Index == 1;
+
+    free(pContent);
+    free(pBinary);
+    free(pBack);
+    if (bResult == true)
+        printf("Transcoded without errors.\n");
+    return bResult;
+}
+
+int event_start_object(void* pUser) { return Json_BuildObject((JsonBuilder*)pUser) ? JsonEventContinue : JsonEventAbort; }
+int event_start_array(void* pUser) { return Json_BuildArray((JsonBuilder*)pUser) ? JsonEventContinue : JsonEventAbort; }
+int event_end(void* pUser) { return Json_BuildEnd((JsonBuilder*)pUser) ? JsonEventContinue : JsonEventAbort; }
+int event_key(void* pUser, const char* sName, int nLength) { (void)nLength; return Json_BuildKey((JsonBuilder*)pUser, sName) ? JsonEventContinue : JsonEventAbort; }
+int event_string(void* pUser, const char* sValue, int nLength) { (void)nLength; return Json_BuildString((JsonBuilder*)pUser, sValue) ? JsonEventContinue : JsonEventAbort; }
+int event_number(void* pUser, double nValue) { return Json_BuildNumber((JsonBuilder*)pUser, nValue) ? JsonEventContinue : JsonEventAbort; }
+int event_bool(void* pUser, int bValue) { return Json_BuildBool((JsonBuilder*)pUser, bValue) ? JsonEventContinue : JsonEventAbort; }
+int event_null(void* pUser) { return Json_BuildNull((JsonBuilder*)pUser) ? JsonEventContinue : JsonEventAbort; }
+
+//counts[0] is the depth, counts[1] the scalars seen
+int event_skip_nested(void* pUser) { return ((int*)pUser)[0]++ == 0 ? JsonEventContinue : JsonEventSkip; }
+int event_count(void* pUser) { ((int*)pUser)[1]++; return JsonEventContinue; }
+int event_count_string(void* pUser, const char* sValue, int nLength) { (void)sValue; (void)nLength; return event_count(pUser); }
+int event_count_number(void* pUser, double nValue) { (void)nValue; return event_count(pUser); }
+int event_count_bool(void* pUser, int bValue) { (void)bValue; return event_count(pUser); }
+int event_abort(void* pUser) { ((int*)pUser)[1]++; return JsonEventAbort; }
+
+/// @brief checks that every container size matches its content, and the small/large markers are used accordingly
+/// @return the size of the value or -1 if it is inconsistent
+int check_sizes(JsonObject oJson)
+{
+    int nSize = Json_MeasureSubtree(oJson);
+    int nContentSize = 2;
+    if (oJson.Type == JsonTypeArray)
+    {
+        for (JsonElement oElement = Json_IterateElements(oJson); oElement.Value.Type != JsonTypeInvalid; oElement = Json_NextElement(oElement))
+        {
+            int nChildSize = check_sizes(oElement.Value);
+            if (nChildSize < 0)
+                return -1;
+            nContentSize += nChildSize;
+        }
+    }
+    else if (oJson.Type == JsonTypeObject)
+    {
+        for (JsonProperty oProperty = Json_IterateProperties(oJson); oProperty.Value.Type != JsonTypeInvalid; oProperty = Json_NextProperty(oProperty))
+        {
+            int nChildSize = check_sizes(oProperty.Value);
+            if (nChildSize < 0)
+                return -1;
+            nContentSize += nChildSize + (int)strlen(oProperty.Name) + 2;
+        }
+    }
+    else
+        return nSize;
+    bool bIsSmall = (*oJson.Position & 0x3) != 0;
+    if (nSize != nContentSize || bIsSmall != (nSize <= 63))
+        return -1;
+    return nSize;
+}
+
+//allocator that refuses to grow a block past the limit pointed by the user pointer
+void* limited_alloc(void* pUser, size_t nSize)
+{
+    return nSize > *(size_t*)pUser ? 0 : malloc(nSize);
+}
+void* limited_realloc(void* pUser, void* pMemory, size_t nSize)
+{
+    return nSize > *(size_t*)pUser ? 0 : realloc(pMemory, nSize);
+}
+void limited_free(void* pUser, void* pMemory)
+{
+    (void)pUser;
+    free(pMemory);
+}
+
+int append_text(void* pUser, const char* pData, size_t nSize)
+{
+    strncat((char*)pUser, pData, nSize);
+    return 1;
+}
+
+int refuse_once_text(void* pUser, const char* pData, size_t nSize)
+{
+    RefusingSink* pSink = (RefusingSink*)pUser;
+    if (pSink->CallsBeforeRefusal-- == 0)
+        return 0;
+    strncat(pSink->Text, pData, nSize);
+    return 1;
+}
+
+int count_text(void* pUser, const char* pData, size_t nSize)
+{
+    (void)pData;
+    *(long long*)pUser += nSize;
+    return 1;
+}
+
+int write_element_record(char** pBuffer, int nIndex, void* pUser)
+{
+    write_object(pBuffer, ((JsonObject*)pUser)[nIndex]);
+    return Json_GetError(*pBuffer) == 0;
+}
+
+int write_property_record(char** pBuffer, int nIndex, void* pUser)
+{
+    write_property(pBuffer, ((JsonProperty*)pUser)[nIndex]);
+    return Json_GetError(*pBuffer) == 0;
+}
+
 void write_object(char** pBuffer, JsonObject oJson)
 {
     switch (oJson.Type)
@@ -10,9 +10,53 @@
 int run_directory();
 int run_file(const char* filename);
 bool test_parse(const char* filename);
+bool test_large();
+bool test_large_write();
+char* generate_large(long long nSize, long long* pLength, long long* pRecords);
 bool test_iterators(const char* filename);
+bool test_unicode(const char* filename);
+bool test_stats(const char* filename);
+int count_values(JsonObject oJson, long long* pCounts, long long* pKeys);
+int event_copy_string(void* pUser, const char* sValue, int nLength);
 bool iterate_object(JsonObject oJson);
 bool test_write(const char* filename);
+bool test_subtree(const char* filename);
+bool test_mutation(const char* filename);
+bool mutate_object(JsonObject oJson);
+bool test_editing(const char* filename);
+int check_sizes(JsonObject oJson);
+bool test_compare(const char* filename);
+bool test_build(const char* filename);
+int build_object(JsonBuilder* pBuilder, JsonObject oJson);
+bool test_events(const char* filename);
+bool test_transcode(const char* filename);
+int event_start_object(void* pUser);
+int event_start_array(void* pUser);
+int event_end(void* pUser);
+int event_key(void* pUser, const char* sName, int nLength);
+int event_string(void* pUser, const char* sValue, int nLength);
+int event_number(void* pUser, double nValue);
+int event_bool(void* pUser, int bValue);
+int event_null(void* pUser);
+int event_skip_nested(void* pUser);
+int event_count(void* pUser);
+int event_count_string(void* pUser, const char* sValue, int nLength);
+int event_count_number(void* pUser, double nValue);
+int event_count_bool(void* pUser, int bValue);
+int event_abort(void* pUser);
+void* limited_alloc(void* pUser, size_t nSize);
+void* limited_realloc(void* pUser, void* pMemory, size_t nSize);
+void limited_free(void* pUser, void* pMemory);
+int append_text(void* pUser, const char* pData, size_t nSize);
+int count_text(void* pUser, const char* pData, size_t nSize);
+typedef struct RefusingSink
+{
+    int CallsBeforeRefusal;//the sink refuses once after this many writes, then accepts again
+    char* Text;
+} RefusingSink;
+int refuse_once_text(void* pUser, const char* pData, size_t nSize);
+int write_element_record(char** pBuffer, int nIndex, void* pUser);
+int write_property_record(char** pBuffer, int nIndex, void* pUser);
 
 //helper function
 char* read_content(const char* filename)
@@ -33,10 +77,10 @@ void dump_object(JsonObject oJson, int nLevel)
     switch (oJson.Type)
     {
         case JsonTypeArray:
-            printf("%*s array(%i)\n", nLevel * 4, "", Json_GetElementCount(oJson));
+            printf("%*s array(%lli)\n", nLevel * 4, "", Json_GetElementCount(oJson));
             for (JsonElement oElement = Json_IterateElements(oJson); oElement.Value.Type != JsonTypeInvalid; oElement = Json_NextElement(oElement))
             {
-                printf("%*s element(%i)\n", (nLevel + 1) * 4, "", oElement.Index);
+                printf("%*s element(%llu)\n", (nLevel + 1) * 4, "", oElement.Index);
                 dump_object(oElement.Value, nLevel + 1);
 
             }
@@ -51,7 +95,7 @@ void dump_object(JsonObject oJson, int nLevel)
             printf("%*s number(%f)\n", nLevel * 4, "", oJson.DoubleValue);
             break;
         case JsonTypeObject:
-            printf("%*s object(%i)\n", nLevel * 4, "", Json_GetPropertyCount(oJson));
+            printf("%*s object(%lli)\n", nLevel * 4, "", Json_GetPropertyCount(oJson));
             for (JsonProperty oProperty = Json_IterateProperties(oJson); oProperty.Value.Type != JsonTypeInvalid; oProperty = Json_NextProperty(oProperty))
             {
                 printf("%*s property(%s)\n", (nLevel + 1) * 4, "", oProperty.Name);
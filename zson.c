@@ -0,0 +1,682 @@
+//command line tool over the library, built apart from the tests :
+//  gcc -std=gnu11 -O2 -o zson zson.c json*.c -lm -pthread
+//usage : zson <command> [options] [file]
+//  validate        checks the text, prints the error and the index where it was found
+//  minify          prints the text without whitespace
+//  pretty          prints the text indented
+//  stats           prints the sizes before and after parsing and how many values of each encoding were written
+//  get <path>      prints the value at a path like .statuses[0].user.name or .["a key"], null when it is missing
+//options :
+//  --ndjson        one document per line, the lines are split in ranges processed on all the cores
+//  --threads <n>   threads used with --ndjson, the number of cores by default
+//  --indent <n>    spaces per level for pretty, 2 by default
+//  --utf8          also rejects strings whose raw chars are not well formed utf-8
+//the file is mapped copy on write when possible, so the in place parse never reads it into a separate copy,
+//standard input is read whole when no file is given
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "json.h"
+
+#define ZSON_MAX_THREADS 64
+#define ZSON_MAX_PATH 64
+#define ZSON_MAX_PATH_NAMES 1024//chars of the names of a path, terminators included
+#define ZSON_MAX_ERRORS 16//reported per range, the count of invalid lines is always exact
+#define ZSON_ROUND_SIZE (32 << 20)//bytes of lines per thread before the outputs are written, bounds the memory of the outputs
+#define ZSON_STREAM_BLOCK_SIZE (64 << 10)//staging of the compact values written to the output
+
+typedef enum
+{
+    ZsonValidate = 0,
+    ZsonMinify,
+    ZsonPretty,
+    ZsonStats,
+    ZsonGet,
+} ZsonCommand;
+
+typedef struct ZsonStep
+{
+    const char* Name;//null for an index
+    long long Index;
+} ZsonStep;
+
+typedef struct ZsonJob
+{
+    ZsonCommand Command;
+    int Options;//JsonParseOption flags
+    JsonFormatStyle Style;
+    ZsonStep Path[ZSON_MAX_PATH];
+    int PathSize;
+    char Names[ZSON_MAX_PATH_NAMES];
+} ZsonJob;
+
+//text written by a worker, straight to a file or kept until the previous ranges are written
+typedef struct ZsonOutput
+{
+    FILE* File;
+    char* Data;
+    size_t Size;
+    size_t Capacity;
+    int Failed;
+} ZsonOutput;
+
+typedef struct ZsonError
+{
+    long long Line;//counted from the start of the range
+    const char* Error;
+    long long Index;
+} ZsonError;
+
+typedef struct ZsonWorker
+{
+    const ZsonJob* Job;
+    char* Begin;
+    char* End;
+    ZsonOutput Output;
+    char* Buffer;//reused for every value written
+    char* Stream;//compact values go straight to the output through it
+    long long Lines;
+    long long Documents;
+    long long Invalid;
+    ZsonError Errors[ZSON_MAX_ERRORS];
+    int ErrorCount;
+    long long InitialSize;
+    long long EndSize;
+    JsonParseStats Stats;
+} ZsonWorker;
+
+/*************************
+ * output
+**************************/
+
+//room for nSize more bytes of output in memory, null when it can't grow
+char* zson_reserve(ZsonOutput* pOutput, size_t nSize)
+{
+    if (pOutput->Size + nSize > pOutput->Capacity)
+    {
+        size_t nCapacity = pOutput->Capacity < 4096 ? 4096 : pOutput->Capacity;
+        while (nCapacity < pOutput->Size + nSize)
+            nCapacity *= 2;
+        char* pGrown = (char*)realloc(pOutput->Data, nCapacity);
+        if (!pGrown)
+        {
+            pOutput->Failed = 1;
+            return 0;
+        }
+        pOutput->Data = pGrown;
+        pOutput->Capacity = nCapacity;
+    }
+    return pOutput->Data + pOutput->Size;
+}
+
+int zson_write(void* pUser, const char* pData, size_t nSize)
+{
+    ZsonOutput* pOutput = (ZsonOutput*)pUser;
+    if (pOutput->File)
+    {
+        if (fwrite(pData, 1, nSize, pOutput->File) != nSize)
+            pOutput->Failed = 1;
+        return !pOutput->Failed;
+    }
+    if (!zson_reserve(pOutput, nSize))
+        return 0;
+    memcpy(pOutput->Data + pOutput->Size, pData, nSize);
+    pOutput->Size += nSize;
+    return 1;
+}
+
+//a compact value is streamed to the output in blocks, an indented one is written to the reused buffer then formatted
+int zson_write_value(ZsonWorker* pWorker, JsonObject oValue)
+{
+    if (oValue.Type == JsonTypeInvalid)
+        return zson_write(&pWorker->Output, "null\n", 5);
+    if (pWorker->Job->Command != ZsonPretty)
+    {
+        Json_ResetBuffer(pWorker->Stream);//a failed value may have left text in it
+        return Json_AddValue(&pWorker->Stream, oValue) && Json_CloseStream(&pWorker->Stream) && zson_write(&pWorker->Output, "\n", 1);
+    }
+    Json_ResetBuffer(pWorker->Buffer);
+    if (!Json_AddValue(&pWorker->Buffer, oValue))
+        return 0;
+    if (!Json_FormatTo(pWorker->Buffer, &pWorker->Job->Style, zson_write, &pWorker->Output))
+        return 0;
+    return zson_write(&pWorker->Output, "\n", 1);
+}
+
+/*************************
+ * paths
+ * .name, [index] and ["name"] steps, the names are copied to the job with their terminators
+**************************/
+
+int zson_parse_path(const char* sPath, ZsonJob* pJob)
+{
+    pJob->PathSize = 0;
+    int nNamesUsed = 0;
+    const char* pRead = sPath;
+    while (*pRead)
+    {
+        if (*pRead == '.')
+        {
+            pRead++;
+            continue;//a lone . is the root, and .[0] is the same as [0]
+        }
+        if (pJob->PathSize == ZSON_MAX_PATH)
+            return 0;
+        ZsonStep* pStep = &pJob->Path[pJob->PathSize++];
+        pStep->Name = 0;
+        pStep->Index = 0;
+        if (*pRead == '[' && pRead[1] != '"')
+        {
+            char* pEnd = 0;
+            pStep->Index = strtoll(pRead + 1, &pEnd, 10);
+            if (pEnd == pRead + 1 || *pEnd != ']' || pStep->Index < 0)
+                return 0;
+            pRead = pEnd + 1;
+            continue;
+        }
+        const char* pName = pRead;
+        const char* pEnd = pRead;
+        if (*pRead == '[')
+        {
+            pName = pRead + 2;
+            pEnd = strchr(pName, '"');
+            if (!pEnd || pEnd[1] != ']')
+                return 0;
+            pRead = pEnd + 2;
+        }
+        else
+        {
+            while (*pEnd && *pEnd != '.' && *pEnd != '[')
+                pEnd++;
+            pRead = pEnd;
+        }
+        int nLength = (int)(pEnd - pName);
+        if (nNamesUsed + nLength + 1 > ZSON_MAX_PATH_NAMES)
+            return 0;
+        memcpy(pJob->Names + nNamesUsed, pName, nLength);
+        pJob->Names[nNamesUsed + nLength] = '\0';
+        pStep->Name = pJob->Names + nNamesUsed;
+        nNamesUsed += nLength + 1;
+    }
+    return 1;
+}
+
+JsonObject zson_follow_path(const ZsonJob* pJob, JsonObject oJson)
+{
+    for (int i = 0; i < pJob->PathSize && oJson.Type != JsonTypeInvalid; i++)
+    {
+        const ZsonStep* pStep = &pJob->Path[i];
+        if (pStep->Name)
+            oJson = oJson.Type == JsonTypeObject ? Json_GetPropertyByName(oJson, (char*)pStep->Name).Value : (JsonObject){ 0 };
+        else
+            oJson = oJson.Type == JsonTypeArray ? Json_GetElementAtIndex(oJson, pStep->Index).Value : (JsonObject){ 0 };
+    }
+    return oJson;
+}
+
+/*************************
+ * documents
+**************************/
+
+void zson_add_stats(JsonParseStats* pTotal, const JsonParseStats* pStats)
+{
+    pTotal->Nulls += pStats->Nulls;
+    pTotal->Bools += pStats->Bools;
+    pTotal->Numbers += pStats->Numbers;
+    pTotal->Strings += pStats->Strings;
+    pTotal->Keys += pStats->Keys;
+    pTotal->SmallObjects += pStats->SmallObjects;
+    pTotal->LargeObjects += pStats->LargeObjects;
+    pTotal->SmallArrays += pStats->SmallArrays;
+    pTotal->LargeArrays += pStats->LargeArrays;
+    pTotal->SmallStrings += pStats->SmallStrings;
+    pTotal->LargeStrings += pStats->LargeStrings;
+    pTotal->StringBytes += pStats->StringBytes;
+    pTotal->Escapes += pStats->Escapes;
+    pTotal->Digits += pStats->Digits;
+    pTotal->Int8s += pStats->Int8s;
+    pTotal->Int16s += pStats->Int16s;
+    pTotal->Int32s += pStats->Int32s;
+    pTotal->Int64s += pStats->Int64s;
+    pTotal->Exponents += pStats->Exponents;
+    if (pStats->MaxDepth > pTotal->MaxDepth)
+        pTotal->MaxDepth = pStats->MaxDepth;
+}
+
+int zson_is_space(char sChar)
+{
+    return sChar == ' ' || sChar == '\t' || sChar == '\r' || sChar == '\n';
+}
+
+//parses one document in place and runs the command on it, returns 0 when the output failed
+int zson_process(ZsonWorker* pWorker, char* pText, size_t nSize)
+{
+    const ZsonJob* pJob = pWorker->Job;
+    //the parser stops after the root value, so anything but whitespace after it is found from the end of the text
+    while (nSize > 0 && zson_is_space(pText[nSize - 1]))
+        nSize--;
+    if (nSize == 0)
+        return 1;//blank lines are not documents
+    pText[nSize] = '\0';
+    pWorker->Documents++;
+
+    //minify keeps the numbers and escapes as they were written, the text is compacted before the in place parse validates it
+    //and is only kept when it is valid, the compaction may store a few bytes past the end of its text
+    char* pMinified = 0;
+    if (pJob->Command == ZsonMinify)
+    {
+        pMinified = pWorker->Output.File ? (char*)malloc(nSize + 32) : zson_reserve(&pWorker->Output, nSize + 32);
+        if (!pMinified)
+            return 0;
+        Json_CompressInto(pText, pMinified);
+    }
+
+    JsonParseStats oStats;
+    JsonResult oResult = Json_ParseWithStats(pText, pJob->Options, pJob->Command == ZsonStats ? &oStats : 0);
+    if (oResult.Success && oResult.InitialSize < (long long)nSize)
+    {
+        oResult.Success = 0;
+        oResult.Error = "Unexpected character after the root value";
+        oResult.Index = oResult.InitialSize;
+    }
+    if (!oResult.Success)
+    {
+        if (pWorker->ErrorCount < ZSON_MAX_ERRORS)
+        {
+            ZsonError* pError = &pWorker->Errors[pWorker->ErrorCount++];
+            pError->Line = pWorker->Lines;
+            pError->Error = oResult.Error;
+            pError->Index = oResult.Index;
+        }
+        pWorker->Invalid++;
+        if (pWorker->Output.File)
+            free(pMinified);
+        return 1;
+    }
+    pWorker->InitialSize += (long long)nSize;
+    pWorker->EndSize += oResult.EndSize;
+    switch (pJob->Command)
+    {
+        case ZsonMinify:
+        {
+            size_t nMinified = strlen(pMinified);
+            if (!pWorker->Output.File)
+            {
+                pWorker->Output.Size += nMinified;
+                return zson_write(&pWorker->Output, "\n", 1);
+            }
+            int bWritten = zson_write(&pWorker->Output, pMinified, nMinified) && zson_write(&pWorker->Output, "\n", 1);
+            free(pMinified);
+            return bWritten;
+        }
+        case ZsonPretty:
+            return zson_write_value(pWorker, oResult.RootObject);
+        case ZsonGet:
+            return zson_write_value(pWorker, zson_follow_path(pJob, oResult.RootObject));
+        case ZsonStats:
+            zson_add_stats(&pWorker->Stats, &oStats);
+            return 1;
+        default:
+            return 1;
+    }
+}
+
+void zson_run_lines(ZsonWorker* pWorker)
+{
+    char* pLine = pWorker->Begin;
+    while (pLine < pWorker->End)
+    {
+        char* pEnd = (char*)memchr(pLine, '\n', pWorker->End - pLine);
+        if (!pEnd)
+            pEnd = pWorker->End;//the text is null terminated at its end, so the last line always is
+        *pEnd = '\0';
+        pWorker->Lines++;
+        if (!zson_process(pWorker, pLine, pEnd - pLine))
+        {
+            pWorker->Output.Failed = 1;
+            return;
+        }
+        pLine = pEnd + 1;
+    }
+}
+
+#ifdef _WIN32
+DWORD WINAPI zson_thread(LPVOID pWorker)
+{
+    zson_run_lines((ZsonWorker*)pWorker);
+    return 0;
+}
+#else
+void* zson_thread(void* pWorker)
+{
+    zson_run_lines((ZsonWorker*)pWorker);
+    return 0;
+}
+#endif
+
+/*************************
+ * input
+**************************/
+
+typedef struct ZsonInput
+{
+    char* Text;//null terminated and writable
+    size_t Size;
+    size_t Mapped;//size of the mapping, 0 when the text was read
+} ZsonInput;
+
+int zson_read_stream(FILE* hFile, ZsonInput* pInput)
+{
+    size_t nCapacity = 1 << 20;
+    pInput->Text = (char*)malloc(nCapacity);
+    pInput->Size = 0;
+    pInput->Mapped = 0;
+    while (pInput->Text)
+    {
+        pInput->Size += fread(pInput->Text + pInput->Size, 1, nCapacity - pInput->Size - 1, hFile);
+        if (pInput->Size < nCapacity - 1)
+            break;
+        char* pGrown = (char*)realloc(pInput->Text, nCapacity *= 2);
+        if (!pGrown)
+            free(pInput->Text);
+        pInput->Text = pGrown;
+    }
+    if (!pInput->Text)
+        return 0;
+    pInput->Text[pInput->Size] = '\0';
+    return !ferror(hFile);
+}
+
+int zson_open(const char* sPath, ZsonInput* pInput)
+{
+    if (!sPath)
+        return zson_read_stream(stdin, pInput);
+#ifndef _WIN32
+    //a private writable mapping, the pages the parse writes are copied on demand and the file is never changed
+    //the zeros that fill the last page terminate the text, a file that ends on a page boundary has none and is read
+    int nFd = open(sPath, O_RDONLY);
+    if (nFd < 0)
+        return 0;
+    struct stat oStat;
+    if (fstat(nFd, &oStat) == 0 && oStat.st_size > 0 && oStat.st_size % sysconf(_SC_PAGESIZE) != 0)
+    {
+        void* pMemory = mmap(0, (size_t)oStat.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, nFd, 0);
+        if (pMemory != MAP_FAILED)
+        {
+            close(nFd);
+            madvise(pMemory, (size_t)oStat.st_size, MADV_SEQUENTIAL);
+            pInput->Text = (char*)pMemory;
+            pInput->Size = (size_t)oStat.st_size;
+            pInput->Mapped = (size_t)oStat.st_size;
+            return 1;
+        }
+    }
+    close(nFd);
+#endif
+    FILE* hFile = fopen(sPath, "rb");
+    if (!hFile)
+        return 0;
+    int bRead = zson_read_stream(hFile, pInput);
+    fclose(hFile);
+    return bRead;
+}
+
+void zson_close(ZsonInput* pInput)
+{
+#ifndef _WIN32
+    if (pInput->Mapped)
+    {
+        munmap(pInput->Text, pInput->Mapped);
+        return;
+    }
+#endif
+    free(pInput->Text);
+}
+
+int zson_core_count()
+{
+#ifdef _WIN32
+    SYSTEM_INFO oInfo;
+    GetSystemInfo(&oInfo);
+    return (int)oInfo.dwNumberOfProcessors;
+#else
+    long nCores = sysconf(_SC_NPROCESSORS_ONLN);
+    return nCores > 0 ? (int)nCores : 1;
+#endif
+}
+
+/*************************
+ * runs
+**************************/
+
+void zson_init_worker(ZsonWorker* pWorker, const ZsonJob* pJob, FILE* hFile)
+{
+    memset(pWorker, 0, sizeof(ZsonWorker));
+    pWorker->Job = pJob;
+    pWorker->Output.File = hFile;
+    pWorker->Buffer = Json_CreateBuffer();
+    pWorker->Stream = Json_CreateStream(zson_write, &pWorker->Output, ZSON_STREAM_BLOCK_SIZE);
+}
+
+void zson_print_stats(const ZsonWorker* pTotal)
+{
+    const JsonParseStats* pStats = &pTotal->Stats;
+    printf("documents       %lli\n", pTotal->Documents);
+    printf("text bytes      %lli\n", pTotal->InitialSize);
+    printf("parsed bytes    %lli\n", pTotal->EndSize);
+    printf("ratio           %.2f%%\n", pTotal->InitialSize ? 100.0 * pTotal->EndSize / pTotal->InitialSize : 0.0);
+    printf("max depth       %i\n", pStats->MaxDepth);
+    printf("small objects   %lli\n", pStats->SmallObjects);
+    printf("large objects   %lli\n", pStats->LargeObjects);
+    printf("small arrays    %lli\n", pStats->SmallArrays);
+    printf("large arrays    %lli\n", pStats->LargeArrays);
+    printf("keys            %lli\n", pStats->Keys);
+    printf("small strings   %lli\n", pStats->SmallStrings);
+    printf("large strings   %lli\n", pStats->LargeStrings);
+    printf("string bytes    %lli\n", pStats->StringBytes);
+    printf("escapes         %lli\n", pStats->Escapes);
+    printf("digits          %lli\n", pStats->Digits);
+    printf("int8            %lli\n", pStats->Int8s);
+    printf("int16           %lli\n", pStats->Int16s);
+    printf("int32           %lli\n", pStats->Int32s);
+    printf("int64           %lli\n", pStats->Int64s);
+    printf("exponents       %lli\n", pStats->Exponents);
+    printf("bools           %lli\n", pStats->Bools);
+    printf("nulls           %lli\n", pStats->Nulls);
+}
+
+//folds a finished worker in the totals and reports its errors with the line numbers of the whole input
+void zson_collect(ZsonWorker* pTotal, const ZsonWorker* pWorker, int bLines)
+{
+    for (int i = 0; i < pWorker->ErrorCount; i++)
+    {
+        const ZsonError* pError = &pWorker->Errors[i];
+        if (bLines)
+            fprintf(stderr, "line %lli : %s at %lli\n", pTotal->Lines + pError->Line, pError->Error, pError->Index);
+        else
+            fprintf(stderr, "invalid : %s at %lli\n", pError->Error, pError->Index);
+    }
+    pTotal->Lines += pWorker->Lines;
+    pTotal->Documents += pWorker->Documents;
+    pTotal->Invalid += pWorker->Invalid;
+    pTotal->InitialSize += pWorker->InitialSize;
+    pTotal->EndSize += pWorker->EndSize;
+    zson_add_stats(&pTotal->Stats, &pWorker->Stats);
+}
+
+//the lines are processed in rounds, every thread gets a range of about ZSON_ROUND_SIZE bytes cut at a line end,
+//and the outputs of the round are written in order before the next one starts
+int zson_run_ndjson(const ZsonJob* pJob, ZsonInput* pInput, int nThreads, ZsonWorker* pTotal)
+{
+    static ZsonWorker pWorkers[ZSON_MAX_THREADS];
+#ifdef _WIN32
+    HANDLE pThreads[ZSON_MAX_THREADS];
+#else
+    pthread_t pThreads[ZSON_MAX_THREADS];
+#endif
+    int pStarted[ZSON_MAX_THREADS];
+    for (int i = 0; i < nThreads; i++)
+        zson_init_worker(&pWorkers[i], pJob, 0);
+
+    int bSuccess = 1;
+    char* pNext = pInput->Text;
+    char* pTextEnd = pInput->Text + pInput->Size;
+    while (bSuccess && pNext < pTextEnd)
+    {
+        //the last rounds are shared evenly, so an input smaller than a round still uses every thread
+        size_t nRange = (size_t)(pTextEnd - pNext) / nThreads + 1;
+        if (nRange > ZSON_ROUND_SIZE)
+            nRange = ZSON_ROUND_SIZE;
+        int nUsed = 0;
+        for (int i = 0; i < nThreads && pNext < pTextEnd; i++, nUsed++)
+        {
+            ZsonWorker* pWorker = &pWorkers[i];
+            pWorker->Begin = pNext;
+            pWorker->End = (size_t)(pTextEnd - pNext) > nRange ? pNext + nRange : pTextEnd;
+            char* pLineEnd = (char*)memchr(pWorker->End, '\n', pTextEnd - pWorker->End);
+            pWorker->End = pLineEnd ? pLineEnd : pTextEnd;
+            pNext = pWorker->End + 1;
+            pWorker->Output.Size = 0;
+            pWorker->Lines = pWorker->Documents = pWorker->Invalid = 0;
+            pWorker->InitialSize = pWorker->EndSize = 0;
+            pWorker->ErrorCount = 0;
+            memset(&pWorker->Stats, 0, sizeof(JsonParseStats));
+        }
+        //the first range is processed by the calling thread, as is any range whose thread could not be started
+        for (int i = 1; i < nUsed; i++)
+        {
+#ifdef _WIN32
+            pThreads[i] = CreateThread(0, 0, zson_thread, &pWorkers[i], 0, 0);
+            pStarted[i] = pThreads[i] != 0;
+#else
+            pStarted[i] = pthread_create(&pThreads[i], 0, zson_thread, &pWorkers[i]) == 0;
+#endif
+        }
+        zson_run_lines(&pWorkers[0]);
+        for (int i = 1; i < nUsed; i++)
+        {
+            if (!pStarted[i])
+            {
+                zson_run_lines(&pWorkers[i]);
+                continue;
+            }
+#ifdef _WIN32
+            WaitForSingleObject(pThreads[i], INFINITE);
+            CloseHandle(pThreads[i]);
+#else
+            pthread_join(pThreads[i], 0);
+#endif
+        }
+        for (int i = 0; i < nUsed; i++)
+        {
+            zson_collect(pTotal, &pWorkers[i], 1);
+            if (pWorkers[i].Output.Failed || (pWorkers[i].Output.Size && fwrite(pWorkers[i].Output.Data, 1, pWorkers[i].Output.Size, stdout) != pWorkers[i].Output.Size))
+                bSuccess = 0;
+        }
+    }
+    for (int i = 0; i < nThreads; i++)
+    {
+        free(pWorkers[i].Output.Data);
+        Json_ReleaseBuffer(pWorkers[i].Buffer);
+        Json_ReleaseBuffer(pWorkers[i].Stream);
+    }
+    return bSuccess;
+}
+
+int zson_run_document(const ZsonJob* pJob, ZsonInput* pInput, ZsonWorker* pTotal)
+{
+    ZsonWorker oWorker;
+    zson_init_worker(&oWorker, pJob, stdout);//a single document is written as it is produced
+    int bSuccess = zson_process(&oWorker, pInput->Text, pInput->Size);
+    zson_collect(pTotal, &oWorker, 0);
+    Json_ReleaseBuffer(oWorker.Buffer);
+    Json_ReleaseBuffer(oWorker.Stream);
+    return bSuccess && !oWorker.Output.Failed;
+}
+
+int zson_usage()
+{
+    fprintf(stderr, "usage : zson <validate|minify|pretty|stats|get <path>> [--ndjson] [--threads <n>] [--indent <n>] [--utf8] [file]\n");
+    return 2;
+}
+
+int main(int argc, char** argv)
+{
+    static ZsonJob oJob;
+    const char* pCommands[] = { "validate", "minify", "pretty", "stats", "get" };
+    if (argc < 2)
+        return zson_usage();
+    oJob.Command = (ZsonCommand)-1;
+    for (int i = 0; i < (int)(sizeof(pCommands) / sizeof(pCommands[0])); i++)
+        if (strcmp(argv[1], pCommands[i]) == 0)
+            oJob.Command = (ZsonCommand)i;
+    if ((int)oJob.Command < 0)
+        return zson_usage();
+
+    int nArgument = 2;
+    if (oJob.Command == ZsonGet)
+    {
+        if (argc < 3 || !zson_parse_path(argv[2], &oJob))
+            return zson_usage();
+        nArgument = 3;
+    }
+    oJob.Style = Json_DefaultFormatStyle();
+    oJob.Style.IndentWidth = 2;
+    oJob.Style.Colon = ": ";
+    int bLines = 0;
+    int nThreads = 0;
+    const char* sPath = 0;
+    for (; nArgument < argc; nArgument++)
+    {
+        if (strcmp(argv[nArgument], "--ndjson") == 0)
+            bLines = 1;
+        else if (strcmp(argv[nArgument], "--utf8") == 0)
+            oJob.Options |= JsonParseValidateUtf8;
+        else if (strcmp(argv[nArgument], "--threads") == 0 && nArgument + 1 < argc)
+            nThreads = atoi(argv[++nArgument]);
+        else if (strcmp(argv[nArgument], "--indent") == 0 && nArgument + 1 < argc)
+            oJob.Style.IndentWidth = atoi(argv[++nArgument]);
+        else if (argv[nArgument][0] == '-' && argv[nArgument][1] == '-')
+            return zson_usage();
+        else
+            sPath = argv[nArgument];
+    }
+    if (nThreads <= 0)
+        nThreads = zson_core_count();
+    if (nThreads > ZSON_MAX_THREADS)
+        nThreads = ZSON_MAX_THREADS;
+
+    ZsonInput oInput;
+    if (!zson_open(sPath, &oInput))
+    {
+        fprintf(stderr, "can't read %s\n", sPath ? sPath : "the standard input");
+        return 2;
+    }
+    static ZsonWorker oTotal;
+    int bSuccess = bLines ? zson_run_ndjson(&oJob, &oInput, nThreads, &oTotal) : zson_run_document(&oJob, &oInput, &oTotal);
+    zson_close(&oInput);
+    if (!bSuccess)
+    {
+        fprintf(stderr, "failed to write the output\n");
+        return 2;
+    }
+    if (oJob.Command == ZsonStats)
+        zson_print_stats(&oTotal);
+    else if (oJob.Command == ZsonValidate && bLines)
+        printf("%lli documents, %lli invalid\n", oTotal.Documents, oTotal.Invalid);
+    else if (oJob.Command == ZsonValidate && !oTotal.Invalid)
+        printf("valid\n");
+    return oTotal.Invalid ? 1 : 0;
+}